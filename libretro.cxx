@@ -5,6 +5,7 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #ifdef _MSC_VER
 #define snprintf _snprintf
@@ -25,10 +26,19 @@
 #include "PropsSet.hxx"
 #include "Paddles.hxx"
 #include "SoundSDL.hxx"
+#include "RomCache.hxx"
+#ifdef PROFILER_SUPPORT
+#include "Profiler.hxx"
+#endif
+#ifdef THUMB_STATS
+#include "CartDPCPlus.hxx"
+#endif
 
 static SoundSDL *vcsSound = 0;
-static uint32_t tiaSamplesPerFrame = 0;
-static int16_t *sampleBuffer[2048];
+static unsigned audioRate = 31400;
+// Stereo samples sent to the frontend, longer frames are sent in parts
+static const uInt32 SAMPLE_BUFFER_FRAMES = 2048;
+static Int16 sampleBuffer[SAMPLE_BUFFER_FRAMES * 2];
 static uint32_t frameBuffer[256*160];
 #include "Stubs.hxx"
 
@@ -36,6 +46,20 @@ static Console *console = 0;
 static Cartridge *cartridge = 0;
 static OSystem osystem;
 static StateManager stateManager(&osystem);
+static RomCache romCache;
+static bool romCacheLoaded = false;
+static bool rewindEnabled = false;
+static bool movieRecording = false;
+#ifdef PROFILER_SUPPORT
+static Profiler *profiler = 0;
+#endif
+#ifdef THUMB_STATS
+static CartridgeDPCPlus *armCartridge = 0;
+#endif
+#ifdef AUDIO_CAPTURE_SUPPORT
+static AudioCapture *audioCapture = 0;
+static uInt64 unheardSamples = 0;
+#endif
 const uint32_t* Palette;
 
 int videoWidth, videoHeight;
@@ -48,7 +72,22 @@ static retro_environment_t environ_cb;
 static retro_audio_sample_t audio_cb;
 static retro_audio_sample_batch_t audio_batch_cb;
 
-void retro_set_environment(retro_environment_t cb) { environ_cb = cb; }
+void retro_set_environment(retro_environment_t cb)
+{
+   environ_cb = cb;
+
+   static const struct retro_variable vars[] = {
+      { "stella_synth_music", "Synthesize DPC/DPC+ music (restart); disabled|enabled" },
+      { "stella_audio_rate", "Audio sample rate (restart); 31400|44100|48000" },
+      { "stella_rewind", "Rewind with Y (restart); disabled|enabled" },
+      { "stella_movie", "Input movie (restart); disabled|record|play" },
+#ifdef AUDIO_CAPTURE_SUPPORT
+      { "stella_audio_capture", "Capture audio to WAV (restart); disabled|mixed|mixed and channels" },
+#endif
+      { NULL, NULL },
+   };
+   cb(RETRO_ENVIRONMENT_SET_VARIABLES, (void*)vars);
+}
 void retro_set_video_refresh(retro_video_refresh_t cb) { video_cb = cb; }
 void retro_set_audio_sample(retro_audio_sample_t cb) { audio_cb = cb; }
 void retro_set_audio_sample_batch(retro_audio_sample_batch_t cb) { audio_batch_cb = cb; }
@@ -61,6 +100,28 @@ void stellaSetPalette (const uInt32* palette)
    Palette = palette;
 }
 
+// The ROM analysis cache lives in the frontend's save directory
+static string romCachePath()
+{
+   const char *dir = 0;
+   string path;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY, &dir) && dir)
+      path = string(dir) + BSPF_PATH_SEPARATOR;
+
+   return path + "stella.romcache";
+}
+
+// Movies live there too, named after the ROM they were recorded with
+static string moviePath()
+{
+   const char *dir = 0;
+   string path;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY, &dir) && dir)
+      path = string(dir) + BSPF_PATH_SEPARATOR;
+
+   return path + console->properties().get(Cartridge_MD5) + ".movie";
+}
+
 static void update_input()
 {
 
@@ -118,7 +179,7 @@ void retro_get_system_av_info(struct retro_system_av_info *info)
 {
    memset(info, 0, sizeof(*info));
    info->timing.fps            = console->getFramerate();
-   info->timing.sample_rate    = 31400;
+   info->timing.sample_rate    = audioRate;
    info->geometry.base_width   = 160 * 2;
    info->geometry.base_height  = videoHeight;
    info->geometry.max_width    = 320;
@@ -134,29 +195,28 @@ void retro_set_controller_port_device(unsigned port, unsigned device)
 
 size_t retro_serialize_size(void) 
 {
-   //return STATE_SIZE;
-   return 0;
+   // A state is the same size for as long as the game is loaded, so
+   // save one to find out
+   Serializer state;
+   return stateManager.saveState(state) && stateManager.savePosition(state) ?
+      state.size() : 0;
 }
 
 bool retro_serialize(void *data, size_t size)
 {
-   //Serializer state(filename, 0);
-   //if(stateManager.saveState(state))
-   //{
-   //   return true;
-   //}
-   return false;
+   // The position in the movie goes along, so that loading the state takes
+   // the movie back too (run-ahead loads one every frame)
+   Serializer state((uInt8*)data, size);
+   return stateManager.saveState(state) && stateManager.savePosition(state);
 }
 
 bool retro_unserialize(const void *data, size_t size)
 {
-   //if (size != STATE_SIZE)
-   //Serializer state(filename, 1);
-   //if(stateManager.loadState(state))
-   //{
-   //   return true;
-   //}
-   return false;
+   Serializer state((uInt8*)data, size, true);
+   if (!stateManager.loadState(state))
+      return false;
+   stateManager.loadPosition(state);
+   return true;
 }
 
 void retro_cheat_reset(void)
@@ -193,6 +253,7 @@ bool retro_load_game(const struct retro_game_info *info)
       { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_R3,     "Black/White" },
       { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_SELECT, "Select" },
       { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_START,  "Reset" },
+      { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_Y,      "Rewind" },
 
       { 1, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_LEFT,  "Left" },
       { 1, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_UP,    "Up" },
@@ -214,11 +275,36 @@ bool retro_load_game(const struct retro_game_info *info)
    Properties props;
    osystem.propSet().getMD5(cartMD5, props);
 
+   // A ROM we've seen before doesn't need any autodetection
+   if (!romCacheLoaded)
+   {
+      romCache.load(romCachePath());
+      romCacheLoaded = true;
+   }
+   bool cached = romCache.get(cartMD5, props);
+
    // Load the cart
    string cartType = props.get(Cartridge_Type);
    string cartId;//, romType("AUTO-DETECT");
    Settings *settings = new Settings(&osystem);
    settings->setValue("romloadcount", 0);
+
+   struct retro_variable var = { "stella_synth_music", NULL };
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      settings->setValue("synthmusic", strcmp(var.value, "enabled") == 0);
+
+   // TIA sound is band-limited when it's resampled to another rate
+   var.key = "stella_audio_rate";
+   var.value = NULL;
+   audioRate = 31400;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      audioRate = atoi(var.value);
+   if (audioRate != 44100 && audioRate != 48000)
+      audioRate = 31400;
+   settings->setValue("freq", (int)audioRate);
+   // A multicart changes cartMD5 to that of the sub-ROM it starts, but the
+   // cache has to be keyed on the image we're actually given
+   const string imageMD5 = cartMD5;
    cartridge = Cartridge::create((const uInt8*)info->data, (uInt32)info->size, cartMD5, cartType, cartId, osystem, *settings);
 
    if(cartridge == 0)
@@ -228,14 +314,102 @@ bool retro_load_game(const struct retro_game_info *info)
       return false;
    }
 
+   // ROMs that aren't in the properties database (or a piece of the image
+   // the cart was created from) are known by their md5 from here on
+   if (props.get(Cartridge_MD5) != cartMD5 &&
+       !osystem.propSet().getMD5(cartMD5, props))
+      props.set(Cartridge_MD5, cartMD5);
+
    // Create the console
    console = new Console(&osystem, cartridge, props);
    osystem.myConsole = console;
 
+   // Remember what was detected for the next time this ROM is loaded
+   if (!cached)
+   {
+      string format = console->about().DisplayFormat;
+      if (!format.empty() && format[format.size() - 1] == '*')
+         format.erase(format.size() - 1);
+
+      Properties analysed(console->properties());
+      analysed.set(Cartridge_Type, cartType);
+      analysed.set(Display_Format, format);
+      romCache.insert(imageMD5, analysed);
+      if (!romCache.save(romCachePath()) && log_cb)
+         log_cb(RETRO_LOG_WARN, "[Stella]: Failed to save ROM cache.\n");
+   }
+
+#ifdef PROFILER_SUPPORT
+   // Profile everything from here on; the profile is saved on unload
+   profiler = new Profiler(*cartridge, cartMD5);
+   console->system().setProfiler(profiler);
+#endif
+
+#ifdef THUMB_STATS
+   // Log the time spent in ARM code every frame
+   if (cartridge->name() == "CartridgeDPC+")
+   {
+      armCartridge = static_cast<CartridgeDPCPlus*>(cartridge);
+      armCartridge->resetARMStats();
+   }
+#endif
+
    // Init sound and video
    console->initializeVideo();
    console->initializeAudio();
 
+#ifdef AUDIO_CAPTURE_SUPPORT
+   // Capture the sound to <md5>.wav (and each TIA channel to
+   // <md5>.tia0.wav and <md5>.tia1.wav) in the save directory
+   var.key = "stella_audio_capture";
+   var.value = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value &&
+       strcmp(var.value, "disabled") != 0)
+   {
+      const char *dir = 0;
+      string base;
+      if (environ_cb(RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY, &dir) && dir)
+         base = string(dir) + BSPF_PATH_SEPARATOR;
+      base += cartMD5;
+
+      audioCapture = new AudioCapture(base, audioRate,
+            strcmp(var.value, "mixed and channels") == 0);
+      if (audioCapture->isOpen())
+         vcsSound->setCapture(audioCapture);
+      else
+      {
+         if (log_cb)
+            log_cb(RETRO_LOG_ERROR, "[Stella]: Failed to start audio capture.\n");
+         delete audioCapture;
+         audioCapture = 0;
+      }
+   }
+#endif
+
+   // Record every frame, so that holding Y can step back through them
+   var.key = "stella_rewind";
+   var.value = NULL;
+   rewindEnabled = environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) &&
+      var.value && strcmp(var.value, "enabled") == 0;
+   if (rewindEnabled != stateManager.isRewindMode())
+      stateManager.toggleRewindMode();
+
+   // Record the inputs into a movie, saved when the game is unloaded, or
+   // play back the one saved before; Y then steps back through it instead
+   var.key = "stella_movie";
+   var.value = NULL;
+   movieRecording = false;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (strcmp(var.value, "record") == 0)
+         movieRecording = stateManager.toggleRecordMode();
+      else if (strcmp(var.value, "play") == 0 &&
+               !(stateManager.loadMovie(moviePath()) &&
+                 stateManager.togglePlaybackMode()) && log_cb)
+         log_cb(RETRO_LOG_ERROR, "[Stella]: Failed to play back movie.\n");
+   }
+   rewindEnabled = stateManager.isRewindMode();
+
    // Get the ROM's width and height
    TIA& tia = console->tia();
    videoWidth = tia.width();
@@ -254,6 +428,66 @@ bool retro_load_game_special(unsigned game_type, const struct retro_game_info *i
 
 void retro_unload_game(void) 
 {
+   //Report what the rewind history cost, to judge its limits
+   if (rewindEnabled && log_cb)
+   {
+      StateManager::RewindStats stats = stateManager.rewindStats();
+      if (stats.recorded)
+         log_cb(RETRO_LOG_INFO, "[Stella]: Rewind: %u frames (%u keyframes) "
+               "in %u of %u bytes, %u byte states, %.1f us per frame\n",
+               stats.frames, stats.keyframes, stats.bytes, stats.bufferSize,
+               stats.stateSize, (double)stats.recordTime / stats.recorded);
+   }
+
+   //Keep the movie recorded, to play it back the next time
+   if (movieRecording && stateManager.movieLength() > 0 &&
+       !stateManager.saveMovie(moviePath()) && log_cb)
+      log_cb(RETRO_LOG_ERROR, "[Stella]: Failed to save movie.\n");
+   movieRecording = false;
+
+   //Any history recorded belongs to this game
+   stateManager.reset();
+
+#ifdef PROFILER_SUPPORT
+   if (profiler)
+   {
+      const char *dir = 0;
+      string base;
+      if (environ_cb(RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY, &dir) && dir)
+         base = string(dir) + BSPF_PATH_SEPARATOR;
+      base += profiler->md5();
+
+      if (!profiler->saveCSV(base + ".profile.csv") ||
+          !profiler->saveBinary(base + ".profile"))
+      {
+         if (log_cb)
+            log_cb(RETRO_LOG_ERROR, "[Stella]: Failed to save profile.\n");
+      }
+
+      console->system().setProfiler(0);
+      delete profiler;
+      profiler = 0;
+   }
+#endif
+#ifdef THUMB_STATS
+   armCartridge = 0;
+#endif
+#ifdef AUDIO_CAPTURE_SUPPORT
+   if (audioCapture)
+   {
+      vcsSound->setCapture(0);
+      if (audioCapture->dropped() && log_cb)
+         log_cb(RETRO_LOG_WARN, "[Stella]: Audio capture dropped %llu samples.\n",
+               (unsigned long long)audioCapture->dropped());
+      if (unheardSamples && log_cb)
+         log_cb(RETRO_LOG_WARN, "[Stella]: Audio capture holds %llu samples "
+               "that weren't played (fast-forward, run-ahead or rewind).\n",
+               (unsigned long long)unheardSamples);
+      unheardSamples = 0;
+      delete audioCapture;
+      audioCapture = 0;
+   }
+#endif
 }
 
 unsigned retro_get_region(void)
@@ -296,21 +530,58 @@ void retro_deinit(void)
 
 void retro_reset(void)
 {
-   console->system().reset();
+   //A movie being recorded has to play the reset back too
+   stateManager.resetSystem();
 }
 
 void retro_run(void)
 {
-   //Get the number of samples in a frame
-   tiaSamplesPerFrame = 31400.0f/console->getFramerate();
+   //Skip the audio when the frontend doesn't want it (fast-forward,
+   //frames only run ahead), which keeps the sound state but is much faster
+   int avEnable = 3;
+   bool audioEnabled =
+      !environ_cb(RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE, &avEnable) ||
+      (avEnable & 2);
 
    //INPUT
    update_input();
 
+   //Holding Y steps back a frame at a time through the rewind history, or
+   //the movie played back; the frames stepped back to are shown, but not
+   //heard, and the rewind history doesn't record them again
+   bool rewinding = false;
+   if (input_state_cb(Controller::Left, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_Y))
+   {
+      if (rewindEnabled)
+         rewinding = stateManager.rewindState();
+      else if (stateManager.isPlaybackMode() && stateManager.movieFrame() >= 2)
+         rewinding = stateManager.seekMovie(stateManager.movieFrame() - 2);
+   }
+
+   //Let the state manager record or play back this frame
+   if (stateManager.isActive() && !(rewinding && rewindEnabled))
+      stateManager.update();
+
    //EMULATE
    TIA& tia = console->tia();
    tia.update();
 
+#ifdef THUMB_STATS
+   if (armCartridge)
+   {
+      const CartridgeDPCPlus::ARMStats& arm = armCartridge->armStats();
+      if (log_cb)
+         log_cb(RETRO_LOG_INFO, "[Stella]: ARM: %u calls, %llu instructions, "
+               "%llu reads, %llu writes, %llu cycles = %u of %u 6507 cycles "
+               "(longest call %u)\n", arm.calls,
+               (unsigned long long)arm.instructions,
+               (unsigned long long)arm.reads, (unsigned long long)arm.writes,
+               (unsigned long long)arm.cycles, arm.systemCycles,
+               tia.scanlines() * 76, arm.maxSystemCycles);
+      armCartridge->resetARMStats();
+   }
+#endif
+
    //VIDEO
    //Get the frame info from stella
    videoWidth = tia.width();
@@ -323,8 +594,29 @@ void retro_run(void)
    video_cb(frameBuffer, videoWidth, videoHeight, videoWidth << 2);
 
    //AUDIO
-   //Process one frame of audio from stella
-   vcsSound->processFragment((int16_t*)sampleBuffer, tiaSamplesPerFrame);
+   //Process the audio for exactly the cycles emulated this frame; the
+   //system cycle counter is reset at the start of every frame
+   uInt32 samples = vcsSound->samplesForCycles(console->system().cycles());
+   bool heard = audioEnabled && !rewinding;
+#ifdef AUDIO_CAPTURE_SUPPORT
+   //A capture has to keep in step with the emulation, so the sound is
+   //still generated for it, just not played
+   if (!heard && audioCapture)
+      unheardSamples += samples;
+   else
+#endif
+   if (!heard)
+   {
+      vcsSound->skipFragment(samples);
+      return;
+   }
 
-   audio_batch_cb((int16_t*)sampleBuffer, tiaSamplesPerFrame);
+   while (samples > 0)
+   {
+      uInt32 length = samples < SAMPLE_BUFFER_FRAMES ? samples : SAMPLE_BUFFER_FRAMES;
+      vcsSound->processFragment(sampleBuffer, length);
+      if (heard)
+         audio_batch_cb(sampleBuffer, length);
+      samples -= length;
+   }
 }
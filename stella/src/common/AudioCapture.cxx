@@ -0,0 +1,203 @@
+//============================================================================
+//
+//   SSSS    tt          lll  lll
+//  SS  SS   tt           ll   ll
+//  SS     tttttt  eeee   ll   ll   aaaa
+//   SSSS    tt   ee  ee  ll   ll      aa
+//      SS   tt   eeeeee  ll   ll   aaaaa  --  "An Atari 2600 VCS Emulator"
+//  SS  SS   tt   ee      ll   ll  aa  aa
+//   SSSS     ttt  eeeee llll llll  aaaaa
+//
+// Copyright (c) 1995-2014 by Bradford W. Mott, Stephen Anthony
+// and the Stella Team
+//
+// See the file "License.txt" for information on usage and redistribution of
+// this file, and for a DISCLAIMER OF ALL WARRANTIES.
+//
+// $Id$
+//============================================================================
+
+#ifdef AUDIO_CAPTURE_SUPPORT
+
+#include <unistd.h>
+
+#include "AudioCapture.hxx"
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+AudioCapture::AudioCapture(const string& base, uInt32 frequency, bool channels)
+  : myFrequency(frequency),
+    myDropped(0),
+    myThreadStarted(false)
+{
+  static const char* const suffix[NUM_TRACKS] = {
+    ".wav", ".tia0.wav", ".tia1.wav"
+  };
+
+  for(int i = 0; i < NUM_TRACKS; ++i)
+  {
+    myFile[i] = 0;
+    myDataSize[i] = 0;
+  }
+  pthread_mutex_init(&myMutex, NULL);
+  pthread_cond_init(&myCondition, NULL);
+
+  for(int i = 0; i < (channels ? NUM_TRACKS : CHANNEL0); ++i)
+  {
+    myFile[i] = fopen((base + suffix[i]).c_str(), "wb");
+    if(myFile[i] == 0)
+      break;
+
+    // The sizes in the header are filled in when the capture is finished
+    writeHeader(myFile[i], i == MIXED ? 2 : 1, 0);
+  }
+
+  // Either all the files are written, or none
+  if(myFile[MIXED] && (!channels || (myFile[CHANNEL0] && myFile[CHANNEL1])))
+    myThreadStarted = pthread_create(&myThread, NULL, threadMain, this) == 0;
+
+  if(!myThreadStarted)
+  {
+    for(int i = 0; i < NUM_TRACKS; ++i)
+    {
+      if(myFile[i])
+        fclose(myFile[i]);
+      myFile[i] = 0;
+    }
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+AudioCapture::~AudioCapture()
+{
+  if(myThreadStarted)
+  {
+    // This is the only time we wait for the writer thread, to have room
+    // for the block telling it to finish (it's busy while the queue is
+    // full), and to be sure it wakes up for it
+    myBlock.track = NUM_TRACKS;
+    myBlock.length = 0;
+    while(!myQueue.push(myBlock))
+      usleep(1000);
+    pthread_mutex_lock(&myMutex);
+    pthread_cond_signal(&myCondition);
+    pthread_mutex_unlock(&myMutex);
+    pthread_join(myThread, NULL);
+
+    for(int i = 0; i < NUM_TRACKS; ++i)
+    {
+      if(myFile[i])
+      {
+        fseek(myFile[i], 0, SEEK_SET);
+        writeHeader(myFile[i], i == MIXED ? 2 : 1, myDataSize[i]);
+        fclose(myFile[i]);
+      }
+    }
+  }
+
+  pthread_cond_destroy(&myCondition);
+  pthread_mutex_destroy(&myMutex);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void AudioCapture::write(Track track, const Int16* samples, uInt32 length)
+{
+  if(!myThreadStarted || myFile[track] == 0)
+    return;
+
+  uInt32 values = track == MIXED ? length * 2 : length;
+  myBlock.track = track;
+  while(values > 0)
+  {
+    uInt32 n = BSPF_min(values, (uInt32)BLOCK_SIZE);
+    myBlock.length = n;
+    memcpy(myBlock.data, samples, n * sizeof(Int16));
+    if(!myQueue.push(myBlock))
+      myDropped += track == MIXED ? n / 2 : n;
+
+    samples += n;
+    values -= n;
+  }
+
+  // Wake up the writer thread, but never wait for the mutex to do it.
+  // The writer only holds it to check for an empty queue, so at worst
+  // it goes to sleep just now and gets the blocks with the next write()
+  if(pthread_mutex_trylock(&myMutex) == 0)
+  {
+    pthread_cond_signal(&myCondition);
+    pthread_mutex_unlock(&myMutex);
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void AudioCapture::writeHeader(FILE* file, uInt16 channels, uInt32 dataSize)
+{
+  uInt32 byteRate = myFrequency * channels * 2;
+  uInt16 blockAlign = channels * 2;
+
+  // All fields are little endian
+  uInt8 header[44];
+  uInt8* p = header;
+  #define PUT32(v) { uInt32 x = v; *p++ = x; *p++ = x >> 8; \
+                     *p++ = x >> 16; *p++ = x >> 24; }
+  #define PUT16(v) { uInt16 x = v; *p++ = x; *p++ = x >> 8; }
+  memcpy(p, "RIFF", 4);  p += 4;
+  PUT32(36 + dataSize);
+  memcpy(p, "WAVEfmt ", 8);  p += 8;
+  PUT32(16);              // size of the format chunk
+  PUT16(1);               // PCM
+  PUT16(channels);
+  PUT32(myFrequency);
+  PUT32(byteRate);
+  PUT16(blockAlign);
+  PUT16(16);              // bits per sample
+  memcpy(p, "data", 4);  p += 4;
+  PUT32(dataSize);
+  #undef PUT32
+  #undef PUT16
+
+  fwrite(header, 1, sizeof(header), file);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void AudioCapture::run()
+{
+  uInt8 bytes[BLOCK_SIZE * 2];
+
+  for(;;)
+  {
+    // Sleep until write() queues some more
+    if(myQueue.empty())
+    {
+      pthread_mutex_lock(&myMutex);
+      while(myQueue.empty())
+        pthread_cond_wait(&myCondition, &myMutex);
+      pthread_mutex_unlock(&myMutex);
+    }
+
+    const Block& block = myQueue.front();
+    if(block.track == NUM_TRACKS)
+    {
+      myQueue.pop();
+      break;
+    }
+
+    // WAV samples are little endian, no matter what the host is
+    for(uInt32 i = 0; i < block.length; ++i)
+    {
+      bytes[i * 2]     = (uInt16)block.data[i] & 0xff;
+      bytes[i * 2 + 1] = (uInt16)block.data[i] >> 8;
+    }
+    FILE* file = myFile[block.track];
+    myDataSize[block.track] += fwrite(bytes, 1, block.length * 2, file);
+    myQueue.pop();
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void* AudioCapture::threadMain(void* capture)
+{
+  static_cast<AudioCapture*>(capture)->run();
+  return NULL;
+}
+
+#endif  // AUDIO_CAPTURE_SUPPORT
@@ -0,0 +1,155 @@
+//============================================================================
+//
+//   SSSS    tt          lll  lll
+//  SS  SS   tt           ll   ll
+//  SS     tttttt  eeee   ll   ll   aaaa
+//   SSSS    tt   ee  ee  ll   ll      aa
+//      SS   tt   eeeeee  ll   ll   aaaaa  --  "An Atari 2600 VCS Emulator"
+//  SS  SS   tt   ee      ll   ll  aa  aa
+//   SSSS     ttt  eeeee llll llll  aaaaa
+//
+// Copyright (c) 1995-2014 by Bradford W. Mott, Stephen Anthony
+// and the Stella Team
+//
+// See the file "License.txt" for information on usage and redistribution of
+// this file, and for a DISCLAIMER OF ALL WARRANTIES.
+//
+// $Id$
+//============================================================================
+
+#ifdef AUDIO_CAPTURE_SUPPORT
+
+#ifndef AUDIO_CAPTURE_HXX
+#define AUDIO_CAPTURE_HXX
+
+#include <pthread.h>
+
+#include "bspf.hxx"
+#include "LockFreeQueue.hxx"
+
+/**
+  This class records the sound output to 16-bit PCM WAV files: the final
+  mixed stereo output, and optionally each TIA channel on its own (a
+  'stem') in mono.
+
+  The samples are handed over to a background thread that does all the
+  file writing, through a bounded lock-free queue.  Capturing never waits
+  for the disk; if the writer falls too far behind, samples are dropped
+  instead (and counted).  The writer sleeps while there's nothing to do.
+
+  It's only available when Stella is compiled with AUDIO_CAPTURE_SUPPORT.
+
+  @author  Stella Team
+  @version $Id$
+*/
+class AudioCapture
+{
+  public:
+    // The files that are written
+    enum Track {
+      MIXED,     // the final output, in stereo
+      CHANNEL0,  // TIA channel 0 alone, in mono
+      CHANNEL1,  // TIA channel 1 alone, in mono
+      NUM_TRACKS
+    };
+
+    /**
+      Create the WAV files and start the thread writing them.  The mixed
+      output is written to <base>.wav, and the channels (if requested) to
+      <base>.tia0.wav and <base>.tia1.wav.
+
+      @param base       The path and name of the files, without extension
+      @param frequency  The sample rate of the sound
+      @param channels   Whether to write each TIA channel as well
+    */
+    AudioCapture(const string& base, uInt32 frequency, bool channels);
+
+    /**
+      Write out everything still queued, finish the files and stop the
+      thread.
+    */
+    virtual ~AudioCapture();
+
+  public:
+    /**
+      Answers whether the files could be created.
+    */
+    bool isOpen() const { return myFile[MIXED] != 0; }
+
+    /**
+      Answers whether each TIA channel is captured as well.
+    */
+    bool capturesChannels() const { return myFile[CHANNEL0] != 0; }
+
+    /**
+      Queue samples to be written to the given track.  This never blocks.
+
+      @param track    The track to write to
+      @param samples  The samples, interleaved left/right for MIXED
+      @param length   The number of samples (pairs of them for MIXED)
+    */
+    void write(Track track, const Int16* samples, uInt32 length);
+
+    /**
+      Answers the number of samples that had to be dropped so far,
+      because the writer thread couldn't keep up.
+    */
+    uInt64 dropped() const { return myDropped; }
+
+  private:
+    /**
+      Write a WAV header for the given amount of sample data.
+    */
+    void writeHeader(FILE* file, uInt16 channels, uInt32 dataSize);
+
+    /**
+      The writer thread, which empties the queue until it sees the block
+      marking the end of the capture.
+    */
+    void run();
+    static void* threadMain(void* capture);
+
+  private:
+    enum {
+      BLOCK_SIZE = 1024,  // the most 16-bit values passed in one block
+      NUM_BLOCKS = 256    // the number of blocks that can be queued
+    };
+
+    // A piece of one track, passed to the writer thread
+    struct Block
+    {
+      uInt8 track;    // NUM_TRACKS marks the end of the capture
+      uInt16 length;  // the number of values in data
+      Int16 data[BLOCK_SIZE];
+    };
+
+    FILE* myFile[NUM_TRACKS];
+    uInt32 myDataSize[NUM_TRACKS];
+    uInt32 myFrequency;
+
+    // The blocks on their way to the writer thread
+    Common::LockFreeQueue<Block, NUM_BLOCKS> myQueue;
+
+    // The block being filled for write(), before it's queued
+    Block myBlock;
+
+    uInt64 myDropped;
+
+    pthread_t myThread;
+    bool myThreadStarted;
+
+    // What the writer thread sleeps on while the queue is empty
+    pthread_mutex_t myMutex;
+    pthread_cond_t myCondition;
+
+  private:
+    // Copy constructor isn't supported by this class so make it private
+    AudioCapture(const AudioCapture&);
+
+    // Assignment operator isn't supported by this class so make it private
+    AudioCapture& operator = (const AudioCapture&);
+};
+
+#endif
+
+#endif  // AUDIO_CAPTURE_SUPPORT
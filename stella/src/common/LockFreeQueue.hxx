@@ -0,0 +1,186 @@
+//============================================================================
+//
+//   SSSS    tt          lll  lll
+//  SS  SS   tt           ll   ll
+//  SS     tttttt  eeee   ll   ll   aaaa
+//   SSSS    tt   ee  ee  ll   ll      aa
+//      SS   tt   eeeeee  ll   ll   aaaaa  --  "An Atari 2600 VCS Emulator"
+//  SS  SS   tt   ee      ll   ll  aa  aa
+//   SSSS     ttt  eeeee llll llll  aaaaa
+//
+// Copyright (c) 1995-2014 by Bradford W. Mott, Stephen Anthony
+// and the Stella Team
+//
+// See the file "License.txt" for information on usage and redistribution of
+// this file, and for a DISCLAIMER OF ALL WARRANTIES.
+//
+// $Id$
+//============================================================================
+
+#ifndef LOCK_FREE_QUEUE_HXX
+#define LOCK_FREE_QUEUE_HXX
+
+#include <cassert>
+
+#include "bspf.hxx"
+
+#if defined(_MSC_VER)
+  #include <intrin.h>
+#endif
+
+// The __atomic builtins only came with GCC 4.7; older ones (still used
+// for some consoles) only have the __sync full barrier
+#if defined(__GNUC__) && !defined(__clang__) && \
+    (__GNUC__ < 4 || (__GNUC__ == 4 && __GNUC_MINOR__ < 7))
+  #define LOCK_FREE_QUEUE_SYNC_BARRIER
+#endif
+
+namespace Common {
+
+/**
+  A fixed capacity queue for passing items from one thread (the producer)
+  to another (the consumer) without locks or memory allocation.
+
+  Only the producer may call push(), and only the consumer may call
+  front(), at() and pop().  size() and empty() may be called by either,
+  but are only a snapshot when called by the other thread.  clear() may
+  only be called while neither thread uses the queue; anything else that
+  has to reach the other side, such as resetting it, has to be passed
+  through the queue itself.
+
+  The capacity must be a power of two.  Head and tail are free running
+  counters, so the queue holds exactly CAPACITY items when full.
+
+  @author  Stella Team
+  @version $Id$
+*/
+template <class T, uInt32 CAPACITY>
+class LockFreeQueue
+{
+  public:
+    LockFreeQueue() : myHead(0), myTail(0) { }
+
+  public:
+    /**
+      Remove all items from the queue.
+    */
+    void clear() { myHead = myTail = 0; }
+
+    /**
+      Answers the number of items currently in the queue.
+    */
+    uInt32 size() const { return load(myTail) - load(myHead); }
+
+    /**
+      Answers whether the queue is currently empty.
+    */
+    bool empty() const { return size() == 0; }
+
+    /**
+      Add an item to the end of the queue (producer only).
+
+      @param item  The item to add
+      @return  False if the queue was full and the item was dropped
+    */
+    bool push(const T& item)
+    {
+      uInt32 tail = myTail;
+      if(tail - load(myHead) == CAPACITY)
+        return false;
+
+      myBuffer[tail & MASK] = item;
+      store(myTail, tail + 1);  // publish the item only once it's written
+      return true;
+    }
+
+    /**
+      Return the item at the front of the queue (consumer only).  The
+      consumer may change it, the producer never touches it.
+    */
+    T& front()
+    {
+      assert(!empty());
+      return myBuffer[myHead & MASK];
+    }
+
+    /**
+      Return the item the given number of places behind the front of the
+      queue (consumer only), which must be less than size().
+    */
+    const T& at(uInt32 index) const
+    {
+      assert(index < size());
+      return myBuffer[(myHead + index) & MASK];
+    }
+
+    /**
+      Remove the item at the front of the queue (consumer only).
+    */
+    void pop()
+    {
+      assert(!empty());
+      store(myHead, myHead + 1);  // release the slot only once it's read
+    }
+
+  private:
+    enum { MASK = CAPACITY - 1 };
+    typedef char CapacityMustBePowerOfTwo[(CAPACITY & MASK) == 0 ? 1 : -1];
+
+    // Read a counter written by the other thread, making everything it
+    // wrote before the counter visible too
+    static uInt32 load(const volatile uInt32& counter)
+    {
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+      // x86 never moves loads ahead of older loads or stores ahead of
+      // older stores, so only the compiler has to be kept from it
+      uInt32 value = counter;
+      _ReadWriteBarrier();
+      return value;
+#elif defined(_MSC_VER)
+      // Other CPUs (ARM) need a real barrier, which the interlocked
+      // operations are
+      return (uInt32)_InterlockedOr((volatile long*)&counter, 0);
+#elif defined(LOCK_FREE_QUEUE_SYNC_BARRIER)
+      uInt32 value = counter;
+      __sync_synchronize();
+      return value;
+#else
+      return __atomic_load_n(&counter, __ATOMIC_ACQUIRE);
+#endif
+    }
+
+    // Write a counter read by the other thread, after everything written
+    // before it
+    static void store(volatile uInt32& counter, uInt32 value)
+    {
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+      _ReadWriteBarrier();
+      counter = value;
+#elif defined(_MSC_VER)
+      _InterlockedExchange((volatile long*)&counter, (long)value);
+#elif defined(LOCK_FREE_QUEUE_SYNC_BARRIER)
+      __sync_synchronize();
+      counter = value;
+#else
+      __atomic_store_n(&counter, value, __ATOMIC_RELEASE);
+#endif
+    }
+
+    // Don't allow copying, the threads hold on to the queue itself
+    LockFreeQueue(const LockFreeQueue&);
+    LockFreeQueue& operator=(const LockFreeQueue&);
+
+  private:
+    T myBuffer[CAPACITY];
+
+    // The number of items ever removed (only written by the consumer)
+    // and added (only written by the producer), on separate cache lines
+    // so the two threads don't fight over them
+    volatile uInt32 myHead;
+    uInt8 myPadding[64 - sizeof(uInt32)];
+    volatile uInt32 myTail;
+};
+
+}  // Namespace Common
+
+#endif
@@ -115,6 +115,20 @@ class SoundNull : public Sound
     */
     void set(uInt16 addr, uInt8 value, Int32 cycle) { }
 
+    /**
+      Sets the cartridge whose own music is mixed into the sound output.
+
+      @param cart The cartridge, or 0 for none
+    */
+    void setMusicCart(Cartridge* cart) { }
+
+    /**
+      Enables or disables skipping the sound.
+
+      @param state True to skip the sound, false to generate it again
+    */
+    void setSkipping(bool state) { }
+
     /**
       Sets the volume of the sound device to the specified level.  The
       volume is given as a percentage from 0 to 100.  Values outside
@@ -141,9 +155,9 @@ class SoundNull : public Sound
     */
     bool save(Serializer& out) const
     {
-      out.putString("TIASound");
+      out.putTag(name());
 
-      for(int = 0; i < 6; ++i)
+      for(int i = 0; i < 6; ++i)
         out.putByte(0);
 
       // myLastRegisterSetCycle
@@ -160,11 +174,11 @@ class SoundNull : public Sound
     */
     bool load(Serializer& in)
     {
-      if(in.getString() != "TIASound")
+      if(!in.checkTag(name()))
         return false;
 
       // Read sound registers and discard
-      for(int = 0; i < 6; ++i)
+      for(int i = 0; i < 6; ++i)
         in.getByte();
 
       // myLastRegisterSetCycle
@@ -30,6 +30,7 @@
 #include "System.hxx"
 #include "OSystem.hxx"
 #include "Console.hxx"
+#include "Cart.hxx"
 #include "SoundSDL.hxx"
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -38,11 +39,29 @@ SoundSDL::SoundSDL(OSystem* osystem)
     myIsEnabled(false),
     myIsInitializedFlag(false),
     myLastRegisterSetCycle(0),
+    myOverrunClocks(0),
     myNumChannels(0),
+    myFrequency(31400),
+    myFragmentRemainder(0),
+    myCycleRemainder(0),
+    myIsSkipping(false),
+    mySkipClocks(0),
+    myPendingRegisters(0),
+    myPendingClocks(0),
+    myResetPending(false),
     myFragmentSizeLogBase2(0),
     myIsMuted(true),
-    myVolume(100)
+    myVolume(100),
+    myIdleClocks(0),
+    myMusicCart(0),
+    myMusicMixed(false)
+#ifdef AUDIO_CAPTURE_SUPPORT
+  , myCapture(0),
+    myChannelBuffer(0),
+    myChannelBufferSize(0)
+#endif
 {
+  memset(myRegisters, 0, sizeof(myRegisters));
 
   // The sound system is opened only once per program run, to eliminate
   // issues with opening and closing it multiple times
@@ -98,6 +117,10 @@ SoundSDL::~SoundSDL()
     //SDL_CloseAudio();
     myIsEnabled = myIsInitializedFlag = false;
   }
+
+#ifdef AUDIO_CAPTURE_SUPPORT
+  delete[] myChannelBuffer;
+#endif
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -117,7 +140,12 @@ void SoundSDL::open()
   }
 
   // Now initialize the TIASound object which will actually generate sound
-  myTIASound.outputFrequency(31400);
+  myFrequency = myOSystem->settings().getInt("freq");
+  if(myFrequency == 0)
+    myFrequency = 31400;
+  myFragmentRemainder = 0;
+  myCycleRemainder = 0;
+  myTIASound.outputFrequency(myFrequency);
   const string& chanResult =
       myTIASound.channels(2, myNumChannels == 2);
 
@@ -130,7 +158,7 @@ void SoundSDL::open()
   buf << "Sound enabled:"  << endl
       << "  Volume:      " << (int)myVolume << endl
       << "  Frag size:   " << (int)512 << endl
-      << "  Frequency:   " << (int)31400 << endl
+      << "  Frequency:   " << (int)myFrequency << endl
       << "  Channels:    " << (int)2
                            << " (" << chanResult << ")" << endl
       << endl;
@@ -152,9 +180,7 @@ void SoundSDL::close()
   {
     myIsEnabled = false;
     //SDL_PauseAudio(1);
-    myLastRegisterSetCycle = 0;
-    myTIASound.reset();
-    myRegWriteQueue.clear();
+    queueReset();
   }
 }
 
@@ -174,9 +200,7 @@ void SoundSDL::reset()
   if(myIsInitializedFlag)
   {
     //SDL_PauseAudio(1);
-    myLastRegisterSetCycle = 0;
-    myTIASound.reset();
-    myRegWriteQueue.clear();
+    queueReset();
     mute(myIsMuted);
   }
 }
@@ -190,6 +214,10 @@ void SoundSDL::setVolume(Int32 percent)
     //SDL_LockAudio();
     myVolume = percent;
     myTIASound.volume(percent);
+#ifdef AUDIO_CAPTURE_SUPPORT
+    myChannelSound[0].volume(percent);
+    myChannelSound[1].volume(percent);
+#endif
     //SDL_UnlockAudio();
   }
 }
@@ -223,7 +251,11 @@ void SoundSDL::adjustVolume(Int8 direction)
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void SoundSDL::adjustCycleCounter(Int32 amount)
 {
+  syncIdleClocks();
   myLastRegisterSetCycle += amount;
+
+  // This happens at the start of every frame
+  queueMusic();
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -247,20 +279,24 @@ void SoundSDL::set(uInt16 addr, uInt8 value, Int32 cycle)
 {
   //SDL_LockAudio();
 
-  // First, calculate how many seconds would have past since the last
-  // register write on a real 2600
-  double delta = (((double)(cycle - myLastRegisterSetCycle)) / 
-      (1193191.66666667));
+  syncIdleClocks();
 
-  // Now, adjust the time based on the frame rate the user has selected. For
-  // the sound to "scale" correctly, we have to know the games real frame 
-  // rate (e.g., 50 or 60) and the currently emulated frame rate. We use these
-  // values to "scale" the time before the register change occurs.
-  RegWrite info;
-  info.addr = addr;
-  info.value = value;
-  info.delta = delta;
-  myRegWriteQueue.enqueue(info);
+  // First, calculate how many color clocks have past since the last
+  // register write, less those the sound output already went past it
+  Int32 delta = (cycle - myLastRegisterSetCycle) * 3 - (Int32)myOverrunClocks;
+  myOverrunClocks = 0;
+
+  // A write that happened before the end of the sound already generated
+  // takes effect right away
+  if(delta < 0)
+    delta = 0;
+
+  // The write is queued right away, unless the queue is full or the
+  // sound is skipped; then only the last value of each register is kept
+  myRegisters[addr - 0x15] = value;
+  myPendingRegisters |= 1 << (addr - 0x15);
+  myPendingClocks += (uInt32)delta;
+  queuePendingWrites();
 
   // Update last cycle counter to the current cycle
   myLastRegisterSetCycle = cycle;
@@ -268,6 +304,175 @@ void SoundSDL::set(uInt16 addr, uInt8 value, Int32 cycle)
   //SDL_UnlockAudio();
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void SoundSDL::queuePendingWrites()
+{
+  if(myIsSkipping)
+    return;
+
+  RegWrite info;
+  if(myResetPending)
+  {
+    info.addr = RESET_ADDR;
+    info.value = 0;
+    info.delta = myPendingClocks;
+    if(!myRegWriteQueue.push(info))
+      return;
+    myPendingClocks = 0;
+    myResetPending = false;
+  }
+
+  for(uInt32 i = 0; myPendingRegisters != 0; ++i)
+  {
+    if(!(myPendingRegisters & (1 << i)))
+      continue;
+
+    info.addr = 0x15 + i;
+    info.value = myRegisters[i];
+    info.delta = myPendingClocks;
+
+    // While the cart synthesizes the music itself, AUDV0 would only repeat it
+    if(info.addr == 0x19 && myMusicCart && myMusicCart->musicPlaying())
+      info.value = 0;
+
+    // Once the queue is full, the rest stays pending until the next write
+    if(!myRegWriteQueue.push(info))
+      return;
+    myPendingClocks = 0;
+    myPendingRegisters &= ~(1 << i);
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void SoundSDL::queueReset()
+{
+  myLastRegisterSetCycle = 0;
+  myOverrunClocks = 0;
+  myCycleRemainder = 0;
+
+  // Idle clocks reported for the writes before the reset don't matter
+  // anymore; the sound generation resets everything else when it gets
+  // to the reset in the queue
+  while(!myIdleQueue.empty())
+    myIdleQueue.pop();
+
+  memset(myRegisters, 0, sizeof(myRegisters));
+  myPendingRegisters = 0;
+  myPendingClocks = 0;
+  myResetPending = true;
+  queuePendingWrites();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void SoundSDL::queueMusic()
+{
+  if(!myMusicCart)
+    return;
+
+  // The cart's levels are taken even when they're thrown away, so that
+  // they never pile up
+  const uInt8* levels;
+  uInt32 count = myMusicCart->musicLevels(levels);
+  if(myIsSkipping)
+    return;
+
+  for(uInt32 i = 0; i < count; ++i)
+    if(!myMusicLevels.push(levels[i]))
+      break;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void SoundSDL::mixMusic(Int16* stream, uInt32 length)
+{
+  uInt32 count = myMusicLevels.size();
+  if(length == 0 || (count == 0 && !myMusicMixed))
+    return;
+
+  // Levels that piled up while nothing was generated would all be
+  // squeezed into this fragment, so only the newest ones are played
+  uInt32 expected = (uInt32)((uInt64)length * MUSIC_CLOCKS_PER_SECOND /
+                             myFrequency) + 1;
+  for(; count > expected * 2; --count)
+    myMusicLevels.pop();
+
+  // There's one level for each 20 kHz music OSC clock, which are spread
+  // evenly over the fragment, and each is played like AUDV0 of a TIA
+  // channel in constant output mode (so on the left in stereo mode).
+  // Just like the TIA sound, every change of the level is a band-limited
+  // step, positioned to a fraction of a sample; level j is at j * length /
+  // count samples, which is at or before sample i when j * length <
+  // i * count.  Without any levels, the music steps back to silence.
+  const uInt32 channels = 2;
+  Int32 scale = (1 << 10) * myVolume / 100;
+  if(count == 0)
+    myMusicBlep.setLevel(0, 0);
+
+  uInt32 level = 0;
+  for(uInt32 i = 0; i <= length; ++i)
+  {
+    for(; level < count && (uInt64)level * length < (uInt64)i * count; ++level)
+    {
+      uInt32 phase = (uInt32)(((uInt64)level * length + count -
+                               (uInt64)i * count) * BlepSynth::PHASES / count);
+      myMusicBlep.setLevel(phase, myMusicLevels.at(level) * scale);
+    }
+    if(i == length)
+      break;
+
+    Int32 sample = myMusicBlep.read();
+    stream[i * channels] = BSPF_max(BSPF_min(stream[i * channels] + sample, 32767), -32768);
+    if(myNumChannels != 2)
+      stream[i * channels + 1] = BSPF_max(BSPF_min(stream[i * channels + 1] + sample, 32767), -32768);
+  }
+
+  for(uInt32 i = 0; i < count; ++i)
+    myMusicLevels.pop();
+  myMusicMixed = count > 0;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+inline void SoundSDL::applyWrite(uInt16 addr, uInt8 value)
+{
+  if(addr == RESET_ADDR)
+  {
+    myTIASound.reset();
+    myMusicBlep.reset();
+    myMusicMixed = false;
+    mySkipClocks = 0;
+#ifdef AUDIO_CAPTURE_SUPPORT
+    if(myCapture && myCapture->capturesChannels())
+      resetChannelSounds();
+#endif
+    return;
+  }
+
+  myTIASound.set(addr, value);
+
+#ifdef AUDIO_CAPTURE_SUPPORT
+  // Each channel on its own doesn't hear the volume of the other one
+  if(myCapture && myCapture->capturesChannels())
+  {
+    myChannelSound[0].set(addr, addr == 0x1a ? 0 : value);
+    myChannelSound[1].set(addr, addr == 0x19 ? 0 : value);
+  }
+#endif
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+inline void SoundSDL::generate(Int16* stream, uInt32 sample, uInt32 length)
+{
+  myTIASound.process(stream + (sample * 2), length);
+
+#ifdef AUDIO_CAPTURE_SUPPORT
+  if(myCapture && myCapture->capturesChannels())
+  {
+    myChannelSound[0].process(myChannelBuffer + sample, length);
+    myChannelSound[1].process(myChannelBuffer + myChannelBufferSize + sample,
+                              length);
+  }
+#endif
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void SoundSDL::processFragment(Int16* stream, uInt32 length)
 {
@@ -287,40 +492,36 @@ void SoundSDL::processFragment(Int16* stream, uInt32 length)
 //    }
 //  }
     
-    const uInt32 channels = 2;
-    // If there are excessive items on the queue then we'll remove some
-    //logMsg("sound duration %f", myRegWriteQueue.duration());
-    double streamLengthInSecs = (double)length/(double)31400;
-    double excessStreamSecs = myRegWriteQueue.duration() - streamLengthInSecs;
-    if(excessStreamSecs > 0.0)
-    {
-        double removed = 0.0;
-        while(removed < excessStreamSecs)
-        {
-            RegWrite& info = myRegWriteQueue.front();
-            removed += info.delta;
-            myTIASound.set(info.addr, info.value);
-            myRegWriteQueue.dequeue();
-        }
-    }
+  uInt64 streamClocks = fragmentClocks(length);
+
+#ifdef AUDIO_CAPTURE_SUPPORT
+  // Make room for each channel on its own
+  if(myCapture && myCapture->capturesChannels() && myChannelBufferSize < length)
+  {
+    delete[] myChannelBuffer;
+    myChannelBufferSize = length;
+    myChannelBuffer = new Int16[myChannelBufferSize * 2];
+  }
+#endif
+
+  takeExcessWrites(streamClocks);
 
-  double position = 0.0;
-  double remaining = length;
+  // Everything is counted in color clocks from the start of the fragment,
+  // and each register write takes effect at the first sample boundary at
+  // or after the time it was made
+  uInt32 position = 0, sample = 0;
 
-  while(remaining > 0.0)
+  for(;;)
   {
-    if(myRegWriteQueue.size() == 0)
+    if(myRegWriteQueue.empty())
     {
       // There are no more pending TIA sound register updates so we'll
       // use the current settings to finish filling the sound fragment
-      myTIASound.process(stream + ((uInt32)position * channels),
-          length - (uInt32)position);
-
-      // Since we had to fill the fragment we'll reset the cycle counter
-      // to zero.  NOTE: This isn't 100% correct, however, it'll do for
-      // now.  We should really remember the overrun and remove it from
-      // the delta of the next write.
-      myLastRegisterSetCycle = 0;
+      generate(stream, sample, length - sample);
+
+      // The next write will be timed from the last one, so tell the
+      // emulation how far past that the fragment went
+      addIdleClocks((uInt32)streamClocks - position);
       break;
     }
     else
@@ -329,41 +530,51 @@ void SoundSDL::processFragment(Int16* stream, uInt32 length)
       // update the sound buffer to the point of the next register update
       RegWrite& info = myRegWriteQueue.front();
 
-      // How long will the remaining samples in the fragment take to play
-      double duration = remaining / (double)31400;
-
       // Does the register update occur before the end of the fragment?
-      if(info.delta <= duration)
+      if(info.delta <= streamClocks - position)
       {
-        // If the register update time hasn't already passed then
-        // process samples upto the point where it should occur
-        if(info.delta > 0.0)
+        // Process the fragment upto the sample boundary where the next
+        // TIA register write occurs
+        position += info.delta;
+        uInt32 next = (uInt32)(((uInt64)position * myFrequency +
+                                CLOCKS_PER_SECOND - 1) / CLOCKS_PER_SECOND);
+        if(next > length)
+          next = length;
+        if(next > sample)
         {
-          // Process the fragment upto the next TIA register write.  We
-          // round the count passed to process up if needed.
-          double samples = (31400 * info.delta);
-          myTIASound.process(stream + ((uInt32)position * channels),
-              (uInt32)samples + (uInt32)(position + samples) - 
-              ((uInt32)position + (uInt32)samples));
-
-          position += samples;
-          remaining -= samples;
+          generate(stream, sample, next - sample);
+          sample = next;
         }
-        myTIASound.set(info.addr, info.value);
-        myRegWriteQueue.dequeue();
+        applyWrite(info.addr, info.value);
+        myRegWriteQueue.pop();
       }
       else
       {
         // The next register update occurs in the next fragment so finish
         // this fragment with the current TIA settings and reduce the register
         // update delay by the corresponding amount of time
-        myTIASound.process(stream + ((uInt32)position * channels),
-            length - (uInt32)position);
-        info.delta -= duration;
+        generate(stream, sample, length - sample);
+        info.delta -= (uInt32)streamClocks - position;
         break;
       }
     }
   }
+
+  if(myMusicCart)
+    mixMusic(stream, length);
+
+#ifdef AUDIO_CAPTURE_SUPPORT
+  if(myCapture)
+  {
+    myCapture->write(AudioCapture::MIXED, stream, length);
+    if(myCapture->capturesChannels())
+    {
+      myCapture->write(AudioCapture::CHANNEL0, myChannelBuffer, length);
+      myCapture->write(AudioCapture::CHANNEL1,
+                       myChannelBuffer + myChannelBufferSize, length);
+    }
+  }
+#endif
     
 //    double position = 0.0;
 //    double remaining = length;
@@ -419,6 +630,119 @@ void SoundSDL::processFragment(Int16* stream, uInt32 length)
 //    }
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void SoundSDL::takeExcessWrites(uInt64 clocks)
+{
+  // If there are excessive items on the queue then we'll remove some,
+  // shortening the queue by exactly the excess so that the last write
+  // still ends up at the end of the fragment
+  uInt64 duration = queueDuration();
+  if(duration > clocks)
+  {
+    uInt64 excess = duration - clocks;
+    while(!myRegWriteQueue.empty() && myRegWriteQueue.front().delta <= excess)
+    {
+      RegWrite& info = myRegWriteQueue.front();
+      excess -= info.delta;
+      applyWrite(info.addr, info.value);
+      myRegWriteQueue.pop();
+    }
+    if(!myRegWriteQueue.empty())
+      myRegWriteQueue.front().delta -= (uInt32)excess;
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+uInt64 SoundSDL::fragmentClocks(uInt32 length)
+{
+  // The fragment only lasts a whole number of color clocks at 31400Hz,
+  // otherwise the rest is carried over to the next one
+  uInt64 scaled = (uInt64)length * CLOCKS_PER_SECOND + myFragmentRemainder;
+  myFragmentRemainder = (uInt32)(scaled % myFrequency);
+
+  return scaled / myFrequency;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+uInt32 SoundSDL::samplesForCycles(uInt32 cycles)
+{
+  uInt64 scaled = (uInt64)cycles * 3 * myFrequency + myCycleRemainder;
+  myCycleRemainder = (uInt32)(scaled % CLOCKS_PER_SECOND);
+
+  return (uInt32)(scaled / CLOCKS_PER_SECOND);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void SoundSDL::setSkipping(bool state)
+{
+  if(state == myIsSkipping)
+    return;
+
+  myIsSkipping = state;
+
+  // However long the sound was skipped, the registers written meanwhile
+  // take effect right away
+  if(!myIsSkipping)
+  {
+    myPendingClocks = 0;
+    queuePendingWrites();
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void SoundSDL::skipFragment(uInt32 length)
+{
+  uInt64 streamClocks = fragmentClocks(length);
+  takeExcessWrites(streamClocks);
+
+  // The same as processFragment(), only counting color clocks and
+  // skipping the samples up to each register write
+  uInt32 position = 0;
+  while(!myRegWriteQueue.empty() &&
+        myRegWriteQueue.front().delta <= streamClocks - position)
+  {
+    RegWrite& info = myRegWriteQueue.front();
+    position += info.delta;
+    skipClocks(info.delta);
+    applyWrite(info.addr, info.value);
+    myRegWriteQueue.pop();
+  }
+
+  uInt32 rest = (uInt32)streamClocks - position;
+  if(myRegWriteQueue.empty())
+    addIdleClocks(rest);
+  else
+    myRegWriteQueue.front().delta -= rest;
+  skipClocks(rest);
+
+  // Nobody hears the music either
+  while(!myMusicLevels.empty())
+    myMusicLevels.pop();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void SoundSDL::skipClocks(uInt32 clocks)
+{
+  const Int32 clocksPerSample = CLOCKS_PER_SECOND / 31400;
+
+  // Like in processFragment(), a write takes effect at the first sample
+  // that starts at or after it
+  mySkipClocks += clocks;
+  if(mySkipClocks > 0)
+  {
+    uInt32 samples = (mySkipClocks + clocksPerSample - 1) / clocksPerSample;
+    myTIASound.skip(samples);
+#ifdef AUDIO_CAPTURE_SUPPORT
+    if(myCapture && myCapture->capturesChannels())
+    {
+      myChannelSound[0].skip(samples);
+      myChannelSound[1].skip(samples);
+    }
+#endif
+    mySkipClocks -= (Int32)samples * clocksPerSample;
+  }
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void SoundSDL::callback(void* udata, uInt8* stream, int len)
 {
@@ -437,19 +761,19 @@ bool SoundSDL::save(Serializer& out) const
 {
   try
   {
-    out.putString(name());
+    out.putTag(name());
 
     uInt8 reg1 = 0, reg2 = 0, reg3 = 0, reg4 = 0, reg5 = 0, reg6 = 0;
 
     // Only get the TIA sound registers if sound is enabled
     if(myIsInitializedFlag)
     {
-      reg1 = myTIASound.get(0x15);
-      reg2 = myTIASound.get(0x16);
-      reg3 = myTIASound.get(0x17);
-      reg4 = myTIASound.get(0x18);
-      reg5 = myTIASound.get(0x19);
-      reg6 = myTIASound.get(0x1a);
+      reg1 = myRegisters[0];
+      reg2 = myRegisters[1];
+      reg3 = myRegisters[2];
+      reg4 = myRegisters[3];
+      reg5 = myRegisters[4];
+      reg6 = myRegisters[5];
     }
 
     out.putByte(reg1);
@@ -474,7 +798,7 @@ bool SoundSDL::load(Serializer& in)
 {
   try
   {
-    if(in.getString() != name())
+    if(!in.checkTag(name()))
       return false;
 
     uInt8 reg1 = in.getByte(),
@@ -484,22 +808,27 @@ bool SoundSDL::load(Serializer& in)
           reg5 = in.getByte(),
           reg6 = in.getByte();
 
-    myLastRegisterSetCycle = (Int32) in.getInt();
+    Int32 cycle = (Int32) in.getInt();
 
     // Only update the TIA sound registers if sound is enabled
-    // Make sure to empty the queue of previous sound fragments
+    // The sound generation starts over with them, after the writes
+    // already queued
     if(myIsInitializedFlag)
     {
       //SDL_PauseAudio(1);
-      myRegWriteQueue.clear();
-      myTIASound.set(0x15, reg1);
-      myTIASound.set(0x16, reg2);
-      myTIASound.set(0x17, reg3);
-      myTIASound.set(0x18, reg4);
-      myTIASound.set(0x19, reg5);
-      myTIASound.set(0x1a, reg6);
+      queueReset();
+      myRegisters[0] = reg1;
+      myRegisters[1] = reg2;
+      myRegisters[2] = reg3;
+      myRegisters[3] = reg4;
+      myRegisters[4] = reg5;
+      myRegisters[5] = reg6;
+      myPendingRegisters = 0x3f;
+      queuePendingWrites();
       //if(!myIsMuted) SDL_PauseAudio(0);
     }
+    myLastRegisterSetCycle = cycle;
+    myOverrunClocks = 0;
   }
   catch(...)
   {
@@ -509,89 +838,67 @@ bool SoundSDL::load(Serializer& in)
   return true;
 }
 
+#ifdef AUDIO_CAPTURE_SUPPORT
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-SoundSDL::RegWriteQueue::RegWriteQueue(uInt32 capacity)
-  : myCapacity(capacity),
-    myBuffer(0),
-    mySize(0),
-    myHead(0),
-    myTail(0)
+void SoundSDL::setCapture(AudioCapture* capture)
 {
-  myBuffer = new RegWrite[myCapacity];
+  myCapture = capture;
+  if(myCapture && myCapture->capturesChannels())
+    resetChannelSounds();
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-SoundSDL::RegWriteQueue::~RegWriteQueue()
+void SoundSDL::resetChannelSounds()
 {
-  delete[] myBuffer;
-}
-
-// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-void SoundSDL::RegWriteQueue::clear()
-{
-  myHead = myTail = mySize = 0;
-}
-
-// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-void SoundSDL::RegWriteQueue::dequeue()
-{
-  if(mySize > 0)
+  // Each channel starts out with the registers as they are now
+  for(int i = 0; i < 2; ++i)
   {
-    myHead = (myHead + 1) % myCapacity;
-    --mySize;
+    myChannelSound[i].reset();
+    myChannelSound[i].outputFrequency(myFrequency);
+    myChannelSound[i].channels(1, false);
+    myChannelSound[i].volume(myVolume);
   }
-}
-
-// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-double SoundSDL::RegWriteQueue::duration()
-{
-  double duration = 0.0;
-  for(uInt32 i = 0; i < mySize; ++i)
+  for(uInt16 addr = 0x15; addr <= 0x1a; ++addr)
   {
-    duration += myBuffer[(myHead + i) % myCapacity].delta;
+    uInt8 value = myTIASound.get(addr);
+    myChannelSound[0].set(addr, addr == 0x1a ? 0 : value);
+    myChannelSound[1].set(addr, addr == 0x19 ? 0 : value);
   }
-  return duration;
 }
+#endif
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-void SoundSDL::RegWriteQueue::enqueue(const RegWrite& info)
+uInt64 SoundSDL::queueDuration() const
 {
-  // If an attempt is made to enqueue more than the queue can hold then
-  // we'll enlarge the queue's capacity.
-  if(mySize == myCapacity)
-    grow();
-
-  myBuffer[myTail] = info;
-  myTail = (myTail + 1) % myCapacity;
-  ++mySize;
-}
+  uInt64 duration = 0;
+  for(uInt32 i = 0; i < myRegWriteQueue.size(); ++i)
+    duration += myRegWriteQueue.at(i).delta;
 
-// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-SoundSDL::RegWrite& SoundSDL::RegWriteQueue::front()
-{
-  assert(mySize != 0);
-  return myBuffer[myHead];
+  return duration;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-uInt32 SoundSDL::RegWriteQueue::size() const
+void SoundSDL::addIdleClocks(uInt32 clocks)
 {
-  return mySize;
+  // If the emulation hasn't caught up with the earlier ones (it may be
+  // paused), they're added up until there is room again
+  myIdleClocks += clocks;
+  if(myIdleQueue.push(myIdleClocks))
+    myIdleClocks = 0;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-void SoundSDL::RegWriteQueue::grow()
+void SoundSDL::syncIdleClocks()
 {
-  RegWrite* buffer = new RegWrite[myCapacity * 2];
-  for(uInt32 i = 0; i < mySize; ++i)
+  // Keep only the part of a CPU cycle in the remainder
+  uInt32 overrun = myOverrunClocks;
+  while(!myIdleQueue.empty())
   {
-    buffer[i] = myBuffer[(myHead + i) % myCapacity];
+    overrun += myIdleQueue.front();
+    myIdleQueue.pop();
   }
-  myHead = 0;
-  myTail = mySize;
-  myCapacity = myCapacity * 2;
-  delete[] myBuffer;
-  myBuffer = buffer;
+  myLastRegisterSetCycle += overrun / 3;
+  myOverrunClocks = overrun % 3;
 }
 
 #endif  // SOUND_SUPPORT
@@ -27,6 +27,9 @@ class OSystem;
 //#include <SDL.h>
 
 #include "bspf.hxx"
+#include "AudioCapture.hxx"
+#include "BlepSynth.hxx"
+#include "LockFreeQueue.hxx"
 #include "TIASnd.hxx"
 #include "Sound.hxx"
 
@@ -118,6 +121,13 @@ class SoundSDL : public Sound
     */
     void set(uInt16 addr, uInt8 value, Int32 cycle);
 
+    /**
+      Sets the cartridge whose own music is mixed into the sound output.
+
+      @param cart  The cartridge, or 0 for none
+    */
+    void setMusicCart(Cartridge* cart) { myMusicCart = cart; }
+
     /**
       Sets the volume of the sound device to the specified level.  The
       volume is given as a percentage from 0 to 100.  Values outside
@@ -170,83 +180,178 @@ class SoundSDL : public Sound
     */
     void processFragment(Int16* stream, uInt32 length);
 
+    /**
+      Get the number of samples that the given number of CPU cycles of
+      emulation produce at the output frequency.  The part of a sample
+      left over is carried to the next call, so that over time exactly
+      as many samples are generated as have been emulated.
+
+      @param cycles  The number of CPU cycles emulated
+      @return  The length of the fragment for those cycles
+    */
+    uInt32 samplesForCycles(uInt32 cycles);
+
+    /**
+      Enables or disables skipping the sound on the emulation side, for
+      when no fragments are processed at all for a while (for instance
+      while frames are replayed to seek in a movie).  While skipping,
+      register writes only remember the last value of each register, and
+      the music levels of the cart are thrown away.  Once skipping ends,
+      the registers are queued to take effect right away.
+
+      @param state  True to skip the sound, false to queue it again
+    */
+    void setSkipping(bool state);
+
+    /**
+      Advance the sound by a fragment without generating it, for when
+      nobody listens to it (for instance while fast-forwarding).  This
+      takes the queued register writes just like processFragment() does,
+      and leaves the same TIA sound state.
+
+      @param length  Length of the fragment
+    */
+    void skipFragment(uInt32 length);
+
+#ifdef AUDIO_CAPTURE_SUPPORT
+    /**
+      Start or stop capturing the sound generated by processFragment().
+
+      @param capture  The capture to write to, or 0 to stop capturing
+    */
+    void setCapture(AudioCapture* capture);
+#endif
+
+  private:
+#ifdef AUDIO_CAPTURE_SUPPORT
+    /**
+      Reset the sound of each channel on its own, and set its registers
+      from the ones the output is generated with.
+    */
+    void resetChannelSounds();
+#endif
+
+    /**
+      Set a TIA sound register, for the output and for each channel on
+      its own when they are captured.
+    */
+    inline void applyWrite(uInt16 addr, uInt8 value);
+
+    /**
+      Generate the given part of the fragment, and of each channel on its
+      own when they are captured.
+
+      @param stream  Pointer to the start of the fragment
+      @param sample  The first sample to generate
+      @param length  The number of samples to generate
+    */
+    inline void generate(Int16* stream, uInt32 sample, uInt32 length);
+
+    /**
+      Queue the register values the emulation wrote which aren't queued
+      yet, after a reset of the sound generation if one is pending.  Only
+      called by the emulation; nothing is queued while skipping.
+    */
+    void queuePendingWrites();
+
+    /**
+      Reset the emulation side, and queue a reset of the sound generation
+      behind the writes already queued.  Only called by the emulation.
+    */
+    void queueReset();
+
+    /**
+      Pass the music levels the cart synthesized since the last call on to
+      the sound generation.  Only called by the emulation, at the start of
+      every frame.
+    */
+    void queueMusic();
+
+    /**
+      Take the register writes that are queued beyond the given fragment
+      length right away, so that the last one still ends up at the end of
+      the fragment.  Only called by the sound generation.
+
+      @param clocks  The color clocks the fragment lasts
+    */
+    void takeExcessWrites(uInt64 clocks);
+
+    /**
+      Get the number of color clocks the given fragment lasts, carrying
+      the remainder over to the next fragment.
+
+      @param length  Length of the fragment
+      @return  The whole number of color clocks
+    */
+    uInt64 fragmentClocks(uInt32 length);
+
+    /**
+      Skip the TIA sound ahead by the given number of color clocks, up
+      to the sample a register write there takes effect at.
+
+      @param clocks  The color clocks since the last register write
+    */
+    void skipClocks(uInt32 clocks);
+
+    /**
+      Get the color clocks all the register writes in the queue last.
+      Only called by the sound generation.
+    */
+    uInt64 queueDuration() const;
+
+    /**
+      Tell the emulation that the sound was generated the given number of
+      color clocks past the last register write.  Only called by the sound
+      generation.
+    */
+    void addIdleClocks(uInt32 clocks);
+
+    /**
+      Move the cycle the next register write is timed from past the idle
+      clocks the sound generation reported.  Only called by the emulation.
+    */
+    void syncIdleClocks();
+
+    /**
+      Mix the music levels queued since the last fragment into the given
+      fragment, band-limited like the TIA sound.  Only called by the sound
+      generation.
+
+      @param stream  Pointer to the start of the fragment
+      @param length  Length of the fragment
+    */
+    void mixMusic(Int16* stream, uInt32 length);
+
   protected:
     // Struct to hold information regarding a TIA sound register write
     struct RegWrite
     {
       uInt16 addr;
       uInt8 value;
-      double delta;
+      uInt32 delta;  // TIA color clocks since the previous write
     };
 
-    /**
-      A queue class used to hold TIA sound register writes before being
-      processed while creating a sound fragment.
-    */
-    class RegWriteQueue
-    {
-      public:
-        /**
-          Create a new queue instance with the specified initial
-          capacity.  If the queue ever reaches its capacity then it will
-          automatically increase its size.
-        */
-        RegWriteQueue(uInt32 capacity = 512);
-
-        /**
-          Destroy this queue instance.
-        */
-        virtual ~RegWriteQueue();
-
-      public:
-        /**
-          Clear any items stored in the queue.
-        */
-        void clear();
-
-        /**
-          Dequeue the first object in the queue.
-        */
-        void dequeue();
-
-        /**
-          Return the duration of all the items in the queue.
-        */
-        double duration();
-
-        /**
-          Enqueue the specified object.
-        */
-        void enqueue(const RegWrite& info);
-
-        /**
-          Return the item at the front on the queue.
-
-          @return  The item at the front of the queue.
-        */
-        RegWrite& front();
-
-        /**
-          Answers the number of items currently in the queue.
-
-          @return  The number of items in the queue.
-        */
-        uInt32 size() const;
-
-      private:
-        // Increase the size of the queue
-        void grow();
-
-      private:
-        uInt32 myCapacity;
-        RegWrite* myBuffer;
-        uInt32 mySize;
-        uInt32 myHead;
-        uInt32 myTail;
-    };
+    // The TIA generates one sound sample every 114 color clocks (twice
+    // per scanline) at a nominal 31400Hz, so that is the color clock rate
+    // all timing is done with
+    enum { CLOCKS_PER_SECOND = 114 * 31400 };
+
+    // A queue of TIA sound register writes, from the emulation to the
+    // sound generation, which may run on another thread
+    typedef Common::LockFreeQueue<RegWrite, 4096> RegWriteQueue;
+
+    // A write to this address resets the sound generation instead
+    enum { RESET_ADDR = 0xffff };
+
+    // A queue of the music levels synthesized by the cart (up to about six
+    // frames worth), from the emulation to the sound generation
+    typedef Common::LockFreeQueue<uInt8, 2048> MusicLevelQueue;
+
+    // The rate of the music OSC clock, which the cart makes a level for
+    enum { MUSIC_CLOCKS_PER_SECOND = 20000 };
 
   private:
-    // TIASound emulation object
+    // TIASound emulation object, only used by the sound generation
     TIASound myTIASound;
 
     // Indicates if the sound subsystem is to be initialized
@@ -258,9 +363,44 @@ class SoundSDL : public Sound
     // Indicates the cycle when a sound register was last set
     Int32 myLastRegisterSetCycle;
 
+    // The color clocks (0 - 2) past myLastRegisterSetCycle that the sound
+    // output had already been generated for when the write queue ran dry
+    uInt32 myOverrunClocks;
+
     // Indicates the number of channels (mono or stereo)
     uInt32 myNumChannels;
 
+    // The sample rate of the output
+    uInt32 myFrequency;
+
+    // The part of a color clock (in 1/myFrequency) that the fragments
+    // generated so far lasted beyond a whole number of clocks
+    uInt32 myFragmentRemainder;
+
+    // The part of a sample (in 1/CLOCKS_PER_SECOND) that the cycles
+    // emulated so far lasted beyond the samples asked for
+    uInt32 myCycleRemainder;
+
+    // Indicates if the emulation skips queueing the sound
+    bool myIsSkipping;
+
+    // The color clocks since the last sample skipped by skipFragment()
+    // (negative when the sample a register write took effect at is ahead)
+    Int32 mySkipClocks;
+
+    // The sound registers (AUDC0 - AUDV1) as last written by the emulation
+    uInt8 myRegisters[6];
+
+    // The registers (one bit each) written since they were last queued,
+    // because the queue was full or the sound was skipped
+    uInt8 myPendingRegisters;
+
+    // The color clocks from the last queued write to the pending ones
+    uInt32 myPendingClocks;
+
+    // Indicates a reset of the sound generation still has to be queued
+    bool myResetPending;
+
     // Log base 2 of the selected fragment size
     double myFragmentSizeLogBase2;
 
@@ -292,6 +432,39 @@ class SoundSDL : public Sound
     // Queue of TIA register writes
     RegWriteQueue myRegWriteQueue;
 
+    // The color clocks the sound went past the last register write each
+    // time the write queue ran dry, passed back the other way (see
+    // syncIdleClocks())
+    Common::LockFreeQueue<uInt32, 64> myIdleQueue;
+
+    // Idle color clocks that didn't fit into myIdleQueue yet
+    uInt32 myIdleClocks;
+
+    // The cartridge synthesizing its own music, if any
+    Cartridge* myMusicCart;
+
+    // The music levels of myMusicCart, collected by the emulation
+    MusicLevelQueue myMusicLevels;
+
+    // Band-limits the music levels at the output rate
+    BlepSynth myMusicBlep;
+
+    // Indicates the last fragment had music mixed into it, so that the
+    // output of myMusicBlep still has to return to silence
+    bool myMusicMixed;
+
+#ifdef AUDIO_CAPTURE_SUPPORT
+    // Where the sound is captured to, if anywhere
+    AudioCapture* myCapture;
+
+    // Each TIA channel on its own, when it's captured
+    TIASound myChannelSound[2];
+
+    // The fragment generated by each of myChannelSound, one after the other
+    Int16* myChannelBuffer;
+    uInt32 myChannelBufferSize;
+#endif
+
   private:
     // Callback function invoked by the SDL Audio library when it needs data
     static void callback(void* udata, uInt8* stream, int len);
@@ -0,0 +1,81 @@
+//============================================================================
+//
+//   SSSS    tt          lll  lll
+//  SS  SS   tt           ll   ll
+//  SS     tttttt  eeee   ll   ll   aaaa
+//   SSSS    tt   ee  ee  ll   ll      aa
+//      SS   tt   eeeeee  ll   ll   aaaaa  --  "An Atari 2600 VCS Emulator"
+//  SS  SS   tt   ee      ll   ll  aa  aa
+//   SSSS     ttt  eeeee llll llll  aaaaa
+//
+// Copyright (c) 1995-2014 by Bradford W. Mott, Stephen Anthony
+// and the Stella Team
+//
+// See the file "License.txt" for information on usage and redistribution of
+// this file, and for a DISCLAIMER OF ALL WARRANTIES.
+//
+// $Id$
+//============================================================================
+
+#include <cmath>
+
+#include "BlepSynth.hxx"
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+BlepSynth::BlepSynth()
+{
+  computeKernel();
+  reset();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+BlepSynth::~BlepSynth()
+{
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void BlepSynth::computeKernel()
+{
+  const double pi = 3.14159265358979323846;
+
+  // Cut off a bit below the Nyquist frequency of the output
+  const double cutoff = 0.9;
+
+  for(uInt32 phase = 0; phase < PHASES; ++phase)
+  {
+    // The step is centered between the middle two samples of the kernel,
+    // so the output lags behind the input by half the kernel
+    double kernel[WIDTH], sum = 0.0;
+    for(uInt32 i = 0; i < WIDTH; ++i)
+    {
+      double x = (double)i - (WIDTH / 2 - 1) - (double)phase / PHASES;
+      double sinc = x == 0.0 ? 1.0 : sin(pi * cutoff * x) / (pi * cutoff * x);
+      double blackman = 0.42 + 0.5 * cos(pi * x / (WIDTH / 2)) +
+                        0.08 * cos(2 * pi * x / (WIDTH / 2));
+      kernel[i] = sinc * blackman;
+      sum += kernel[i];
+    }
+
+    // Normalize each phase to exactly one, so that steps don't leave the
+    // output level off by a rounding error
+    Int32 total = 0, largest = 0;
+    for(uInt32 i = 0; i < WIDTH; ++i)
+    {
+      myKernel[phase][i] = (Int16)floor(kernel[i] / sum * (1 << KERNEL_SHIFT) + 0.5);
+      total += myKernel[phase][i];
+      if(myKernel[phase][i] > myKernel[phase][largest])
+        largest = i;
+    }
+    myKernel[phase][largest] += (1 << KERNEL_SHIFT) - total;
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void BlepSynth::reset()
+{
+  for(uInt32 i = 0; i <= BUFFER_MASK; ++i)
+    myBuffer[i] = 0;
+  myPosition = 0;
+  mySum = 0;
+  myLevel = 0;
+}
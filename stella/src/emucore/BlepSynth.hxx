@@ -0,0 +1,129 @@
+//============================================================================
+//
+//   SSSS    tt          lll  lll
+//  SS  SS   tt           ll   ll
+//  SS     tttttt  eeee   ll   ll   aaaa
+//   SSSS    tt   ee  ee  ll   ll      aa
+//      SS   tt   eeeeee  ll   ll   aaaaa  --  "An Atari 2600 VCS Emulator"
+//  SS  SS   tt   ee      ll   ll  aa  aa
+//   SSSS     ttt  eeeee llll llll  aaaaa
+//
+// Copyright (c) 1995-2014 by Bradford W. Mott, Stephen Anthony
+// and the Stella Team
+//
+// See the file "License.txt" for information on usage and redistribution of
+// this file, and for a DISCLAIMER OF ALL WARRANTIES.
+//
+// $Id$
+//============================================================================
+
+#ifndef BLEP_SYNTH_HXX
+#define BLEP_SYNTH_HXX
+
+#include "bspf.hxx"
+
+/**
+  A band-limited step (BLEP) synthesizer for one channel of sound.
+
+  The TIA sound output is a square wave that only changes at its own
+  31400Hz clock.  Simply sampling that at another output rate puts
+  transitions on the wrong samples, which is heard as aliasing.  Instead,
+  every change of the output level is added here as a step that is low
+  pass filtered (a windowed sinc) at the output rate, positioned to a
+  fraction of an output sample.  Reading the output then sums up all the
+  steps, so resampling costs one filter kernel per level change plus one
+  addition per output sample.
+
+  @author  Stella Team
+  @version $Id$
+*/
+class BlepSynth
+{
+  public:
+    /**
+      Create a new synthesizer
+    */
+    BlepSynth();
+
+    /**
+      Destructor
+    */
+    virtual ~BlepSynth();
+
+  public:
+    /**
+      Clear all pending steps and return the output to silence
+    */
+    void reset();
+
+    /**
+      Change the output level at the given fraction of the time between
+      the last sample read and the next one.
+
+      @param phase  The position of the change, in 1/PHASES of a sample
+      @param level  The new output level
+    */
+    void setLevel(uInt32 phase, Int32 level)
+    {
+      Int32 delta = level - myLevel;
+      if(delta == 0)
+        return;
+      myLevel = level;
+
+      const Int16* kernel = myKernel[phase];
+      for(uInt32 i = 0; i < WIDTH; ++i)
+        myBuffer[(myPosition + i) & BUFFER_MASK] += delta * kernel[i];
+    }
+
+    /**
+      Read the next output sample.
+
+      @return  The sample, clipped to 16 bits
+    */
+    Int16 read()
+    {
+      Int32& slot = myBuffer[myPosition];
+      mySum += slot;
+      slot = 0;
+      myPosition = (myPosition + 1) & BUFFER_MASK;
+
+      Int32 sample = mySum >> KERNEL_SHIFT;
+      return sample > 32767 ? 32767 : sample < -32768 ? -32768 : sample;
+    }
+
+  public:
+    enum {
+      PHASES = 64       // the fractions of an output sample steps are put at
+    };
+
+  private:
+    /**
+      Compute the windowed sinc filter kernel for all the phases
+    */
+    void computeKernel();
+
+  private:
+    enum {
+      WIDTH = 16,       // the length of the filter kernel, in output samples
+      KERNEL_SHIFT = 14,// each phase of the kernel sums up to 1 << this
+      BUFFER_MASK = 31  // the ring buffer holds the next 32 samples
+    };
+
+    // The band-limited impulse (the derivative of a band-limited step),
+    // for each of the fractional positions
+    Int16 myKernel[PHASES][WIDTH];
+
+    // Ring buffer of the changes to the output over the next samples
+    Int32 myBuffer[BUFFER_MASK + 1];
+
+    // The position in myBuffer of the next sample to be read
+    uInt32 myPosition;
+
+    // The running sum of the buffer, that is the (scaled) output level
+    Int32 mySum;
+
+    // The level the input was last set to
+    Int32 myLevel;
+};
+
+#endif
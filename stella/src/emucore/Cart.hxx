@@ -59,6 +59,7 @@ class Cartridge : public Device
       @param size     The size of the ROM image 
       @param md5      The md5sum for the given ROM image (can be updated)
       @param dtype    The detected bankswitch type of the ROM image
+                      (an 'AUTO' type is replaced by the autodetected one)
       @param id       Any extra info about the ROM (currently which part
                       of a multiload game is being accessed
       @param system   The osystem associated with the system
@@ -202,6 +203,27 @@ class Cartridge : public Device
     */
     virtual void setRomName(const string& name) { }
 
+    /**
+      Carts with their own music hardware (DPC, DPC+) can synthesize the
+      music straight into the sound output when 'synthmusic' is enabled,
+      instead of it only being heard through the 6507 copying the music
+      amplitude into AUDV0.  Get the music levels (0 - 15, as for AUDV0)
+      generated since the last call, one for each 20 kHz music OSC clock.
+      The sound calls this at the start of every frame; levels that are
+      still there after that are thrown away.
+
+      @param levels  Set to point to the music levels
+      @return  The number of levels, or 0 if no music is being played
+    */
+    virtual uInt32 musicLevels(const uInt8*& levels) { return 0; }
+
+    /**
+      Answers whether the music synthesized by the cart is being played,
+      in which case writes to AUDV0 (which would only repeat it) are
+      ignored.
+    */
+    virtual bool musicPlaying() const { return false; }
+
     /**
       Get debugger widget responsible for accessing the inner workings
       of the cart.  This will need to be overridden and implemented by
@@ -254,138 +276,13 @@ class Cartridge : public Device
     static string createFromMultiCart(const uInt8*& image, uInt32& size,
         uInt32 numroms, string& md5, string& id, Settings& settings);
 
-    /**
-      Try to auto-detect the bankswitching type of the cartridge
-
-      @param image  A pointer to the ROM image
-      @param size   The size of the ROM image 
-      @return The "best guess" for the cartridge type
-    */
-    static string autodetectType(const uInt8* image, uInt32 size);
-
-    /**
-      Search the image for the specified byte signature
-
-      @param image      A pointer to the ROM image
-      @param imagesize  The size of the ROM image 
-      @param signature  The byte sequence to search for
-      @param sigsize    The number of bytes in the signature
-      @param minhits    The minimum number of times a signature is to be found
-
-      @return  True if the signature was found at least 'minhits' time, else false
-    */
-    static bool searchForBytes(const uInt8* image, uInt32 imagesize,
-                               const uInt8* signature, uInt32 sigsize,
-                               uInt32 minhits);
-
-    /**
-      Returns true if the image is probably a SuperChip (256 bytes RAM)
-    */
-    static bool isProbablySC(const uInt8* image, uInt32 size);
-
-    /**
-      Returns true if the image is probably a 4K SuperChip (256 bytes RAM)
-    */
-    static bool isProbably4KSC(const uInt8* image, uInt32 size);
-
-    /**
-      Returns true if the image probably contains ARM code in the first 1K
-    */
-    static bool isProbablyARM(const uInt8* image, uInt32 size);
-
-    /**
-      Returns true if the image is probably a 0840 bankswitching cartridge
-    */
-    static bool isProbably0840(const uInt8* image, uInt32 size);
-
-    /**
-      Returns true if the image is probably a 3E bankswitching cartridge
-    */
-    static bool isProbably3E(const uInt8* image, uInt32 size);
-
-    /**
-      Returns true if the image is probably a 3F bankswitching cartridge
-    */
-    static bool isProbably3F(const uInt8* image, uInt32 size);
-
-    /**
-      Returns true if the image is probably a 4A50 bankswitching cartridge
-    */
-    static bool isProbably4A50(const uInt8* image, uInt32 size);
-
-    /**
-      Returns true if the image is probably a CTY bankswitching cartridge
-    */
-    static bool isProbablyCTY(const uInt8* image, uInt32 size);
-
-    /**
-      Returns true if the image is probably a CV bankswitching cartridge
-    */
-    static bool isProbablyCV(const uInt8* image, uInt32 size);
-
-    /**
-      Returns true if the image is probably a DPC+ bankswitching cartridge
-    */
-    static bool isProbablyDPCplus(const uInt8* image, uInt32 size);
-
-    /**
-      Returns true if the image is probably a E0 bankswitching cartridge
-    */
-    static bool isProbablyE0(const uInt8* image, uInt32 size);
-
-    /**
-      Returns true if the image is probably a E7 bankswitching cartridge
-    */
-    static bool isProbablyE7(const uInt8* image, uInt32 size);
-
-    /**
-      Returns true if the image is probably an EF/EFSC bankswitching cartridge
-    */
-    static bool isProbablyEF(const uInt8* image, uInt32 size, const char*& type);
-
-    /**
-      Returns true if the image is probably a BF/BFSC bankswitching cartridge
-    */
-    static bool isProbablyBF(const uInt8* image, uInt32 size, const char*& type);
-    /**
-      Returns true if the image is probably a DF/DFSC bankswitching cartridge
-    */
-    static bool isProbablyDF(const uInt8* image, uInt32 size, const char*& type);
-
-    /**
-      Returns true if the image is probably an F6 bankswitching cartridge
-    */
-    static bool isProbablyF6(const uInt8* image, uInt32 size);
-
-    /**
-      Returns true if the image is probably an FA2 bankswitching cartridge
-    */
-    static bool isProbablyFA2(const uInt8* image, uInt32 size);
-
-    /**
-      Returns true if the image is probably an FE bankswitching cartridge
-    */
-    static bool isProbablyFE(const uInt8* image, uInt32 size);
-
-    /**
-      Returns true if the image is probably a SB bankswitching cartridge
-    */
-    static bool isProbablySB(const uInt8* image, uInt32 size);
-
-    /**
-      Returns true if the image is probably a UA bankswitching cartridge
-    */
-    static bool isProbablyUA(const uInt8* image, uInt32 size);
-
-    /**
-      Returns true if the image is probably an X07 bankswitching cartridge
-    */
-    static bool isProbablyX07(const uInt8* image, uInt32 size);
-
   protected:
     // Settings class for the application
     const Settings& mySettings;
 
+    // Handle of the 'ramrandom' setting, checked whenever RAM is reset
+    Settings::Handle myRandomRAM;
+
     // The startup bank to use (where to look for the reset vector address)
     uInt16 myStartBank;
 
@@ -197,7 +197,7 @@ bool Cartridge0840::save(Serializer& out) const
 {
   try
   {
-    out.putString(name());
+    out.putTag(name());
     out.putShort(myCurrentBank);
   }
   catch(...)
@@ -214,7 +214,7 @@ bool Cartridge0840::load(Serializer& in)
 {
   try
   {
-    if(in.getString() != name())
+    if(!in.checkTag(name()))
       return false;
 
     myCurrentBank = in.getShort();
@@ -139,7 +139,7 @@ bool Cartridge2K::save(Serializer& out) const
 {
   try
   {
-    out.putString(name());
+    out.putTag(name());
   }
   catch(...)
   {
@@ -155,7 +155,7 @@ bool Cartridge2K::load(Serializer& in)
 {
   try
   {
-    if(in.getString() != name())
+    if(!in.checkTag(name()))
       return false;
   }
   catch(...)
@@ -56,7 +56,7 @@ Cartridge3E::~Cartridge3E()
 void Cartridge3E::reset()
 {
   // Initialize RAM
-  if(mySettings.getBool("ramrandom"))
+  if(mySettings.getBool(myRandomRAM))
     for(uInt32 i = 0; i < 32768; ++i)
       myRAM[i] = mySystem->randGenerator().next();
   else
@@ -273,7 +273,7 @@ bool Cartridge3E::save(Serializer& out) const
 {
   try
   {
-    out.putString(name());
+    out.putTag(name());
     out.putShort(myCurrentBank);
     out.putByteArray(myRAM, 32768);
   }
@@ -291,7 +291,7 @@ bool Cartridge3E::load(Serializer& in)
 {
   try
   {
-    if(in.getString() != name())
+    if(!in.checkTag(name()))
       return false;
 
     myCurrentBank = in.getShort();
@@ -191,7 +191,7 @@ bool Cartridge3F::save(Serializer& out) const
 {
   try
   {
-    out.putString(name());
+    out.putTag(name());
     out.putShort(myCurrentBank);
   }
   catch(...)
@@ -208,7 +208,7 @@ bool Cartridge3F::load(Serializer& in)
 {
   try
   {
-    if(in.getString() != name())
+    if(!in.checkTag(name()))
       return false;
 
     myCurrentBank = in.getShort();
@@ -58,7 +58,7 @@ Cartridge4A50::~Cartridge4A50()
 void Cartridge4A50::reset()
 {
   // Initialize RAM
-  if(mySettings.getBool("ramrandom"))
+  if(mySettings.getBool(myRandomRAM))
     for(uInt32 i = 0; i < 32768; ++i)
       myRAM[i] = mySystem->randGenerator().next();
   else
@@ -402,7 +402,7 @@ bool Cartridge4A50::save(Serializer& out) const
 {
   try
   {
-    out.putString(name());
+    out.putTag(name());
 
     // The 32K bytes of RAM
     out.putByteArray(myRAM, 32768);
@@ -435,7 +435,7 @@ bool Cartridge4A50::load(Serializer& in)
 {
   try
   {
-    if(in.getString() != name())
+    if(!in.checkTag(name()))
       return false;
 
     in.getByteArray(myRAM, 32768);
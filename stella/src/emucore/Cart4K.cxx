@@ -116,7 +116,7 @@ bool Cartridge4K::save(Serializer& out) const
 {
   try
   {
-    out.putString(name());
+    out.putTag(name());
   }
   catch(...)
   {
@@ -132,7 +132,7 @@ bool Cartridge4K::load(Serializer& in)
 {
   try
   {
-    if(in.getString() != name())
+    if(!in.checkTag(name()))
       return false;
   }
   catch(...)
@@ -44,7 +44,7 @@ Cartridge4KSC::~Cartridge4KSC()
 void Cartridge4KSC::reset()
 {
   // Initialize RAM
-  if(mySettings.getBool("ramrandom"))
+  if(mySettings.getBool(myRandomRAM))
     for(uInt32 i = 0; i < 128; ++i)
       myRAM[i] = mySystem->randGenerator().next();
   else
@@ -173,7 +173,7 @@ bool Cartridge4KSC::save(Serializer& out) const
 {
   try
   {
-    out.putString(name());
+    out.putTag(name());
     out.putShort(myCurrentBank);
     out.putByteArray(myRAM, 128);
   }
@@ -191,7 +191,7 @@ bool Cartridge4KSC::load(Serializer& in)
 {
   try
   {
-    if(in.getString() != name())
+    if(!in.checkTag(name()))
       return false;
 
     myCurrentBank = in.getShort();
@@ -60,7 +60,7 @@ void CartridgeAR::reset()
 {
   // Initialize RAM
 #if 0  // TODO - figure out actual behaviour of the real cart
-  if(mySettings.getBool("ramrandom"))
+  if(mySettings.getBool(myRandomRAM))
     for(uInt32 i = 0; i < 6 * 1024; ++i)
       myImage[i] = mySystem->randGenerator().next();
   else
@@ -469,7 +469,7 @@ bool CartridgeAR::save(Serializer& out) const
 {
   try
   {
-    out.putString(name());
+    out.putTag(name());
 
     // Indicates the offest within the image for the corresponding bank
     out.putIntArray(myImageOffset, 2);
@@ -519,7 +519,7 @@ bool CartridgeAR::load(Serializer& in)
 {
   try
   {
-    if(in.getString() != name())
+    if(!in.checkTag(name()))
       return false;
 
     // Indicates the offest within the image for the corresponding bank
@@ -145,7 +145,7 @@ bool CartridgeBF::save(Serializer& out) const
 {
   try
   {
-    out.putString(name());
+    out.putTag(name());
     out.putShort(myCurrentBank);
   }
   catch(...)
@@ -162,7 +162,7 @@ bool CartridgeBF::load(Serializer& in)
 {
   try
   {
-    if(in.getString() != name())
+    if(!in.checkTag(name()))
       return false;
 
     myCurrentBank = in.getShort();
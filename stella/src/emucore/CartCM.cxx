@@ -51,7 +51,7 @@ CartridgeCM::~CartridgeCM()
 void CartridgeCM::reset()
 {
   // Initialize RAM
-  if(mySettings.getBool("ramrandom"))
+  if(mySettings.getBool(myRandomRAM))
     for(uInt32 i = 0; i < 2048; ++i)
       myRAM[i] = mySystem->randGenerator().next();
   else
@@ -201,7 +201,7 @@ bool CartridgeCM::save(Serializer& out) const
 {
   try
   {
-    out.putString(name());
+    out.putTag(name());
     out.putShort(myCurrentBank);
     out.putByte(mySWCHA);
     out.putByte(myColumn);
@@ -221,7 +221,7 @@ bool CartridgeCM::load(Serializer& in)
 {
   try
   {
-    if(in.getString() != name())
+    if(!in.checkTag(name()))
       return false;
 
     myCurrentBank = in.getShort();
@@ -36,7 +36,7 @@ CartridgeCTY::CartridgeCTY(const uInt8* image, uInt32 size, const OSystem& osyst
     myRandomNumber(0x2B435044),
     myRamAccessTimeout(0),
     mySystemCycles(0),
-    myFractionalClocks(0.0)
+    myFractionalClocks(0)
 {
   // Copy the ROM image into my buffer
   memcpy(myImage, image, BSPF_min(32768u, size));
@@ -61,7 +61,7 @@ CartridgeCTY::~CartridgeCTY()
 void CartridgeCTY::reset()
 {
   // Initialize RAM
-  if(mySettings.getBool("ramrandom"))
+  if(mySettings.getBool(myRandomRAM))
     for(uInt32 i = 0; i < 64; ++i)
       myRAM[i] = mySystem->randGenerator().next();
   else
@@ -71,7 +71,7 @@ void CartridgeCTY::reset()
 
   // Update cycles to the current system cycles
   mySystemCycles = mySystem->cycles();
-  myFractionalClocks = 0.0;
+  myFractionalClocks = 0;
 
   // Upon reset we switch to the startup bank
   bank(myStartBank);
@@ -309,7 +309,7 @@ bool CartridgeCTY::save(Serializer& out) const
 {
   try
   {
-    out.putString(name());
+    out.putTag(name());
     out.putShort(bank());
     out.putByteArray(myRAM, 64);
 
@@ -318,7 +318,7 @@ bool CartridgeCTY::save(Serializer& out) const
     out.putBool(myLDAimmediate);
     out.putInt(myRandomNumber);
     out.putInt(mySystemCycles);
-    out.putInt((uInt32)(myFractionalClocks * 100000000.0));
+    out.putInt(myFractionalClocks);
 
   }
   catch(...)
@@ -335,7 +335,7 @@ bool CartridgeCTY::load(Serializer& in)
 {
   try
   {
-    if(in.getString() != name())
+    if(!in.checkTag(name()))
       return false;
 
     // Remember what bank we were in
@@ -347,7 +347,7 @@ bool CartridgeCTY::load(Serializer& in)
     myLDAimmediate = in.getBool();
     myRandomNumber = in.getInt();
     mySystemCycles = (Int32)in.getInt();
-    myFractionalClocks = (double)in.getInt() / 100000000.0;
+    myFractionalClocks = in.getInt();
   }
   catch(...)
   {
@@ -537,10 +537,14 @@ inline void CartridgeCTY::updateMusicModeDataFetchers()
   Int32 cycles = mySystem->cycles() - mySystemCycles;
   mySystemCycles = mySystem->cycles();
 
-  // Calculate the number of DPC OSC clocks since the last update
-  double clocks = ((20000.0 * cycles) / 1193191.66666667) + myFractionalClocks;
-  Int32 wholeClocks = (Int32)clocks;
-  myFractionalClocks = clocks - (double)wholeClocks;
+  // Calculate the number of DPC OSC clocks since the last update; the
+  // 20 kHz OSC runs at exactly 2400/143183 of the 1193191.67 Hz system
+  // clock, so the part of a clock left over is kept in 143183ths
+  if(cycles <= 0)
+    return;
+  uInt64 clocks = (uInt64)cycles * 2400 + myFractionalClocks;
+  Int32 wholeClocks = (Int32)(clocks / 143183);
+  myFractionalClocks = (uInt32)(clocks % 143183);
 
   if(wholeClocks <= 0)
     return;
@@ -310,8 +310,9 @@ class CartridgeCTY : public Cartridge
     // System cycle count when the last update to music data fetchers occurred
     Int32 mySystemCycles;
 
-    // Fractional DPC music OSC clocks unused during the last update
-    double myFractionalClocks;
+    // Fractional DPC music OSC clocks unused during the last update,
+    // in units of 1/143183 of a clock
+    uInt32 myFractionalClocks;
 };
 
 #endif
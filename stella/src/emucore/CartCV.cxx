@@ -70,7 +70,7 @@ void CartridgeCV::reset()
   else
   {
     // Initialize RAM
-    if(mySettings.getBool("ramrandom"))
+    if(mySettings.getBool(myRandomRAM))
       for(uInt32 i = 0; i < 1024; ++i)
         myRAM[i] = mySystem->randGenerator().next();
     else
@@ -203,7 +203,7 @@ bool CartridgeCV::save(Serializer& out) const
 {
   try
   {
-    out.putString(name());
+    out.putTag(name());
     out.putByteArray(myRAM, 1024);
   }
   catch(...)
@@ -220,7 +220,7 @@ bool CartridgeCV::load(Serializer& in)
 {
   try
   {
-    if(in.getString() != name())
+    if(!in.checkTag(name()))
       return false;
 
     in.getByteArray(myRAM, 1024);
@@ -47,7 +47,7 @@ CartridgeDFSC::~CartridgeDFSC()
 void CartridgeDFSC::reset()
 {
   // Initialize RAM
-  if(mySettings.getBool("ramrandom"))
+  if(mySettings.getBool(myRandomRAM))
     for(uInt32 i = 0; i < 128; ++i)
       myRAM[i] = mySystem->randGenerator().next();
   else
@@ -207,7 +207,7 @@ bool CartridgeDFSC::save(Serializer& out) const
 {
   try
   {
-    out.putString(name());
+    out.putTag(name());
     out.putShort(myCurrentBank);
     out.putByteArray(myRAM, 128);
   }
@@ -225,7 +225,7 @@ bool CartridgeDFSC::load(Serializer& in)
 {
   try
   {
-    if(in.getString() != name())
+    if(!in.checkTag(name()))
       return false;
 
     myCurrentBank = in.getShort();
@@ -29,7 +29,10 @@ CartridgeDPC::CartridgeDPC(const uInt8* image, uInt32 size,
   : Cartridge(settings),
     mySize(size),
     mySystemCycles(0),
-    myFractionalClocks(0.0)
+    myFractionalClocks(0),
+    myMusicLevelCount(0),
+    myMusicPolled(false),
+    myMusicPlaying(false)
 {
   // Make a copy of the entire image
   memcpy(myImage, image, BSPF_min(size, 8192u + 2048u + 256u));
@@ -51,6 +54,9 @@ CartridgeDPC::CartridgeDPC(const uInt8* image, uInt32 size,
   // Initialize the DPC's random number generator register (must be non-zero)
   myRandomNumber = 1;
 
+  // Music can be synthesized straight into the sound output
+  mySynthMusic = settings.getBool("synthmusic");
+
   // Remember startup bank
   myStartBank = 1;
 }
@@ -65,7 +71,8 @@ void CartridgeDPC::reset()
 {
   // Update cycles to the current system cycles
   mySystemCycles = mySystem->cycles();
-  myFractionalClocks = 0.0;
+  myFractionalClocks = 0;
+  myMusicLevelCount = 0;
 
   // Upon reset we switch to the startup bank
   bank(myStartBank);
@@ -79,6 +86,11 @@ void CartridgeDPC::systemCyclesReset()
 
   // Adjust the cycle counter so that it reflects the new value
   mySystemCycles -= cycles;
+
+  // The sound takes the music levels at the start of every frame, just
+  // before this (the TIA is attached to the system first); any levels
+  // nobody took are thrown away instead of piling up
+  myMusicLevelCount = 0;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -126,16 +138,42 @@ inline void CartridgeDPC::updateMusicModeDataFetchers()
   Int32 cycles = mySystem->cycles() - mySystemCycles;
   mySystemCycles = mySystem->cycles();
 
-  // Calculate the number of DPC OSC clocks since the last update
-  double clocks = ((20000.0 * cycles) / 1193191.66666667) + myFractionalClocks;
-  Int32 wholeClocks = (Int32)clocks;
-  myFractionalClocks = clocks - (double)wholeClocks;
+  // Calculate the number of DPC OSC clocks since the last update; the
+  // 20 kHz OSC runs at exactly 2400/143183 of the 1193191.67 Hz system
+  // clock, so the part of a clock left over is kept in 143183ths
+  if(cycles <= 0)
+    return;
+  uInt64 clocks = (uInt64)cycles * 2400 + myFractionalClocks;
+  Int32 wholeClocks = (Int32)(clocks / 143183);
+  myFractionalClocks = (uInt32)(clocks % 143183);
 
   if(wholeClocks <= 0)
   {
     return;
   }
 
+  if(mySynthMusic)
+  {
+    // Record the music level after every clock, as far as there's room
+    Int32 room = 1024 - myMusicLevelCount;
+    if(wholeClocks > room)
+    {
+      clockMusicModeDataFetchers(wholeClocks - room);
+      wholeClocks = room;
+    }
+    for(; wholeClocks > 0; --wholeClocks)
+    {
+      clockMusicModeDataFetchers(1);
+      myMusicLevels[myMusicLevelCount++] = musicAmplitude();
+    }
+  }
+  else
+    clockMusicModeDataFetchers(wholeClocks);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+inline void CartridgeDPC::clockMusicModeDataFetchers(Int32 wholeClocks)
+{
   // Let's update counters and flags of the music mode data fetchers
   for(int x = 5; x <= 7; ++x)
   {
@@ -173,6 +211,50 @@ inline void CartridgeDPC::updateMusicModeDataFetchers()
   }
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+inline uInt8 CartridgeDPC::musicAmplitude() const
+{
+  static const uInt8 musicAmplitudes[8] = {
+      0x00, 0x04, 0x05, 0x09, 0x06, 0x0a, 0x0b, 0x0f
+  };
+
+  uInt8 i = 0;
+  if(myMusicMode[0] && myFlags[5])
+  {
+    i |= 0x01;
+  }
+  if(myMusicMode[1] && myFlags[6])
+  {
+    i |= 0x02;
+  }
+  if(myMusicMode[2] && myFlags[7])
+  {
+    i |= 0x04;
+  }
+
+  return musicAmplitudes[i];
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+uInt32 CartridgeDPC::musicLevels(const uInt8*& levels)
+{
+  if(!mySynthMusic)
+    return 0;
+
+  // Catch up to the current cycle
+  updateMusicModeDataFetchers();
+
+  // The music is only played while the game keeps reading it
+  myMusicPlaying = myMusicPolled;
+  myMusicPolled = false;
+
+  uInt32 count = myMusicLevelCount;
+  myMusicLevelCount = 0;
+  levels = myMusicLevels;
+
+  return myMusicPlaying ? count : 0;
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 uInt8 CartridgeDPC::peek(uInt16 address)
 {
@@ -218,28 +300,11 @@ uInt8 CartridgeDPC::peek(uInt16 address)
         // No, it's a music read
         else
         {
-          static const uInt8 musicAmplitudes[8] = {
-              0x00, 0x04, 0x05, 0x09, 0x06, 0x0a, 0x0b, 0x0f
-          };
-
           // Update the music data fetchers (counter & flag)
           updateMusicModeDataFetchers();
 
-          uInt8 i = 0;
-          if(myMusicMode[0] && myFlags[5])
-          {
-            i |= 0x01;
-          }
-          if(myMusicMode[1] && myFlags[6])
-          {
-            i |= 0x02;
-          }
-          if(myMusicMode[2] && myFlags[7])
-          {
-            i |= 0x04;
-          }
-
-          result = musicAmplitudes[i];
+          result = musicAmplitude();
+          myMusicPolled = true;
         }
         break;
       }
@@ -317,6 +382,10 @@ bool CartridgeDPC::poke(uInt16 address, uInt8 value)
     uInt32 index = address & 0x07;    
     uInt32 function = (address >> 3) & 0x07;
 
+    // The synthesized music must be up to date before it changes
+    if(mySynthMusic && index >= 5)
+      updateMusicModeDataFetchers();
+
     switch(function)
     {
       // DFx top count
@@ -477,7 +546,7 @@ bool CartridgeDPC::save(Serializer& out) const
 {
   try
   {
-    out.putString(name());
+    out.putTag(name());
 
     // Indicates which bank is currently active
     out.putShort(myCurrentBank);
@@ -502,7 +571,7 @@ bool CartridgeDPC::save(Serializer& out) const
     out.putByte(myRandomNumber);
 
     out.putInt(mySystemCycles);
-    out.putInt((uInt32)(myFractionalClocks * 100000000.0));
+    out.putInt(myFractionalClocks);
   }
   catch(...)
   {
@@ -518,7 +587,7 @@ bool CartridgeDPC::load(Serializer& in)
 {
   try
   {
-    if(in.getString() != name())
+    if(!in.checkTag(name()))
       return false;
 
     // Indicates which bank is currently active
@@ -545,7 +614,7 @@ bool CartridgeDPC::load(Serializer& in)
 
     // Get system cycles and fractional clocks
     mySystemCycles = (Int32)in.getInt();
-    myFractionalClocks = (double)in.getInt() / 100000000.0;
+    myFractionalClocks = in.getInt();
   }
   catch(...)
   {
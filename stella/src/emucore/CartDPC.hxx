@@ -137,6 +137,20 @@ class CartridgeDPC : public Cartridge
     */
     string name() const { return "CartridgeDPC"; }
 
+    /**
+      Get the music levels generated since the last call (see Cartridge).
+
+      @param levels  Set to point to the music levels
+      @return  The number of levels, or 0 if no music is being played
+    */
+    uInt32 musicLevels(const uInt8*& levels);
+
+    /**
+      Answers whether the synthesized music is being played.
+    */
+    bool musicPlaying() const
+      { return mySynthMusic && (myMusicPolled || myMusicPlaying); }
+
   #ifdef DEBUGGER_SUPPORT
     /**
       Get debugger widget responsible for accessing the inner workings
@@ -178,6 +192,16 @@ class CartridgeDPC : public Cartridge
     */
     void updateMusicModeDataFetchers();
 
+    /**
+      Clocks the data fetchers in music mode the given number of times.
+    */
+    void clockMusicModeDataFetchers(Int32 clocks);
+
+    /**
+      Get the music amplitude for the current state of the data fetchers.
+    */
+    uInt8 musicAmplitude() const;
+
   private:
     // The ROM image
     uInt8 myImage[8192 + 2048 + 256];
@@ -215,8 +239,21 @@ class CartridgeDPC : public Cartridge
     // System cycle count when the last update to music data fetchers occurred
     Int32 mySystemCycles;
 
-    // Fractional DPC music OSC clocks unused during the last update
-    double myFractionalClocks;
+    // Fractional DPC music OSC clocks unused during the last update,
+    // in units of 1/143183 of a clock
+    uInt32 myFractionalClocks;
+
+    // Indicates whether the music is synthesized into the sound output
+    bool mySynthMusic;
+
+    // The music level after each OSC clock since the last musicLevels()
+    uInt8 myMusicLevels[1024];
+    uInt32 myMusicLevelCount;
+
+    // Indicates the music amplitude was read since the last musicLevels(),
+    // and during the frame before that
+    bool myMusicPolled;
+    bool myMusicPlaying;
 };
 
 #endif
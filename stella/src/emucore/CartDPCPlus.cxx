@@ -35,7 +35,10 @@ CartridgeDPCPlus::CartridgeDPCPlus(const uInt8* image, uInt32 size,
     myLDAimmediate(false),
     myParameterPointer(0),
     mySystemCycles(0),
-    myFractionalClocks(0.0)
+    myFractionalClocks(0),
+    myMusicLevelCount(0),
+    myMusicPolled(false),
+    myMusicPlaying(false)
 {
   // Store image, making sure it's at least 29KB
   uInt32 minsize = 4096 * 6 + 4096 + 1024 + 255;
@@ -63,9 +66,13 @@ CartridgeDPCPlus::CartridgeDPCPlus(const uInt8* image, uInt32 size,
   myThumbEmulator = new Thumbulator((uInt16*)(myProgramImage-0xC00),
                                     (uInt16*)myDPCRAM,
                                      settings.getBool("thumb.trapfatal"));
+  resetARMStats();
 #endif
   setInitialState();
 
+  // Music can be synthesized straight into the sound output
+  mySynthMusic = settings.getBool("synthmusic");
+
   // DPC+ always starts in bank 5
   myStartBank = 5;
 }
@@ -85,7 +92,8 @@ void CartridgeDPCPlus::reset()
 {
   // Update cycles to the current system cycles
   mySystemCycles = mySystem->cycles();
-  myFractionalClocks = 0.0;
+  myFractionalClocks = 0;
+  myMusicLevelCount = 0;
 
   setInitialState();
 
@@ -122,6 +130,11 @@ void CartridgeDPCPlus::systemCyclesReset()
 
   // Adjust the cycle counter so that it reflects the new value
   mySystemCycles -= cycles;
+
+  // The sound takes the music levels at the start of every frame, just
+  // before this (the TIA is attached to the system first); any levels
+  // nobody took are thrown away instead of piling up
+  myMusicLevelCount = 0;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -168,16 +181,40 @@ inline void CartridgeDPCPlus::updateMusicModeDataFetchers()
   Int32 cycles = mySystem->cycles() - mySystemCycles;
   mySystemCycles = mySystem->cycles();
 
-  // Calculate the number of DPC OSC clocks since the last update
-  double clocks = ((20000.0 * cycles) / 1193191.66666667) + myFractionalClocks;
-  Int32 wholeClocks = (Int32)clocks;
-  myFractionalClocks = clocks - (double)wholeClocks;
+  // Calculate the number of DPC OSC clocks since the last update; the
+  // 20 kHz OSC runs at exactly 2400/143183 of the 1193191.67 Hz system
+  // clock, so the part of a clock left over is kept in 143183ths
+  if(cycles <= 0)
+    return;
+  uInt64 clocks = (uInt64)cycles * 2400 + myFractionalClocks;
+  Int32 wholeClocks = (Int32)(clocks / 143183);
+  myFractionalClocks = (uInt32)(clocks % 143183);
 
   if(wholeClocks <= 0)
   {
     return;
   }
 
+  if(mySynthMusic)
+  {
+    // The synthesized music advances by every clock, recording the music
+    // level after each one, as far as there's room
+    Int32 room = 1024 - myMusicLevelCount;
+    if(wholeClocks > room)
+    {
+      for(int x = 0; x <= 2; ++x)
+        myMusicCounters[x] += myMusicFrequencies[x] * (wholeClocks - room);
+      wholeClocks = room;
+    }
+    for(; wholeClocks > 0; --wholeClocks)
+    {
+      for(int x = 0; x <= 2; ++x)
+        myMusicCounters[x] += myMusicFrequencies[x];
+      myMusicLevels[myMusicLevelCount++] = musicAmplitude();
+    }
+    return;
+  }
+
   // Let's update counters and flags of the music mode data fetchers
   for(int x = 0; x <= 2; ++x)
   {
@@ -185,6 +222,65 @@ inline void CartridgeDPCPlus::updateMusicModeDataFetchers()
   }
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+inline uInt8 CartridgeDPCPlus::musicAmplitude() const
+{
+  // using myDisplayImage[] instead of myProgramImage[] because waveforms
+  // can be modified during runtime.
+  uInt32 i = myDisplayImage[(myMusicWaveforms[0] << 5) + (myMusicCounters[0] >> 27)] +
+             myDisplayImage[(myMusicWaveforms[1] << 5) + (myMusicCounters[1] >> 27)] +
+             myDisplayImage[(myMusicWaveforms[2] << 5) + (myMusicCounters[2] >> 27)];
+
+  return (uInt8)i;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+uInt32 CartridgeDPCPlus::musicLevels(const uInt8*& levels)
+{
+  if(!mySynthMusic)
+    return 0;
+
+  // Catch up to the current cycle
+  updateMusicModeDataFetchers();
+
+  // The music is only played while the game keeps reading it
+  myMusicPlaying = myMusicPolled;
+  myMusicPolled = false;
+
+  uInt32 count = myMusicLevelCount;
+  myMusicLevelCount = 0;
+  levels = myMusicLevels;
+
+  return myMusicPlaying ? count : 0;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+#ifdef THUMB_SUPPORT
+void CartridgeDPCPlus::resetARMStats()
+{
+  memset(&myARMStats, 0, sizeof(ARMStats));
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void CartridgeDPCPlus::updateARMStats()
+{
+  Thumbulator::Stats call = myThumbEmulator->stats();
+
+  // The 6507 runs at 1.19 MHz, so every 6507 cycle is about 59 ARM cycles
+  uInt32 systemCycles = uInt32(((uInt64)call.cycles * 1193182 + 69999999) /
+                               70000000);
+
+  myARMStats.calls++;
+  myARMStats.instructions += call.instructions;
+  myARMStats.reads += call.reads;
+  myARMStats.writes += call.writes;
+  myARMStats.cycles += call.cycles;
+  myARMStats.systemCycles += systemCycles;
+  if(systemCycles > myARMStats.maxSystemCycles)
+    myARMStats.maxSystemCycles = systemCycles;
+}
+#endif
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 inline void CartridgeDPCPlus::callFunction(uInt8 value)
 {
@@ -222,6 +318,7 @@ inline void CartridgeDPCPlus::callFunction(uInt8 value)
       #endif
         }
       }
+      updateARMStats();
       break;
   #endif
     // reserved
@@ -294,13 +391,8 @@ uInt8 CartridgeDPCPlus::peek(uInt16 address)
             // Update the music data fetchers (counter & flag)
             updateMusicModeDataFetchers();
 
-            // using myDisplayImage[] instead of myProgramImage[] because waveforms
-            // can be modified during runtime.
-            uInt32 i = myDisplayImage[(myMusicWaveforms[0] << 5) + (myMusicCounters[0] >> 27)] +
-                       myDisplayImage[(myMusicWaveforms[1] << 5) + (myMusicCounters[1] >> 27)] +
-                       myDisplayImage[(myMusicWaveforms[2] << 5) + (myMusicCounters[2] >> 27)];
-
-            result = (uInt8)i;
+            result = musicAmplitude();
+            myMusicPolled = true;
             break;
           }
 
@@ -421,6 +513,10 @@ bool CartridgeDPCPlus::poke(uInt16 address, uInt8 value)
     uInt32 index = address & 0x07;
     uInt32 function = ((address - 0x28) >> 3) & 0x0f;
 
+    // The synthesized music must be up to date before anything changes it
+    if(mySynthMusic)
+      updateMusicModeDataFetchers();
+
     switch(function)
     {
       //DFxFRACLOW - fractional data pointer low byte
@@ -660,7 +756,7 @@ bool CartridgeDPCPlus::save(Serializer& out) const
 {
   try
   {
-    out.putString(name());
+    out.putTag(name());
 
     // Indicates which bank is currently active
     out.putShort(myCurrentBank);
@@ -703,7 +799,7 @@ bool CartridgeDPCPlus::save(Serializer& out) const
     out.putInt(myRandomNumber);
 
     out.putInt(mySystemCycles);
-    out.putInt((uInt32)(myFractionalClocks * 100000000.0));
+    out.putInt(myFractionalClocks);
   }
   catch(...)
   {
@@ -719,7 +815,7 @@ bool CartridgeDPCPlus::load(Serializer& in)
 {
   try
   {
-    if(in.getString() != name())
+    if(!in.checkTag(name()))
       return false;
 
     // Indicates which bank is currently active
@@ -764,7 +860,7 @@ bool CartridgeDPCPlus::load(Serializer& in)
 
     // Get system cycles and fractional clocks
     mySystemCycles = (Int32)in.getInt();
-    myFractionalClocks = (double)in.getInt() / 100000000.0;
+    myFractionalClocks = in.getInt();
   }
   catch(...)
   {
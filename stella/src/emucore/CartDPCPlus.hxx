@@ -140,6 +140,20 @@ class CartridgeDPCPlus : public Cartridge
     */
     string name() const { return "CartridgeDPC+"; }
 
+    /**
+      Get the music levels generated since the last call (see Cartridge).
+
+      @param levels  Set to point to the music levels
+      @return  The number of levels, or 0 if no music is being played
+    */
+    uInt32 musicLevels(const uInt8*& levels);
+
+    /**
+      Answers whether the synthesized music is being played.
+    */
+    bool musicPlaying() const
+      { return mySynthMusic && (myMusicPolled || myMusicPlaying); }
+
   #ifdef DEBUGGER_SUPPORT
     /**
       Get debugger widget responsible for accessing the inner workings
@@ -169,6 +183,34 @@ class CartridgeDPCPlus : public Cartridge
     */
     bool poke(uInt16 address, uInt8 value);
 
+  #ifdef THUMB_SUPPORT
+    /**
+      Totals for the ARM code called by the 6507 since the last call to
+      resetARMStats().  The ARM runs at 70 MHz on the Harmony cart, while
+      the 6507 is stalled, so the time each call takes is also given in
+      6507 cycles.
+    */
+    struct ARMStats
+    {
+      uInt32 calls;            // number of calls to ARM code
+      uInt64 instructions;     // Thumb instructions executed
+      uInt64 reads, writes;    // data memory accesses
+      uInt64 cycles;           // ARM clock cycles
+      uInt32 systemCycles;     // the same time in 6507 cycles
+      uInt32 maxSystemCycles;  // the longest single call in 6507 cycles
+    };
+
+    /**
+      Get the ARM statistics collected so far.
+    */
+    const ARMStats& armStats() const { return myARMStats; }
+
+    /**
+      Discard the ARM statistics collected so far.
+    */
+    void resetARMStats();
+  #endif
+
   private:
     /** 
       Sets the initial state of the DPC pointers and RAM
@@ -191,11 +233,23 @@ class CartridgeDPCPlus : public Cartridge
     */
     void updateMusicModeDataFetchers();
 
+    /**
+      Get the music amplitude for the current state of the data fetchers.
+    */
+    uInt8 musicAmplitude() const;
+
     /** 
       Call Special Functions
     */
     void callFunction(uInt8 value);
 
+  #ifdef THUMB_SUPPORT
+    /**
+      Add the ARM code run by the last call to the statistics
+    */
+    void updateARMStats();
+  #endif
+
   private:
     // The ROM image and size
     uInt8* myImage;
@@ -213,6 +267,9 @@ class CartridgeDPCPlus : public Cartridge
 #ifdef THUMB_SUPPORT
     // Pointer to the Thumb ARM emulator object
     Thumbulator* myThumbEmulator;
+
+    // Statistics for the ARM code run so far
+    ARMStats myARMStats;
 #endif
 
     // Pointer to the 1K frequency table
@@ -263,8 +320,21 @@ class CartridgeDPCPlus : public Cartridge
     // System cycle count when the last update to music data fetchers occurred
     Int32 mySystemCycles;
 
-    // Fractional DPC music OSC clocks unused during the last update
-    double myFractionalClocks;
+    // Fractional DPC music OSC clocks unused during the last update,
+    // in units of 1/143183 of a clock
+    uInt32 myFractionalClocks;
+
+    // Indicates whether the music is synthesized into the sound output
+    bool mySynthMusic;
+
+    // The music level after each OSC clock since the last musicLevels()
+    uInt8 myMusicLevels[1024];
+    uInt32 myMusicLevelCount;
+
+    // Indicates the music amplitude was read since the last musicLevels(),
+    // and during the frame before that
+    bool myMusicPolled;
+    bool myMusicPlaying;
 };
 
 #endif
@@ -0,0 +1,650 @@
+//============================================================================
+//
+//   SSSS    tt          lll  lll
+//  SS  SS   tt           ll   ll
+//  SS     tttttt  eeee   ll   ll   aaaa
+//   SSSS    tt   ee  ee  ll   ll      aa
+//      SS   tt   eeeeee  ll   ll   aaaaa  --  "An Atari 2600 VCS Emulator"
+//  SS  SS   tt   ee      ll   ll  aa  aa
+//   SSSS     ttt  eeeee llll llll  aaaaa
+//
+// Copyright (c) 1995-2014 by Bradford W. Mott, Stephen Anthony
+// and the Stella Team
+//
+// See the file "License.txt" for information on usage and redistribution of
+// this file, and for a DISCLAIMER OF ALL WARRANTIES.
+//
+// $Id$
+//============================================================================
+
+#include <cassert>
+#include <cstring>
+
+#include "bspf.hxx"
+#include "CartDetector.hxx"
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+string CartDetector::autodetectType(const uInt8* image, uInt32 size)
+{
+  // Every signature the tests below look for is found in one pass over
+  // the image, so the size-based guesses only have to consult the hits
+  SignatureHits hits;
+  scanSignatures(image, size, hits);
+
+  // Guess type based on size
+  const char* type = 0;
+
+  if((size % 8448) == 0 || size == 6144)
+  {
+    type = "AR";
+  }
+  else if(size < 2048)  // Sub2K images
+  {
+    type = "2K";
+  }
+  else if((size == 2048) ||
+          (size == 4096 && memcmp(image, image + 2048, 2048) == 0))
+  {
+    type = isProbablyCV(hits) ? "CV" : "2K";
+  }
+  else if(size == 4096)
+  {
+    if(isProbablyCV(hits))
+      type = "CV";
+    else if(isProbably4KSC(image,size))
+      type = "4KSC";
+    else 
+      type = "4K";
+  }
+  else if(size == 8*1024)  // 8K
+  {
+    // First check for *potential* F8
+    bool f8 = hits.found(SIG_STA_1FF9, 2);
+
+    if(isProbablySC(image, size))
+      type = "F8SC";
+    else if(memcmp(image, image + 4096, 4096) == 0)
+      type = "4K";
+    else if(isProbablyE0(hits))
+      type = "E0";
+    else if(isProbably3E(hits))
+      type = "3E";
+    else if(isProbably3F(hits))
+      type = "3F";
+    else if(isProbablyUA(hits))
+      type = "UA";
+    else if(isProbablyFE(hits) && !f8)
+      type = "FE";
+    else if(isProbably0840(hits))
+      type = "0840";
+    else
+      type = "F8";
+  }
+  else if(size >= 10240 && size <= 10496)  // ~10K - Pitfall2
+  {
+    type = "DPC";
+  }
+  else if(size == 12*1024)  // 12K
+  {
+    type = "FA";
+  }
+  else if(size == 16*1024)  // 16K
+  {
+    if(isProbablySC(image, size))
+      type = "F6SC";
+    else if(isProbablyE7(hits))
+      type = "E7";
+    else if(isProbably3E(hits))
+      type = "3E";
+  /* no known 16K 3F ROMS
+    else if(isProbably3F(hits))
+      type = "3F";
+  */
+    else
+      type = "F6";
+  }
+  else if(size == 24*1024 || size == 28*1024)  // 24K & 28K
+  {
+    type = "FA2";
+  }
+  else if(size == 29*1024)  // 29K
+  {
+    if(isProbablyARM(image, size))
+      type = "FA2";
+    else /*if(isProbablyDPCplus(hits))*/
+      type = "DPC+";
+  }
+  else if(size == 32*1024)  // 32K
+  {
+    if(isProbablySC(image, size))
+      type = "F4SC";
+    else if(isProbably3E(hits))
+      type = "3E";
+    else if(isProbably3F(hits))
+      type = "3F";
+    else if(isProbablyDPCplus(hits))
+      type = "DPC+";
+    else if(isProbablyCTY(image, size))
+      type = "CTY";
+    else if(isProbablyFA2(image, size))
+      type = "FA2";
+    else
+      type = "F4";
+  }
+  else if(size == 64*1024)  // 64K
+  {
+    if(isProbably3E(hits))
+      type = "3E";
+    else if(isProbably3F(hits))
+      type = "3F";
+    else if(isProbably4A50(image, size))
+      type = "4A50";
+    else if(isProbablyEF(image, size, hits, type))
+      ; // type has been set directly in the function
+    else if(isProbablyX07(hits))
+      type = "X07";
+    else
+      type = "F0";
+  }
+  else if(size == 128*1024)  // 128K
+  {
+    if(isProbably3E(hits))
+      type = "3E";
+    else if(isProbablyDF(image, size, type))
+      ; // type has been set directly in the function
+    else if(isProbably3F(hits))
+      type = "3F";
+    else if(isProbably4A50(image, size))
+      type = "4A50";
+    else if(isProbablySB(hits))
+      type = "SB";
+    else
+      type = "MC";
+  }
+  else if(size == 256*1024)  // 256K
+  {
+    if(isProbably3E(hits))
+      type = "3E";
+    else if(isProbablyBF(image, size, type))
+      ; // type has been set directly in the function
+    else if(isProbably3F(hits))
+      type = "3F";
+    else /*if(isProbablySB(hits))*/
+      type = "SB";
+  }
+  else  // what else can we do?
+  {
+    if(isProbably3E(hits))
+      type = "3E";
+    else if(isProbably3F(hits))
+      type = "3F";
+    else
+      type = "4K";  // Most common bankswitching type
+  }
+
+  return type;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// The byte signatures searched for by autodetectType(), indexed by
+// CartDetector::Signature
+static const struct { uInt8 size; uInt8 bytes[5]; } ourSignatures[] = {
+  { 3, { 0x8D, 0xF9, 0x1F } },              // STA $1FF9
+  { 3, { 0xAD, 0x00, 0x08 } },              // LDA $0800
+  { 3, { 0xAD, 0x40, 0x08 } },              // LDA $0840
+  { 3, { 0x2C, 0x00, 0x08 } },              // BIT $0800
+  { 4, { 0x0C, 0x00, 0x08, 0x4C } },        // NOP $0800; JMP ...
+  { 4, { 0x0C, 0xFF, 0x0F, 0x4C } },        // NOP $0FFF; JMP ...
+  { 4, { 0x85, 0x3E, 0xA9, 0x00 } },        // STA $3E; LDA #$00
+  { 2, { 0x85, 0x3F } },                    // STA $3F
+  { 3, { 0x9D, 0xFF, 0xF3 } },              // STA $F3FF.X
+  { 3, { 0x99, 0x00, 0xF4 } },              // STA $F400.Y
+  { 4, { 'D', 'P', 'C', '+' } },            // DPC+
+  { 3, { 0x8D, 0xE0, 0x1F } },              // STA $1FE0
+  { 3, { 0x8D, 0xE0, 0x5F } },              // STA $5FE0
+  { 3, { 0x8D, 0xE9, 0xFF } },              // STA $FFE9
+  { 3, { 0x0C, 0xE0, 0x1F } },              // NOP $1FE0
+  { 3, { 0xAD, 0xE0, 0x1F } },              // LDA $1FE0
+  { 3, { 0xAD, 0xE9, 0xFF } },              // LDA $FFE9
+  { 3, { 0xAD, 0xED, 0xFF } },              // LDA $FFED
+  { 3, { 0xAD, 0xF3, 0xBF } },              // LDA $BFF3
+  { 3, { 0xAD, 0xE2, 0xFF } },              // LDA $FFE2
+  { 3, { 0xAD, 0xE5, 0xFF } },              // LDA $FFE5
+  { 3, { 0xAD, 0xE5, 0x1F } },              // LDA $1FE5
+  { 3, { 0xAD, 0xE7, 0x1F } },              // LDA $1FE7
+  { 3, { 0x0C, 0xE7, 0x1F } },              // NOP $1FE7
+  { 3, { 0x8D, 0xE7, 0xFF } },              // STA $FFE7
+  { 3, { 0x8D, 0xE7, 0x1F } },              // STA $1FE7
+  { 3, { 0x0C, 0xE0, 0xFF } },              // NOP $FFE0
+  { 3, { 0xAD, 0xE0, 0xFF } },              // LDA $FFE0
+  { 5, { 0x20, 0x00, 0xD0, 0xC6, 0xC5 } },  // JSR $D000; DEC $C5
+  { 5, { 0x20, 0xC3, 0xF8, 0xA5, 0x82 } },  // JSR $F8C3; LDA $82
+  { 5, { 0xD0, 0xFB, 0x20, 0x73, 0xFE } },  // BNE $FB; JSR $FE73
+  { 5, { 0x20, 0x00, 0xF0, 0x84, 0xD6 } },  // JSR $F000; STY $D6
+  { 3, { 0xBD, 0x00, 0x08 } },              // LDA $0800,x
+  { 3, { 0x8D, 0x40, 0x02 } },              // STA $240
+  { 3, { 0xAD, 0x40, 0x02 } },              // LDA $240
+  { 3, { 0xBD, 0x1F, 0x02 } },              // LDA $21F,X
+  { 3, { 0xAD, 0x0D, 0x08 } },              // LDA $080D
+  { 3, { 0xAD, 0x1D, 0x08 } },              // LDA $081D
+  { 3, { 0xAD, 0x2D, 0x08 } },              // LDA $082D
+  { 3, { 0x0C, 0x0D, 0x08 } },              // NOP $080D
+  { 3, { 0x0C, 0x1D, 0x08 } },              // NOP $081D
+  { 3, { 0x0C, 0x2D, 0x08 } }               // NOP $082D
+};
+
+/**
+  An Aho-Corasick automaton recognizing all of the signatures above.  Each
+  state has a complete transition table (failure links are already folded
+  in), and a bitmask of the signatures which end in that state.  There's
+  only ever one instance, which is built at startup, so scanning an image
+  never has to allocate or lock anything.
+*/
+static class SignatureMatcher
+{
+  public:
+    SignatureMatcher()
+      : myNumberOfStates(1)
+    {
+      memset(myNext, 0, sizeof(myNext));
+      memset(myOutput, 0, sizeof(myOutput));
+
+      // Build the trie of all signatures; 0 is the root, so it also marks
+      // a missing transition
+      for(uInt32 sig = 0; sig < sizeof(ourSignatures)/sizeof(ourSignatures[0]);
+          ++sig)
+      {
+        uInt32 state = 0;
+        for(uInt32 i = 0; i < ourSignatures[sig].size; ++i)
+        {
+          uInt8& next = myNext[state][ourSignatures[sig].bytes[i]];
+          if(next == 0)
+          {
+            assert(myNumberOfStates < kMaxStates);
+            next = myNumberOfStates++;
+          }
+          state = next;
+        }
+        myOutput[state] |= uInt64(1) << sig;
+      }
+
+      // Breadth-first, add the failure transitions, and merge in the
+      // output of each state's failure state
+      uInt8 queue[kMaxStates], fail[kMaxStates];
+      uInt32 head = 0, tail = 0;
+      fail[0] = 0;
+      for(uInt32 c = 0; c < 256; ++c)
+      {
+        if(myNext[0][c] != 0)
+        {
+          fail[myNext[0][c]] = 0;
+          queue[tail++] = myNext[0][c];
+        }
+      }
+      while(head < tail)
+      {
+        uInt8 state = queue[head++];
+        for(uInt32 c = 0; c < 256; ++c)
+        {
+          uInt8 next = myNext[state][c];
+          if(next != 0)
+          {
+            fail[next] = myNext[fail[state]][c];
+            myOutput[next] |= myOutput[fail[next]];
+            queue[tail++] = next;
+          }
+          else
+            myNext[state][c] = myNext[fail[state]][c];
+        }
+      }
+    }
+
+    uInt32 next(uInt32 state, uInt8 byte) const { return myNext[state][byte]; }
+    uInt64 output(uInt32 state) const { return myOutput[state]; }
+
+  private:
+    enum { kMaxStates = 256 };
+
+    uInt8  myNext[kMaxStates][256];
+    uInt64 myOutput[kMaxStates];
+    uInt32 myNumberOfStates;
+} ourSignatureMatcher;
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void CartDetector::scanSignatures(const uInt8* image, uInt32 size,
+                               SignatureHits& hits)
+{
+  // The earliest position at which each signature may next be counted;
+  // searchForBytes() skips past the byte following each hit
+  uInt32 allowed[NUM_SIGNATURES];
+  for(uInt32 sig = 0; sig < NUM_SIGNATURES; ++sig)
+    hits.count[sig] = allowed[sig] = 0;
+
+  // searchForBytes() never considers a signature ending on the last byte
+  uInt32 state = 0;
+  for(uInt32 i = 0; i + 1 < size; ++i)
+  {
+    state = ourSignatureMatcher.next(state, image[i]);
+
+    uInt64 output = ourSignatureMatcher.output(state);
+    for(uInt32 sig = 0; output != 0; ++sig, output >>= 1)
+    {
+      if(output & 1)
+      {
+        uInt32 start = i + 1 - ourSignatures[sig].size;
+        if(start >= allowed[sig])
+        {
+          ++hits.count[sig];
+          allowed[sig] = i + 2;
+        }
+      }
+    }
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool CartDetector::searchForBytes(const uInt8* image, uInt32 imagesize,
+                               const uInt8* signature, uInt32 sigsize,
+                               uInt32 minhits)
+{
+  uInt32 count = 0;
+  for(uInt32 i = 0; i < imagesize - sigsize; ++i)
+  {
+    uInt32 matches = 0;
+    for(uInt32 j = 0; j < sigsize; ++j)
+    {
+      if(image[i+j] == signature[j])
+        ++matches;
+      else
+        break;
+    }
+    if(matches == sigsize)
+    {
+      ++count;
+      i += sigsize;  // skip past this signature 'window' entirely
+    }
+    if(count >= minhits)
+      break;
+  }
+
+  return (count >= minhits);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool CartDetector::isProbablySC(const uInt8* image, uInt32 size)
+{
+  // We assume a Superchip cart contains the same bytes for its entire
+  // RAM area; obviously this test will fail if it doesn't
+  // The RAM area will be the first 256 bytes of each 4K bank
+  uInt32 banks = size / 4096;
+  for(uInt32 i = 0; i < banks; ++i)
+  {
+    uInt8 first = image[i*4096];
+    for(uInt32 j = 0; j < 256; ++j)
+    {
+      if(image[i*4096+j] != first)
+        return false;
+    }
+  }
+  return true;
+}
+
+bool CartDetector::isProbably4KSC(const uInt8* image, uInt32 size)
+{
+  // We check if the first 256 bytes are identical *and* if there's
+  // an "SC" signature for one of our larger SC types at 1FFA.
+
+  uInt8 first = image[0];
+  for(uInt32 i = 1; i < 256; ++i)
+      if(image[i] != first)
+        return false;
+
+  if((image[size-6]=='S') && (image[size-5]=='C'))
+      return true;
+
+  return false;
+}
+
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool CartDetector::isProbablyARM(const uInt8* image, uInt32 size)
+{
+  // ARM code contains the following 'loader' patterns in the first 1K
+  // Thanks to Thomas Jentzsch of AtariAge for this advice
+  uInt8 signature[2][4] = {
+    { 0xA0, 0xC1, 0x1F, 0xE0 },
+    { 0x00, 0x80, 0x02, 0xE0 }
+  };
+  if(searchForBytes(image, 1024, signature[0], 4, 1))
+    return true;
+  else
+    return searchForBytes(image, 1024, signature[1], 4, 1);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool CartDetector::isProbably0840(const SignatureHits& hits)
+{
+  // 0840 cart bankswitching is triggered by accessing addresses 0x0800
+  // or 0x0840 at least twice
+  return hits.found(SIG_LDA_0800, 2) || hits.found(SIG_LDA_0840, 2) ||
+         hits.found(SIG_BIT_0800, 2) ||
+         hits.found(SIG_NOP_0800_JMP, 2) || hits.found(SIG_NOP_0FFF_JMP, 2);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool CartDetector::isProbably3E(const SignatureHits& hits)
+{
+  // 3E cart bankswitching is triggered by storing the bank number
+  // in address 3E using 'STA $3E', commonly followed by an
+  // immediate mode LDA
+  return hits.found(SIG_STA_3E_LDA);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool CartDetector::isProbably3F(const SignatureHits& hits)
+{
+  // 3F cart bankswitching is triggered by storing the bank number
+  // in address 3F using 'STA $3F'
+  // We expect it will be present at least 2 times, since there are
+  // at least two banks
+  return hits.found(SIG_STA_3F, 2);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool CartDetector::isProbably4A50(const uInt8* image, uInt32 size)
+{
+  // 4A50 carts store address $4A50 at the NMI vector, which
+  // in this scheme is always in the last page of ROM at
+  // $1FFA - $1FFB (at least this is true in rev 1 of the format)
+  if(image[size-6] == 0x50 && image[size-5] == 0x4A)
+    return true;
+
+  // Program starts at $1Fxx with NOP $6Exx or NOP $6Fxx?
+  if(((image[0xfffd] & 0x1f) == 0x1f) &&
+      (image[image[0xfffd] * 256 + image[0xfffc]] == 0x0c) &&
+      ((image[image[0xfffd] * 256 + image[0xfffc] + 2] & 0xfe) == 0x6e))
+    return true;
+
+  return false;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool CartDetector::isProbablyCTY(const uInt8* image, uInt32 size)
+{
+  return false;  // TODO - add autodetection
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool CartDetector::isProbablyCV(const SignatureHits& hits)
+{
+  // CV RAM access occurs at addresses $f3ff and $f400
+  // These signatures are attributed to the MESS project
+  return hits.found(SIG_STA_F3FF_X) || hits.found(SIG_STA_F400_Y);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool CartDetector::isProbablyDPCplus(const SignatureHits& hits)
+{
+  // DPC+ ARM code has 2 occurrences of the string DPC+
+  return hits.found(SIG_DPCPLUS, 2);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool CartDetector::isProbablyE0(const SignatureHits& hits)
+{
+  // E0 cart bankswitching is triggered by accessing addresses
+  // $FE0 to $FF9 using absolute non-indexed addressing
+  // To eliminate false positives (and speed up processing), we
+  // search for only certain known signatures
+  // Thanks to "stella@casperkitty.com" for this advice
+  // These signatures are attributed to the MESS project
+  return hits.found(SIG_STA_1FE0) || hits.found(SIG_STA_5FE0) ||
+         hits.found(SIG_STA_FFE9) || hits.found(SIG_NOP_1FE0) ||
+         hits.found(SIG_LDA_1FE0) || hits.found(SIG_LDA_FFE9) ||
+         hits.found(SIG_LDA_FFED) || hits.found(SIG_LDA_BFF3);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool CartDetector::isProbablyE7(const SignatureHits& hits)
+{
+  // E7 cart bankswitching is triggered by accessing addresses
+  // $FE0 to $FE6 using absolute non-indexed addressing
+  // To eliminate false positives (and speed up processing), we
+  // search for only certain known signatures
+  // Thanks to "stella@casperkitty.com" for this advice
+  // These signatures are attributed to the MESS project
+  return hits.found(SIG_LDA_FFE2) || hits.found(SIG_LDA_FFE5) ||
+         hits.found(SIG_LDA_1FE5) || hits.found(SIG_LDA_1FE7) ||
+         hits.found(SIG_NOP_1FE7) || hits.found(SIG_STA_FFE7) ||
+         hits.found(SIG_STA_1FE7);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool CartDetector::isProbablyEF(const uInt8* image, uInt32 size,
+                             const SignatureHits& hits, const char*& type)
+{
+  // Newer EF carts store strings 'EFEF' and 'EFSC' starting at address $FFF8
+  // This signature is attributed to "RevEng" of AtariAge
+  uInt8 efef[] = { 'E', 'F', 'E', 'F' };
+  uInt8 efsc[] = { 'E', 'F', 'S', 'C' };
+  if(searchForBytes(image+size-8, 8, efef, 4, 1))
+  {
+    type = "EF";
+    return true;
+  }
+  else if(searchForBytes(image+size-8, 8, efsc, 4, 1))
+  {
+    type = "EFSC";
+    return true;
+  }
+
+  // Otherwise, EF cart bankswitching switches banks by accessing addresses
+  // 0xFE0 to 0xFEF, usually with either a NOP or LDA
+  // It's likely that the code will switch to bank 0, so that's what is tested
+  bool isEF = hits.found(SIG_NOP_FFE0) || hits.found(SIG_LDA_FFE0) ||
+              hits.found(SIG_NOP_1FE0) || hits.found(SIG_LDA_1FE0);
+
+  // Now that we know that the ROM is EF, we need to check if it's
+  // the SC variant
+  if(isEF)
+  {
+    type = isProbablySC(image, size) ? "EFSC" : "EF";
+    return true;
+  }
+
+  return false;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool CartDetector::isProbablyBF(const uInt8* image, uInt32 size, const char*& type)
+{
+  // BF carts store strings 'BFBF' and 'BFSC' starting at address $FFF8
+  // This signature is attributed to "RevEng" of AtariAge
+  uInt8 bf[] = { 'B', 'F', 'B', 'F' };
+  uInt8 bfsc[] = { 'B', 'F', 'S', 'C' };
+  if(searchForBytes(image+size-8, 8, bf, 4, 1))
+  {
+    type = "BF";
+    return true;
+  }
+  else if(searchForBytes(image+size-8, 8, bfsc, 4, 1))
+  {
+    type = "BFSC";
+    return true;
+  }
+
+  return false;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool CartDetector::isProbablyDF(const uInt8* image, uInt32 size, const char*& type)
+{
+
+  // BF carts store strings 'DFDF' and 'DFSC' starting at address $FFF8
+  // This signature is attributed to "RevEng" of AtariAge
+  uInt8 df[] = { 'D', 'F', 'D', 'F' };
+  uInt8 dfsc[] = { 'D', 'F', 'S', 'C' };
+  if(searchForBytes(image+size-8, 8, df, 4, 1))
+  {
+    type = "DF";
+    return true;
+  }
+  else if(searchForBytes(image+size-8, 8, dfsc, 4, 1))
+  {
+    type = "DFSC";
+    return true;
+  }
+
+  return false;
+}
+
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool CartDetector::isProbablyFA2(const uInt8* image, uInt32 size)
+{
+  // This currently tests only the 32K version of FA2; the 24 and 28K
+  // versions are easy, in that they're the only possibility with those
+  // file sizes
+
+  // 32K version has all zeros in 29K-32K area
+  for(uInt32 i = 29*1024; i < 32*1024; ++i)
+    if(image[i] != 0)
+      return false;
+
+  return true;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool CartDetector::isProbablyFE(const SignatureHits& hits)
+{
+  // FE bankswitching is very weird, but always seems to include a
+  // 'JSR $xxxx'
+  // These signatures are attributed to the MESS project
+  return hits.found(SIG_JSR_D000_DEC) || hits.found(SIG_JSR_F8C3_LDA) ||
+         hits.found(SIG_BNE_JSR_FE73) || hits.found(SIG_JSR_F000_STY);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool CartDetector::isProbablySB(const SignatureHits& hits)
+{
+  // SB cart bankswitching switches banks by accessing address 0x0800
+  return hits.found(SIG_LDA_0800_X) || hits.found(SIG_LDA_0800);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool CartDetector::isProbablyUA(const SignatureHits& hits)
+{
+  // UA cart bankswitching switches to bank 1 by accessing address 0x240
+  // using 'STA $240' or 'LDA $240'
+  return hits.found(SIG_STA_0240) || hits.found(SIG_LDA_0240) ||
+         hits.found(SIG_LDA_021F_X);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool CartDetector::isProbablyX07(const SignatureHits& hits)
+{
+  // X07 bankswitching switches to bank 0, 1, 2, etc by accessing address 0x08xd
+  return hits.found(SIG_LDA_080D) || hits.found(SIG_LDA_081D) ||
+         hits.found(SIG_LDA_082D) || hits.found(SIG_NOP_080D) ||
+         hits.found(SIG_NOP_081D) || hits.found(SIG_NOP_082D);
+}
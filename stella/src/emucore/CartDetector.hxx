@@ -0,0 +1,222 @@
+//============================================================================
+//
+//   SSSS    tt          lll  lll
+//  SS  SS   tt           ll   ll
+//  SS     tttttt  eeee   ll   ll   aaaa
+//   SSSS    tt   ee  ee  ll   ll      aa
+//      SS   tt   eeeeee  ll   ll   aaaaa  --  "An Atari 2600 VCS Emulator"
+//  SS  SS   tt   ee      ll   ll  aa  aa
+//   SSSS     ttt  eeeee llll llll  aaaaa
+//
+// Copyright (c) 1995-2014 by Bradford W. Mott, Stephen Anthony
+// and the Stella Team
+//
+// See the file "License.txt" for information on usage and redistribution of
+// this file, and for a DISCLAIMER OF ALL WARRANTIES.
+//
+// $Id$
+//============================================================================
+
+#ifndef CARTRIDGE_DETECTOR_HXX
+#define CARTRIDGE_DETECTOR_HXX
+
+#include "bspf.hxx"
+
+/**
+  Auto-detect the bankswitching type of a ROM image.  This is kept apart
+  from the Cartridge class so that tools which only need to classify
+  ROMs don't have to bring along the entire emulation core.
+
+  @author  Stella Team
+  @version $Id$
+*/
+class CartDetector
+{
+  public:
+    /**
+      Try to auto-detect the bankswitching type of the cartridge
+
+      @param image  A pointer to the ROM image
+      @param size   The size of the ROM image 
+      @return The "best guess" for the cartridge type
+    */
+    static string autodetectType(const uInt8* image, uInt32 size);
+
+  private:
+    /**
+      The byte signatures searched for throughout the ROM image during
+      autodetection.  The actual bytes are defined in CartDetector.cxx.
+    */
+    enum Signature {
+      SIG_STA_1FF9,                                            // F8
+      SIG_LDA_0800, SIG_LDA_0840, SIG_BIT_0800,                // 0840, SB
+      SIG_NOP_0800_JMP, SIG_NOP_0FFF_JMP,                      // 0840
+      SIG_STA_3E_LDA,                                          // 3E
+      SIG_STA_3F,                                              // 3F
+      SIG_STA_F3FF_X, SIG_STA_F400_Y,                          // CV
+      SIG_DPCPLUS,                                             // DPC+
+      SIG_STA_1FE0, SIG_STA_5FE0, SIG_STA_FFE9, SIG_NOP_1FE0,  // E0, EF
+      SIG_LDA_1FE0, SIG_LDA_FFE9, SIG_LDA_FFED, SIG_LDA_BFF3,  // E0, EF
+      SIG_LDA_FFE2, SIG_LDA_FFE5, SIG_LDA_1FE5, SIG_LDA_1FE7,  // E7
+      SIG_NOP_1FE7, SIG_STA_FFE7, SIG_STA_1FE7,                // E7
+      SIG_NOP_FFE0, SIG_LDA_FFE0,                              // EF
+      SIG_JSR_D000_DEC, SIG_JSR_F8C3_LDA,                      // FE
+      SIG_BNE_JSR_FE73, SIG_JSR_F000_STY,                      // FE
+      SIG_LDA_0800_X,                                          // SB
+      SIG_STA_0240, SIG_LDA_0240, SIG_LDA_021F_X,              // UA
+      SIG_LDA_080D, SIG_LDA_081D, SIG_LDA_082D,                // X07
+      SIG_NOP_080D, SIG_NOP_081D, SIG_NOP_082D,                // X07
+      NUM_SIGNATURES
+    };
+
+    /**
+      The number of times each signature was found in a ROM image, counted
+      the same way searchForBytes() does (ie, non-overlapping hits).
+    */
+    struct SignatureHits
+    {
+      uInt32 count[NUM_SIGNATURES];
+
+      bool found(Signature sig, uInt32 minhits = 1) const
+      {
+        return count[sig] >= minhits;
+      }
+    };
+
+    /**
+      Search the image for every signature in a single pass, rather than
+      scanning the entire image once per signature.
+
+      @param image  A pointer to the ROM image
+      @param size   The size of the ROM image
+      @param hits   Receives the number of hits for each signature
+    */
+    static void scanSignatures(const uInt8* image, uInt32 size,
+                               SignatureHits& hits);
+
+    /**
+      Search the image for the specified byte signature
+
+      @param image      A pointer to the ROM image
+      @param imagesize  The size of the ROM image 
+      @param signature  The byte sequence to search for
+      @param sigsize    The number of bytes in the signature
+      @param minhits    The minimum number of times a signature is to be found
+
+      @return  True if the signature was found at least 'minhits' time, else false
+    */
+    static bool searchForBytes(const uInt8* image, uInt32 imagesize,
+                               const uInt8* signature, uInt32 sigsize,
+                               uInt32 minhits);
+
+    /**
+      Returns true if the image is probably a SuperChip (256 bytes RAM)
+    */
+    static bool isProbablySC(const uInt8* image, uInt32 size);
+
+    /**
+      Returns true if the image is probably a 4K SuperChip (256 bytes RAM)
+    */
+    static bool isProbably4KSC(const uInt8* image, uInt32 size);
+
+    /**
+      Returns true if the image probably contains ARM code in the first 1K
+    */
+    static bool isProbablyARM(const uInt8* image, uInt32 size);
+
+    /**
+      Returns true if the image is probably a 0840 bankswitching cartridge
+    */
+    static bool isProbably0840(const SignatureHits& hits);
+
+    /**
+      Returns true if the image is probably a 3E bankswitching cartridge
+    */
+    static bool isProbably3E(const SignatureHits& hits);
+
+    /**
+      Returns true if the image is probably a 3F bankswitching cartridge
+    */
+    static bool isProbably3F(const SignatureHits& hits);
+
+    /**
+      Returns true if the image is probably a 4A50 bankswitching cartridge
+    */
+    static bool isProbably4A50(const uInt8* image, uInt32 size);
+
+    /**
+      Returns true if the image is probably a CTY bankswitching cartridge
+    */
+    static bool isProbablyCTY(const uInt8* image, uInt32 size);
+
+    /**
+      Returns true if the image is probably a CV bankswitching cartridge
+    */
+    static bool isProbablyCV(const SignatureHits& hits);
+
+    /**
+      Returns true if the image is probably a DPC+ bankswitching cartridge
+    */
+    static bool isProbablyDPCplus(const SignatureHits& hits);
+
+    /**
+      Returns true if the image is probably a E0 bankswitching cartridge
+    */
+    static bool isProbablyE0(const SignatureHits& hits);
+
+    /**
+      Returns true if the image is probably a E7 bankswitching cartridge
+    */
+    static bool isProbablyE7(const SignatureHits& hits);
+
+    /**
+      Returns true if the image is probably an EF/EFSC bankswitching cartridge
+    */
+    static bool isProbablyEF(const uInt8* image, uInt32 size,
+                             const SignatureHits& hits, const char*& type);
+
+    /**
+      Returns true if the image is probably a BF/BFSC bankswitching cartridge
+    */
+    static bool isProbablyBF(const uInt8* image, uInt32 size, const char*& type);
+    /**
+      Returns true if the image is probably a DF/DFSC bankswitching cartridge
+    */
+    static bool isProbablyDF(const uInt8* image, uInt32 size, const char*& type);
+
+    /**
+      Returns true if the image is probably an F6 bankswitching cartridge
+    */
+    static bool isProbablyF6(const uInt8* image, uInt32 size);
+
+    /**
+      Returns true if the image is probably an FA2 bankswitching cartridge
+    */
+    static bool isProbablyFA2(const uInt8* image, uInt32 size);
+
+    /**
+      Returns true if the image is probably an FE bankswitching cartridge
+    */
+    static bool isProbablyFE(const SignatureHits& hits);
+
+    /**
+      Returns true if the image is probably a SB bankswitching cartridge
+    */
+    static bool isProbablySB(const SignatureHits& hits);
+
+    /**
+      Returns true if the image is probably a UA bankswitching cartridge
+    */
+    static bool isProbablyUA(const SignatureHits& hits);
+
+    /**
+      Returns true if the image is probably an X07 bankswitching cartridge
+    */
+    static bool isProbablyX07(const SignatureHits& hits);
+
+  private:
+    // This class only has static methods
+    CartDetector();
+};
+
+#endif
@@ -234,7 +234,7 @@ bool CartridgeE0::save(Serializer& out) const
 {
   try
   {
-    out.putString(name());
+    out.putTag(name());
     out.putShortArray(myCurrentSlice, 4);
   }
   catch(...)
@@ -251,7 +251,7 @@ bool CartridgeE0::load(Serializer& in)
 {
   try
   {
-    if(in.getString() != name())
+    if(!in.checkTag(name()))
       return false;
 
     in.getShortArray(myCurrentSlice, 4);
@@ -51,7 +51,7 @@ CartridgeE7::~CartridgeE7()
 void CartridgeE7::reset()
 {
   // Initialize RAM
-  if(mySettings.getBool("ramrandom"))
+  if(mySettings.getBool(myRandomRAM))
     for(uInt32 i = 0; i < 2048; ++i)
       myRAM[i] = mySystem->randGenerator().next();
   else
@@ -300,7 +300,7 @@ bool CartridgeE7::save(Serializer& out) const
 {
   try
   {
-    out.putString(name());
+    out.putTag(name());
     out.putShortArray(myCurrentSlice, 2);
     out.putShort(myCurrentRAM);
     out.putByteArray(myRAM, 2048);
@@ -319,7 +319,7 @@ bool CartridgeE7::load(Serializer& in)
 {
   try
   {
-    if(in.getString() != name())
+    if(!in.checkTag(name()))
       return false;
 
     in.getShortArray(myCurrentSlice, 2);
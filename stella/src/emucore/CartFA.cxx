@@ -47,7 +47,7 @@ CartridgeFA::~CartridgeFA()
 void CartridgeFA::reset()
 {
   // Initialize RAM
-  if(mySettings.getBool("ramrandom"))
+  if(mySettings.getBool(myRandomRAM))
     for(uInt32 i = 0; i < 256; ++i)
       myRAM[i] = mySystem->randGenerator().next();
   else
@@ -243,7 +243,7 @@ bool CartridgeFA::save(Serializer& out) const
 {
   try
   {
-    out.putString(name());
+    out.putTag(name());
     out.putShort(myCurrentBank);
     out.putByteArray(myRAM, 256);
   }
@@ -261,7 +261,7 @@ bool CartridgeFA::load(Serializer& in)
 {
   try
   {
-    if(in.getString() != name())
+    if(!in.checkTag(name()))
       return false;
 
     myCurrentBank = in.getShort();
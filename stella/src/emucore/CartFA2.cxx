@@ -63,7 +63,7 @@ CartridgeFA2::~CartridgeFA2()
 void CartridgeFA2::reset()
 {
   // Initialize RAM
-  if(mySettings.getBool("ramrandom"))
+  if(mySettings.getBool(myRandomRAM))
     for(uInt32 i = 0; i < 256; ++i)
       myRAM[i] = mySystem->randGenerator().next();
   else
@@ -313,7 +313,7 @@ bool CartridgeFA2::save(Serializer& out) const
 {
   try
   {
-    out.putString(name());
+    out.putTag(name());
     out.putShort(myCurrentBank);
     out.putByteArray(myRAM, 256);
   }
@@ -331,7 +331,7 @@ bool CartridgeFA2::load(Serializer& in)
 {
   try
   {
-    if(in.getString() != name())
+    if(!in.checkTag(name()))
       return false;
 
     myCurrentBank = in.getShort();
@@ -160,7 +160,7 @@ bool CartridgeFE::save(Serializer& out) const
 {
   try
   {
-    out.putString(name());
+    out.putTag(name());
     out.putShort(myLastAddress1);
     out.putShort(myLastAddress2);
   }
@@ -178,7 +178,7 @@ bool CartridgeFE::load(Serializer& in)
 {
   try
   {
-    if(in.getString() != name())
+    if(!in.checkTag(name()))
       return false;
 
     myLastAddress1 = in.getShort();
@@ -55,7 +55,7 @@ CartridgeMC::~CartridgeMC()
 void CartridgeMC::reset()
 {
   // Initialize RAM
-  if(mySettings.getBool("ramrandom"))
+  if(mySettings.getBool(myRandomRAM))
     for(uInt32 i = 0; i < 32768; ++i)
       myRAM[i] = mySystem->randGenerator().next();
   else
@@ -249,7 +249,7 @@ bool CartridgeMC::save(Serializer& out) const
 {
   try
   {
-    out.putString(name());
+    out.putTag(name());
 
     // The currentBlock array
     out.putByteArray(myCurrentBlock, 4);
@@ -271,7 +271,7 @@ bool CartridgeMC::load(Serializer& in)
 {
   try
   {
-    if(in.getString() != name())
+    if(!in.checkTag(name()))
       return false;
 
     // The currentBlock array
@@ -120,9 +120,12 @@ Console::Console(OSystem* osystem, Cartridge* cart, const Properties& props)
     // The 'fastscbios' option must be changed before the system is reset
     bool fastscbios = myOSystem->settings().getBool("fastscbios");
     myOSystem->settings().setValue("fastscbios", true);
+    // Nobody hears these frames, so their sound isn't even queued
+    myOSystem->sound().setSkipping(true);
     mySystem->reset(true);  // autodetect in reset enabled
     for(int i = 0; i < 60; ++i)
       myTIA->update();
+    myOSystem->sound().setSkipping(false);
     myDisplayFormat = myTIA->isPAL() ? "PAL" : "NTSC";
     if(myProperties.get(Display_Format) == "AUTO")
     {
@@ -176,6 +179,8 @@ Console::Console(OSystem* osystem, Cartridge* cart, const Properties& props)
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Console::~Console()
 {
+  myOSystem->sound().setMusicCart(0);
+
   delete mySystem;
   delete mySwitches;
   delete myCMHandler;
@@ -465,6 +470,7 @@ void Console::initializeAudio()
   myOSystem->sound().close();
   myOSystem->sound().setChannels(sound == "STEREO" ? 2 : 1);
   myOSystem->sound().setFrameRate(myFramerate);
+  myOSystem->sound().setMusicCart(myCart);
   myOSystem->sound().open();
 
   // Make sure auto-frame calculation is only enabled when necessary
@@ -43,6 +43,10 @@
   #define DISASM_NONE  0
 #endif
 #include "Settings.hxx"
+#include "M6532.hxx"
+#ifdef PROFILER_SUPPORT
+  #include "Profiler.hxx"
+#endif
 
 #include "M6502.hxx"
 
@@ -51,6 +55,7 @@ M6502::M6502(uInt32 systemCyclesPerProcessorCycle, const Settings& settings)
   : myExecutionStatus(0),
     mySystem(0),
     mySettings(settings),
+    myRandomCPU(settings.handle("cpurandom")),
     mySystemCyclesPerProcessorCycle(systemCyclesPerProcessorCycle),
     myLastAccessWasRead(true),
     myTotalInstructionCount(0),
@@ -72,6 +77,9 @@ M6502::M6502(uInt32 systemCyclesPerProcessorCycle, const Settings& settings)
 
   myJustHitTrapFlag = false;
 #endif
+#ifdef PROFILER_SUPPORT
+  myProfiler = NULL;
+#endif
 
   // Compute the System Cycle table
   for(uInt32 t = 0; t < 256; ++t)
@@ -111,7 +119,7 @@ void M6502::reset()
 
   // Set registers to default values
   SP = 0xff;
-  if(mySettings.getBool("cpurandom"))
+  if(mySettings.getBool(myRandomCPU))
   {
     A = mySystem->randGenerator().next();
     X = mySystem->randGenerator().next();
@@ -139,6 +147,7 @@ void M6502::reset()
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+template<bool debugging>
 inline uInt8 M6502::peek(uInt16 address, uInt8 flags)
 {
   ////////////////////////////////////////////////
@@ -152,7 +161,7 @@ inline uInt8 M6502::peek(uInt16 address, uInt8 flags)
   mySystem->incrementCycles(mySystemCyclesPerProcessorCycle);
 
 #ifdef DEBUGGER_SUPPORT
-  if(myReadTraps != NULL && myReadTraps->isSet(address))
+  if(debugging && myReadTraps != NULL && myReadTraps->isSet(address))
   {
     myJustHitTrapFlag = true;
     myHitTrapInfo.message = "RTrap: ";
@@ -168,6 +177,7 @@ inline uInt8 M6502::peek(uInt16 address, uInt8 flags)
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+template<bool debugging>
 inline void M6502::poke(uInt16 address, uInt8 value)
 {
   ////////////////////////////////////////////////
@@ -181,7 +191,7 @@ inline void M6502::poke(uInt16 address, uInt8 value)
   mySystem->incrementCycles(mySystemCyclesPerProcessorCycle);
 
 #ifdef DEBUGGER_SUPPORT
-  if(myWriteTraps != NULL && myWriteTraps->isSet(address))
+  if(debugging && myWriteTraps != NULL && myWriteTraps->isSet(address))
   {
     myJustHitTrapFlag = true;
     myHitTrapInfo.message = "WTrap: ";
@@ -196,6 +206,21 @@ inline void M6502::poke(uInt16 address, uInt8 value)
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 bool M6502::execute(uInt32 number)
+{
+#ifdef DEBUGGER_SUPPORT
+  // The checks for breakpoints, traps and conditional breaks are only
+  // done while the debugger actually has something to check for;
+  // otherwise the processor runs at full speed
+  if(debuggerActive())
+    return executeInstructions<true>(number);
+#endif
+
+  return executeInstructions<false>(number);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+template<bool debugging>
+bool M6502::executeInstructions(uInt32 number)
 {
   // Clear all of the execution status bits except for the fatal error bit
   myExecutionStatus &= FatalErrorBit;
@@ -206,40 +231,54 @@ bool M6502::execute(uInt32 number)
     for(; !myExecutionStatus && (number != 0); --number)
     {
 #ifdef DEBUGGER_SUPPORT
-      if(myJustHitTrapFlag)
+      if(debugging)
       {
-        if(myDebugger && myDebugger->start(myHitTrapInfo.message, myHitTrapInfo.address))
+        if(myJustHitTrapFlag)
         {
-          myJustHitTrapFlag = false;
-          return true;
+          if(myDebugger && myDebugger->start(myHitTrapInfo.message, myHitTrapInfo.address))
+          {
+            myJustHitTrapFlag = false;
+            return true;
+          }
         }
-      }
 
-      if(myBreakPoints != NULL)
-      {
-        if(myBreakPoints->isSet(PC))
+        if(myBreakPoints != NULL)
         {
-          if(myDebugger && myDebugger->start("BP: ", PC))
-            return true;
+          if(myBreakPoints->isSet(PC))
+          {
+            if(myDebugger && myDebugger->start("BP: ", PC))
+              return true;
+          }
         }
-      }
 
-      int cond = evalCondBreaks();
-      if(cond > -1)
-      {
-        string buf = "CBP: " + myBreakCondNames[cond];
-        if(myDebugger && myDebugger->start(buf))
-          return true;
+        int cond = evalCondBreaks();
+        if(cond > -1)
+        {
+          string buf = "CBP: " + myBreakCondNames[cond];
+          if(myDebugger && myDebugger->start(buf))
+            return true;
+        }
       }
 #endif
+      // Fast-forward over loops which only poll the RIOT timer
+      // All branch instructions have opcodes of the form xxx10000
+      if((IR & 0x1f) == 0x10)
+        skipIdleLoop(number);
+
       uInt16 operandAddress = 0, intermediateAddress = 0;
       uInt8 operand = 0;
 
       // Reset the peek/poke address pointers
       myLastPeekAddress = myLastPokeAddress = myDataAddressForPoke = 0;
 
+#ifdef PROFILER_SUPPORT
+      const uInt16 profilePC = PC;
+      const uInt16 profileBank = myProfiler ? myProfiler->bank() : 0;
+      const uInt32 profileCycles = mySystem->cycles();
+#endif
+
       // Fetch instruction at the program counter
-      IR = peek(PC++, DISASM_CODE);  // This address represents a code section
+      IR = peek<debugging>(PC++, DISASM_CODE);  // This address represents a code section
 
 #ifdef DEBUG_OUTPUT
       debugStream << ::hex << setw(2) << (int)A << " "
@@ -269,6 +308,12 @@ bool M6502::execute(uInt32 number)
           myExecutionStatus |= FatalErrorBit;
       }
       myTotalInstructionCount++;
+
+#ifdef PROFILER_SUPPORT
+      if(myProfiler)
+        myProfiler->instruction(profileBank, profilePC,
+                                mySystem->cycles() - profileCycles);
+#endif
     }
 
     // See if we need to handle an interrupt
@@ -330,6 +375,153 @@ void M6502::interruptHandler()
   myExecutionStatus &= ~(MaskableInterruptBit | NonmaskableInterruptBit);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void M6502::skipIdleLoop(uInt32& number)
+{
+  // We need at least one full iteration, plus the current instruction
+  if(number < 3)
+    return;
+
+  // The loop must be read directly from memory, so that fetching its
+  // code has no side effects
+  const uInt16 head = PC;
+  uInt8 code[5];
+  for(uInt16 i = 0; i < 5; ++i)
+    if(!mySystem->peekDirect(head + i, code[i]))
+      return;
+
+  // LDA/LDX/LDY/BIT absolute, followed by a branch back to it
+  const uInt8 load = code[0], branch = code[3];
+  if((load != 0xad && load != 0xae && load != 0xac && load != 0x2c) ||
+     (branch & 0x1f) != 0x10 || code[4] != 0xfb)
+    return;
+
+  // The polled address must be handled by the RIOT
+  const uInt16 address = code[1] | ((uInt16)code[2] << 8);
+  M6532& riot = mySystem->m6532();
+  if(mySystem->getPeekDevice(address) != &riot)
+    return;
+
+  // The dummy read(s) made by a taken branch must also be side effect free
+  uInt8 dummy;
+  const uInt16 next = head + 5;
+  const bool crossed = (next ^ head) & 0xff00;
+  const uInt16 last = crossed ? ((next & 0xff00) | (head & 0x00ff)) : next;
+  if(!mySystem->peekDirect(next, dummy) ||
+     (crossed && !mySystem->peekDirect(last, dummy)))
+    return;
+
+#ifdef DEBUGGER_SUPPORT
+  // Don't skip over anything the debugger wants to know about
+  if(myJustHitTrapFlag || !myBreakConds.isEmpty() ||
+     (myBreakPoints && (myBreakPoints->isSet(head) ||
+                        myBreakPoints->isSet(head + 3))) ||
+     (myReadTraps && (myReadTraps->isSet(address) ||
+                      myReadTraps->isSet(head) || myReadTraps->isSet(next))))
+    return;
+#endif
+
+  // The polled register is read on the fourth cycle of each iteration
+  const uInt32 interval = (crossed ? 8 : 7) * mySystemCyclesPerProcessorCycle;
+  uInt8 value;
+  uInt32 iterations = riot.stableTimerReads(address,
+      mySystem->cycles() + 4 * mySystemCyclesPerProcessorCycle,
+      interval, value);
+  if(iterations == 0)
+    return;
+
+  // Determine the processor flags after the load, and whether the branch
+  // is taken (bits 7-6 select the flag, bit 5 is the value it's tested for)
+  bool n = value & 0x80, v = V, notz = value;
+  if(load == 0x2c)
+  {
+    v = value & 0x40;
+    notz = A & value;
+  }
+  bool flag;
+  switch(branch >> 6)
+  {
+    case 0:  flag = n;     break;
+    case 1:  flag = v;     break;
+    case 2:  flag = C;     break;
+    default: flag = !notz; break;
+  }
+  if(flag != (bool)(branch & 0x20))
+    return;  // The loop exits on this very read
+
+  // Leave the current instruction to be executed normally
+  if(iterations > (number - 1) / 2)
+    iterations = (number - 1) / 2;
+
+  // Account for the distinct memory accesses made by the skipped iterations
+  const uInt16 trace[8] = {
+    head, uInt16(head + 1), uInt16(head + 2), address,
+    uInt16(head + 3), uInt16(head + 4), next, last
+  };
+  const uInt32 accesses = crossed ? 8 : 7;
+  uInt32 distinct = 0;
+  for(uInt32 i = 1; i < accesses; ++i)
+    if(trace[i] != trace[i-1])
+      ++distinct;
+  myNumberOfDistinctAccesses += (trace[0] != myLastAddress ? 1 : 0) +
+      distinct + (iterations - 1) *
+      (distinct + (trace[0] != trace[accesses-1] ? 1 : 0));
+  myLastAddress = myLastPeekAddress = trace[accesses-1];
+  myLastPokeAddress = myDataAddressForPoke = 0;
+  myLastAccessWasRead = true;
+
+#ifdef DEBUGGER_SUPPORT
+  for(uInt16 i = 0; i < 5; ++i)
+    mySystem->setAccessFlags(head + i, DISASM_CODE);
+  mySystem->setAccessFlags(address, DISASM_DATA);
+#endif
+
+  // The registers and flags end up as they were after a single iteration
+  switch(load)
+  {
+    case 0xad:
+      A = value;
+      SET_LAST_PEEK(myLastSrcAddressA, address)
+      break;
+    case 0xae:
+      X = value;
+      SET_LAST_PEEK(myLastSrcAddressX, address)
+      break;
+    case 0xac:
+      Y = value;
+      SET_LAST_PEEK(myLastSrcAddressY, address)
+      break;
+  }
+  N = n;
+  V = v;
+  notZ = notz;
+  IR = branch;
+
+#ifdef PROFILER_SUPPORT
+  if(myProfiler)
+  {
+    const uInt16 bank = myProfiler->bank();
+    const uInt32 m = mySystemCyclesPerProcessorCycle;
+    myProfiler->instruction(bank, head, 4 * m, iterations);
+    myProfiler->instruction(bank, head + 3, interval - 4 * m, iterations);
+
+    // The final access is accounted for by the peek below
+    const uInt16 pageMask = mySystem->numberOfPages() - 1;
+    for(uInt32 i = 0; i < accesses; ++i)
+      myProfiler->access(mySystem->getPageAccess(
+          (trace[i] >> mySystem->pageShift()) & pageMask).device, false,
+          i < accesses - 1 ? iterations : iterations - 1);
+  }
+#endif
+
+  // The last access of an iteration determines the state of the data bus
+  mySystem->incrementCycles(iterations * interval);
+  mySystem->peek(last, DISASM_NONE);
+
+  myTotalInstructionCount += 2 * iterations;
+  number -= 2 * iterations;
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 bool M6502::save(Serializer& out) const
 {
@@ -337,7 +529,7 @@ bool M6502::save(Serializer& out) const
 
   try
   {
-    out.putString(CPU);
+    out.putTag(CPU);
 
     out.putByte(A);    // Accumulator
     out.putByte(X);    // X index register
@@ -384,7 +576,7 @@ bool M6502::load(Serializer& in)
 
   try
   {
-    if(in.getString() != CPU)
+    if(!in.checkTag(CPU))
       return false;
 
     A = in.getByte();    // Accumulator
@@ -433,6 +625,20 @@ void M6502::attach(Debugger& debugger)
   myDebugger = &debugger;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void M6502::detach()
+{
+  myDebugger = NULL;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool M6502::debuggerActive() const
+{
+  return myDebugger != NULL &&
+         (myJustHitTrapFlag || myBreakPoints != NULL || myReadTraps != NULL ||
+          myWriteTraps != NULL || !myBreakConds.isEmpty());
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 uInt32 M6502::addCondBreak(Expression *e, const string& name)
 {
@@ -25,13 +25,14 @@ class Debugger;
 class CpuDebug;
 class Expression;
 class PackedBitArray;
-class Settings;
+class Profiler;
 
 #include "bspf.hxx"
 #include "System.hxx"
 #include "Array.hxx"
 #include "StringList.hxx"
 #include "Serializable.hxx"
+#include "Settings.hxx"
 
 typedef Common::Array<Expression*> ExpressionList;
 
@@ -206,6 +207,17 @@ class M6502 : public Serializable
     */
     string name() const { return "M6502"; }
 
+#ifdef PROFILER_SUPPORT
+    /**
+      Set the profiler which collects per-instruction statistics, or
+      the null pointer to disable profiling.  Normally this is done
+      through System::setProfiler().
+
+      @param profiler  The profiler to use
+    */
+    void setProfiler(Profiler* profiler) { myProfiler = profiler; }
+#endif
+
 #ifdef DEBUGGER_SUPPORT
   public:
     /**
@@ -215,6 +227,20 @@ class M6502 : public Serializable
     */
     void attach(Debugger& debugger);
 
+    /**
+      Detach the debugger (if any), so that the processor always runs
+      without checking for breakpoints, traps and conditional breaks.
+    */
+    void detach();
+
+    /**
+      Answer whether execution currently has to check for breakpoints,
+      traps or conditional breaks.  This is only the case while a debugger
+      is attached and has at least one of them set; otherwise execute()
+      uses the same code path as a build without debugger support.
+    */
+    bool debuggerActive() const;
+
     void setBreakPoints(PackedBitArray* bp);
     void setTraps(PackedBitArray* read, PackedBitArray* write);
 
@@ -226,11 +252,21 @@ class M6502 : public Serializable
 #endif
 
   private:
+    /**
+      The main instruction loop used by execute().  It's instantiated
+      twice, so that the checks for breakpoints, traps and conditional
+      breaks are compiled out entirely when not debugging.
+
+      @param number Indicates the number of instructions to execute
+      @return true iff execution stops normally
+    */
+    template<bool debugging> bool executeInstructions(uInt32 number);
+
     /**
       Get the byte at the specified address and update the cycle count.
       Addresses marked as code are hints to the debugger/disassembler to
       conclusively determine code sections, even if the disassembler cannot
-      find them itself.
+      find them itself.  Read traps are only checked when debugging.
 
       @param address  The address from which the value should be loaded
       @param flags    Indicates that this address has the given flags
@@ -238,16 +274,16 @@ class M6502 : public Serializable
 
       @return The byte at the specified address
     */
-    uInt8 peek(uInt16 address, uInt8 flags);
+    template<bool debugging> uInt8 peek(uInt16 address, uInt8 flags);
 
     /**
       Change the byte at the specified address to the given value and
-      update the cycle count.
+      update the cycle count.  Write traps are only checked when debugging.
 
       @param address  The address where the value should be stored
       @param value    The value to be stored at the address
     */
-    void poke(uInt16 address, uInt8 value);
+    template<bool debugging> void poke(uInt16 address, uInt8 value);
 
     /**
       Get the 8-bit value of the Processor Status register.
@@ -288,6 +324,19 @@ class M6502 : public Serializable
     */
     void interruptHandler();
 
+    /**
+      Called before fetching an instruction that follows a branch.  If
+      the program counter is at the head of an idle loop that does nothing
+      but poll the RIOT timer (a LDA/LDX/LDY/BIT absolute, followed by a
+      branch back to it), the system is advanced past every iteration of
+      the loop that is guaranteed to read the same value.  All state is
+      updated exactly as if those iterations had been executed.
+
+      @param number  The number of instructions left to execute; this is
+                     reduced by the number of instructions skipped
+    */
+    void skipIdleLoop(uInt32& number);
+
   private:
     uInt8 A;    // Accumulator
     uInt8 X;    // X index register
@@ -324,6 +373,9 @@ class M6502 : public Serializable
     /// Reference to the settings
     const Settings& mySettings;
 
+    /// Handle of the 'cpurandom' setting
+    Settings::Handle myRandomCPU;
+
     /// Indicates the number of system cycles per processor cycle 
     const uInt32 mySystemCyclesPerProcessorCycle;
 
@@ -357,6 +409,11 @@ class M6502 : public Serializable
     /// is set to zero
     uInt16 myDataAddressForPoke;
 
+#ifdef PROFILER_SUPPORT
+    /// Profiler collecting statistics for each instruction, or the null pointer
+    Profiler* myProfiler;
+#endif
+
 #ifdef DEBUGGER_SUPPORT
     /// Pointer to the debugger for this processor or the null pointer
     Debugger* myDebugger;
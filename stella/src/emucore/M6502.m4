@@ -54,221 +54,221 @@
 
 
 define(M6502_IMPLIED, `{
-  peek(PC, DISASM_NONE);
+  peek<debugging>(PC, DISASM_NONE);
 }')
 
 define(M6502_IMMEDIATE_READ, `{
-  operand = peek(PC++, DISASM_CODE);
+  operand = peek<debugging>(PC++, DISASM_CODE);
 }')
 
 define(M6502_ABSOLUTE_READ, `{
-  intermediateAddress = peek(PC++, DISASM_CODE);
-  intermediateAddress |= ((uInt16)peek(PC++, DISASM_CODE) << 8);
-  operand = peek(intermediateAddress, DISASM_DATA);
+  intermediateAddress = peek<debugging>(PC++, DISASM_CODE);
+  intermediateAddress |= ((uInt16)peek<debugging>(PC++, DISASM_CODE) << 8);
+  operand = peek<debugging>(intermediateAddress, DISASM_DATA);
 }')
 
 define(M6502_ABSOLUTE_WRITE, `{
-  operandAddress = peek(PC++, DISASM_CODE);
-  operandAddress |= ((uInt16)peek(PC++, DISASM_CODE) << 8);
+  operandAddress = peek<debugging>(PC++, DISASM_CODE);
+  operandAddress |= ((uInt16)peek<debugging>(PC++, DISASM_CODE) << 8);
 }')
 
 define(M6502_ABSOLUTE_READMODIFYWRITE, `{
-  operandAddress = peek(PC++, DISASM_CODE);
-  operandAddress |= ((uInt16)peek(PC++, DISASM_CODE) << 8);
-  operand = peek(operandAddress, DISASM_DATA);
-  poke(operandAddress, operand);
+  operandAddress = peek<debugging>(PC++, DISASM_CODE);
+  operandAddress |= ((uInt16)peek<debugging>(PC++, DISASM_CODE) << 8);
+  operand = peek<debugging>(operandAddress, DISASM_DATA);
+  poke<debugging>(operandAddress, operand);
 }')
 
 define(M6502_ABSOLUTEX_READ, `{
-  uInt16 low = peek(PC++, DISASM_CODE);
-  uInt16 high = ((uInt16)peek(PC++, DISASM_CODE) << 8);
+  uInt16 low = peek<debugging>(PC++, DISASM_CODE);
+  uInt16 high = ((uInt16)peek<debugging>(PC++, DISASM_CODE) << 8);
   intermediateAddress = high | (uInt8)(low + X);
-  operand = peek(intermediateAddress, DISASM_DATA);
+  operand = peek<debugging>(intermediateAddress, DISASM_DATA);
   if((low + X) > 0xFF)
   {
     intermediateAddress = (high | low) + X;
-    operand = peek(intermediateAddress, DISASM_DATA);
+    operand = peek<debugging>(intermediateAddress, DISASM_DATA);
   }
 }')
 
 define(M6502_ABSOLUTEX_WRITE, `{
-  uInt16 low = peek(PC++, DISASM_CODE);
-  uInt16 high = ((uInt16)peek(PC++, DISASM_CODE) << 8);
-  peek(high | (uInt8)(low + X), DISASM_DATA);
+  uInt16 low = peek<debugging>(PC++, DISASM_CODE);
+  uInt16 high = ((uInt16)peek<debugging>(PC++, DISASM_CODE) << 8);
+  peek<debugging>(high | (uInt8)(low + X), DISASM_DATA);
   operandAddress = (high | low) + X;
 }')
 
 define(M6502_ABSOLUTEX_READMODIFYWRITE, `{
-  uInt16 low = peek(PC++, DISASM_CODE);
-  uInt16 high = ((uInt16)peek(PC++, DISASM_CODE) << 8);
-  peek(high | (uInt8)(low + X), DISASM_DATA);
+  uInt16 low = peek<debugging>(PC++, DISASM_CODE);
+  uInt16 high = ((uInt16)peek<debugging>(PC++, DISASM_CODE) << 8);
+  peek<debugging>(high | (uInt8)(low + X), DISASM_DATA);
   operandAddress = (high | low) + X;
-  operand = peek(operandAddress, DISASM_DATA);
-  poke(operandAddress, operand);
+  operand = peek<debugging>(operandAddress, DISASM_DATA);
+  poke<debugging>(operandAddress, operand);
 }')
 
 define(M6502_ABSOLUTEY_READ, `{
-  uInt16 low = peek(PC++, DISASM_CODE);
-  uInt16 high = ((uInt16)peek(PC++, DISASM_CODE) << 8);
+  uInt16 low = peek<debugging>(PC++, DISASM_CODE);
+  uInt16 high = ((uInt16)peek<debugging>(PC++, DISASM_CODE) << 8);
   intermediateAddress = high | (uInt8)(low + Y);
-  operand = peek(intermediateAddress, DISASM_DATA);
+  operand = peek<debugging>(intermediateAddress, DISASM_DATA);
   if((low + Y) > 0xFF)
   {
     intermediateAddress = (high | low) + Y;
-    operand = peek(intermediateAddress, DISASM_DATA);
+    operand = peek<debugging>(intermediateAddress, DISASM_DATA);
   }
 }')
 
 define(M6502_ABSOLUTEY_WRITE, `{
-  uInt16 low = peek(PC++, DISASM_CODE);
-  uInt16 high = ((uInt16)peek(PC++, DISASM_CODE) << 8);
-  peek(high | (uInt8)(low + Y), DISASM_DATA);
+  uInt16 low = peek<debugging>(PC++, DISASM_CODE);
+  uInt16 high = ((uInt16)peek<debugging>(PC++, DISASM_CODE) << 8);
+  peek<debugging>(high | (uInt8)(low + Y), DISASM_DATA);
   operandAddress = (high | low) + Y;
 }')
 
 define(M6502_ABSOLUTEY_READMODIFYWRITE, `{
-  uInt16 low = peek(PC++, DISASM_CODE);
-  uInt16 high = ((uInt16)peek(PC++, DISASM_CODE) << 8);
-  peek(high | (uInt8)(low + Y), DISASM_DATA);
+  uInt16 low = peek<debugging>(PC++, DISASM_CODE);
+  uInt16 high = ((uInt16)peek<debugging>(PC++, DISASM_CODE) << 8);
+  peek<debugging>(high | (uInt8)(low + Y), DISASM_DATA);
   operandAddress = (high | low) + Y;
-  operand = peek(operandAddress, DISASM_DATA);
-  poke(operandAddress, operand);
+  operand = peek<debugging>(operandAddress, DISASM_DATA);
+  poke<debugging>(operandAddress, operand);
 }')
 
 define(M6502_ZERO_READ, `{
-  intermediateAddress = peek(PC++, DISASM_CODE);
-  operand = peek(intermediateAddress, DISASM_DATA);
+  intermediateAddress = peek<debugging>(PC++, DISASM_CODE);
+  operand = peek<debugging>(intermediateAddress, DISASM_DATA);
 }')
 
 define(M6502_ZERO_WRITE, `{
-  operandAddress = peek(PC++, DISASM_CODE);
+  operandAddress = peek<debugging>(PC++, DISASM_CODE);
 }')
 
 define(M6502_ZERO_READMODIFYWRITE, `{
-  operandAddress = peek(PC++, DISASM_CODE);
-  operand = peek(operandAddress, DISASM_DATA);
-  poke(operandAddress, operand);
+  operandAddress = peek<debugging>(PC++, DISASM_CODE);
+  operand = peek<debugging>(operandAddress, DISASM_DATA);
+  poke<debugging>(operandAddress, operand);
 }')
 
 define(M6502_ZEROX_READ, `{
-  intermediateAddress = peek(PC++, DISASM_CODE);
-  peek(intermediateAddress, DISASM_DATA);
+  intermediateAddress = peek<debugging>(PC++, DISASM_CODE);
+  peek<debugging>(intermediateAddress, DISASM_DATA);
   intermediateAddress += X;
-  operand = peek(intermediateAddress, DISASM_DATA);
+  operand = peek<debugging>(intermediateAddress, DISASM_DATA);
 }')
 
 define(M6502_ZEROX_WRITE, `{
-  operandAddress = peek(PC++, DISASM_CODE);
-  peek(operandAddress, DISASM_DATA);
+  operandAddress = peek<debugging>(PC++, DISASM_CODE);
+  peek<debugging>(operandAddress, DISASM_DATA);
   operandAddress = (operandAddress + X) & 0xFF;
 }')
 
 define(M6502_ZEROX_READMODIFYWRITE, `{
-  operandAddress = peek(PC++, DISASM_CODE);
-  peek(operandAddress, DISASM_DATA);
+  operandAddress = peek<debugging>(PC++, DISASM_CODE);
+  peek<debugging>(operandAddress, DISASM_DATA);
   operandAddress = (operandAddress + X) & 0xFF;
-  operand = peek(operandAddress, DISASM_DATA);
-  poke(operandAddress, operand);
+  operand = peek<debugging>(operandAddress, DISASM_DATA);
+  poke<debugging>(operandAddress, operand);
 }')
 
 define(M6502_ZEROY_READ, `{
-  intermediateAddress = peek(PC++, DISASM_CODE);
-  peek(intermediateAddress, DISASM_DATA);
+  intermediateAddress = peek<debugging>(PC++, DISASM_CODE);
+  peek<debugging>(intermediateAddress, DISASM_DATA);
   intermediateAddress += Y;
-  operand = peek(intermediateAddress, DISASM_DATA);
+  operand = peek<debugging>(intermediateAddress, DISASM_DATA);
 }')
 
 define(M6502_ZEROY_WRITE, `{
-  operandAddress = peek(PC++, DISASM_CODE);
-  peek(operandAddress, DISASM_DATA);
+  operandAddress = peek<debugging>(PC++, DISASM_CODE);
+  peek<debugging>(operandAddress, DISASM_DATA);
   operandAddress = (operandAddress + Y) & 0xFF;
 }')
 
 define(M6502_ZEROY_READMODIFYWRITE, `{
-  operandAddress = peek(PC++, DISASM_CODE);
-  peek(operandAddress, DISASM_DATA);
+  operandAddress = peek<debugging>(PC++, DISASM_CODE);
+  peek<debugging>(operandAddress, DISASM_DATA);
   operandAddress = (operandAddress + Y) & 0xFF;
-  operand = peek(operandAddress, DISASM_DATA);
-  poke(operandAddress, operand);
+  operand = peek<debugging>(operandAddress, DISASM_DATA);
+  poke<debugging>(operandAddress, operand);
 }')
 
 define(M6502_INDIRECT, `{
-  uInt16 addr = peek(PC++, DISASM_CODE);
-  addr |= ((uInt16)peek(PC++, DISASM_CODE) << 8);
+  uInt16 addr = peek<debugging>(PC++, DISASM_CODE);
+  addr |= ((uInt16)peek<debugging>(PC++, DISASM_CODE) << 8);
 
   // Simulate the error in the indirect addressing mode!
   uInt16 high = NOTSAMEPAGE(addr, addr + 1) ? (addr & 0xff00) : (addr + 1);
 
-  operandAddress = peek(addr, DISASM_DATA);
-  operandAddress |= ((uInt16)peek(high, DISASM_DATA) << 8);
+  operandAddress = peek<debugging>(addr, DISASM_DATA);
+  operandAddress |= ((uInt16)peek<debugging>(high, DISASM_DATA) << 8);
 }')
 
 define(M6502_INDIRECTX_READ, `{
-  uInt8 pointer = peek(PC++, DISASM_CODE);
-  peek(pointer, DISASM_DATA);
+  uInt8 pointer = peek<debugging>(PC++, DISASM_CODE);
+  peek<debugging>(pointer, DISASM_DATA);
   pointer += X;
-  intermediateAddress = peek(pointer++, DISASM_DATA);
-  intermediateAddress |= ((uInt16)peek(pointer, DISASM_DATA) << 8);
-  operand = peek(intermediateAddress, DISASM_DATA);
+  intermediateAddress = peek<debugging>(pointer++, DISASM_DATA);
+  intermediateAddress |= ((uInt16)peek<debugging>(pointer, DISASM_DATA) << 8);
+  operand = peek<debugging>(intermediateAddress, DISASM_DATA);
 }')
 
 define(M6502_INDIRECTX_WRITE, `{
-  uInt8 pointer = peek(PC++, DISASM_CODE);
-  peek(pointer, DISASM_DATA);
+  uInt8 pointer = peek<debugging>(PC++, DISASM_CODE);
+  peek<debugging>(pointer, DISASM_DATA);
   pointer += X;
-  operandAddress = peek(pointer++, DISASM_DATA);
-  operandAddress |= ((uInt16)peek(pointer, DISASM_DATA) << 8);
+  operandAddress = peek<debugging>(pointer++, DISASM_DATA);
+  operandAddress |= ((uInt16)peek<debugging>(pointer, DISASM_DATA) << 8);
 }')
 
 define(M6502_INDIRECTX_READMODIFYWRITE, `{
-  uInt8 pointer = peek(PC++, DISASM_CODE);
-  peek(pointer, DISASM_DATA);
+  uInt8 pointer = peek<debugging>(PC++, DISASM_CODE);
+  peek<debugging>(pointer, DISASM_DATA);
   pointer += X;
-  operandAddress = peek(pointer++, DISASM_DATA);
-  operandAddress |= ((uInt16)peek(pointer, DISASM_DATA) << 8);
-  operand = peek(operandAddress, DISASM_DATA);
-  poke(operandAddress, operand);
+  operandAddress = peek<debugging>(pointer++, DISASM_DATA);
+  operandAddress |= ((uInt16)peek<debugging>(pointer, DISASM_DATA) << 8);
+  operand = peek<debugging>(operandAddress, DISASM_DATA);
+  poke<debugging>(operandAddress, operand);
 }')
 
 define(M6502_INDIRECTY_READ, `{
-  uInt8 pointer = peek(PC++, DISASM_CODE);
-  uInt16 low = peek(pointer++, DISASM_DATA);
-  uInt16 high = ((uInt16)peek(pointer, DISASM_DATA) << 8);
+  uInt8 pointer = peek<debugging>(PC++, DISASM_CODE);
+  uInt16 low = peek<debugging>(pointer++, DISASM_DATA);
+  uInt16 high = ((uInt16)peek<debugging>(pointer, DISASM_DATA) << 8);
   intermediateAddress = high | (uInt8)(low + Y);
-  operand = peek(intermediateAddress, DISASM_DATA);
+  operand = peek<debugging>(intermediateAddress, DISASM_DATA);
   if((low + Y) > 0xFF)
   {
     intermediateAddress = (high | low) + Y;
-    operand = peek(intermediateAddress, DISASM_DATA);
+    operand = peek<debugging>(intermediateAddress, DISASM_DATA);
   }
 }')
 
 define(M6502_INDIRECTY_WRITE, `{
-  uInt8 pointer = peek(PC++, DISASM_CODE);
-  uInt16 low = peek(pointer++, DISASM_DATA);
-  uInt16 high = ((uInt16)peek(pointer, DISASM_DATA) << 8);
-  peek(high | (uInt8)(low + Y), DISASM_DATA);
+  uInt8 pointer = peek<debugging>(PC++, DISASM_CODE);
+  uInt16 low = peek<debugging>(pointer++, DISASM_DATA);
+  uInt16 high = ((uInt16)peek<debugging>(pointer, DISASM_DATA) << 8);
+  peek<debugging>(high | (uInt8)(low + Y), DISASM_DATA);
   operandAddress = (high | low) + Y;
 }')
 
 define(M6502_INDIRECTY_READMODIFYWRITE, `{
-  uInt8 pointer = peek(PC++, DISASM_CODE);
-  uInt16 low = peek(pointer++, DISASM_DATA);
-  uInt16 high = ((uInt16)peek(pointer, DISASM_DATA) << 8);
-  peek(high | (uInt8)(low + Y), DISASM_DATA);
+  uInt8 pointer = peek<debugging>(PC++, DISASM_CODE);
+  uInt16 low = peek<debugging>(pointer++, DISASM_DATA);
+  uInt16 high = ((uInt16)peek<debugging>(pointer, DISASM_DATA) << 8);
+  peek<debugging>(high | (uInt8)(low + Y), DISASM_DATA);
   operandAddress = (high | low) + Y;
-  operand = peek(operandAddress, DISASM_DATA);
-  poke(operandAddress, operand);
+  operand = peek<debugging>(operandAddress, DISASM_DATA);
+  poke<debugging>(operandAddress, operand);
 }')
 
 
 define(M6502_BCC, `{
   if(!C)
   {
-    peek(PC, DISASM_NONE);
+    peek<debugging>(PC, DISASM_NONE);
     uInt16 address = PC + (Int8)operand;
     if(NOTSAMEPAGE(PC, address))
-      peek((PC & 0xFF00) | (address & 0x00FF), DISASM_NONE);
+      peek<debugging>((PC & 0xFF00) | (address & 0x00FF), DISASM_NONE);
     PC = address;
   }
 }')
@@ -276,10 +276,10 @@ define(M6502_BCC, `{
 define(M6502_BCS, `{
   if(C)
   {
-    peek(PC, DISASM_NONE);
+    peek<debugging>(PC, DISASM_NONE);
     uInt16 address = PC + (Int8)operand;
     if(NOTSAMEPAGE(PC, address))
-      peek((PC & 0xFF00) | (address & 0x00FF), DISASM_NONE);
+      peek<debugging>((PC & 0xFF00) | (address & 0x00FF), DISASM_NONE);
     PC = address;
   }
 }')
@@ -287,10 +287,10 @@ define(M6502_BCS, `{
 define(M6502_BEQ, `{
   if(!notZ)
   {
-    peek(PC, DISASM_NONE);
+    peek<debugging>(PC, DISASM_NONE);
     uInt16 address = PC + (Int8)operand;
     if(NOTSAMEPAGE(PC, address))
-      peek((PC & 0xFF00) | (address & 0x00FF), DISASM_NONE);
+      peek<debugging>((PC & 0xFF00) | (address & 0x00FF), DISASM_NONE);
     PC = address;
   }
 }')
@@ -298,10 +298,10 @@ define(M6502_BEQ, `{
 define(M6502_BMI, `{
   if(N)
   {
-    peek(PC, DISASM_NONE);
+    peek<debugging>(PC, DISASM_NONE);
     uInt16 address = PC + (Int8)operand;
     if(NOTSAMEPAGE(PC, address))
-      peek((PC & 0xFF00) | (address & 0x00FF), DISASM_NONE);
+      peek<debugging>((PC & 0xFF00) | (address & 0x00FF), DISASM_NONE);
     PC = address;
   }
 }')
@@ -309,10 +309,10 @@ define(M6502_BMI, `{
 define(M6502_BNE, `{
   if(notZ)
   {
-    peek(PC, DISASM_NONE);
+    peek<debugging>(PC, DISASM_NONE);
     uInt16 address = PC + (Int8)operand;
     if(NOTSAMEPAGE(PC, address))
-      peek((PC & 0xFF00) | (address & 0x00FF), DISASM_NONE);
+      peek<debugging>((PC & 0xFF00) | (address & 0x00FF), DISASM_NONE);
     PC = address;
   }
 }')
@@ -320,10 +320,10 @@ define(M6502_BNE, `{
 define(M6502_BPL, `{
   if(!N)
   {
-    peek(PC, DISASM_NONE);
+    peek<debugging>(PC, DISASM_NONE);
     uInt16 address = PC + (Int8)operand;
     if(NOTSAMEPAGE(PC, address))
-      peek((PC & 0xFF00) | (address & 0x00FF), DISASM_NONE);
+      peek<debugging>((PC & 0xFF00) | (address & 0x00FF), DISASM_NONE);
     PC = address;
   }
 }')
@@ -331,10 +331,10 @@ define(M6502_BPL, `{
 define(M6502_BVC, `{
   if(!V)
   {
-    peek(PC, DISASM_NONE);
+    peek<debugging>(PC, DISASM_NONE);
     uInt16 address = PC + (Int8)operand;
     if(NOTSAMEPAGE(PC, address))
-      peek((PC & 0xFF00) | (address & 0x00FF), DISASM_NONE);
+      peek<debugging>((PC & 0xFF00) | (address & 0x00FF), DISASM_NONE);
     PC = address;
   }
 }')
@@ -342,10 +342,10 @@ define(M6502_BVC, `{
 define(M6502_BVS, `{
   if(V)
   {
-    peek(PC, DISASM_NONE);
+    peek<debugging>(PC, DISASM_NONE);
     uInt16 address = PC + (Int8)operand;
     if(NOTSAMEPAGE(PC, address))
-      peek((PC & 0xFF00) | (address & 0x00FF), DISASM_NONE);
+      peek<debugging>((PC & 0xFF00) | (address & 0x00FF), DISASM_NONE);
     PC = address;
   }
 }')
@@ -449,7 +449,7 @@ define(M6502_ASL, `{
   C = operand & 0x80;
 
   operand <<= 1;
-  poke(operandAddress, operand);
+  poke<debugging>(operandAddress, operand);
 
   notZ = operand;
   N = operand & 0x80;
@@ -484,18 +484,18 @@ define(M6502_BIT, `{
 }')
 
 define(M6502_BRK, `{
-  peek(PC++, DISASM_CODE);
+  peek<debugging>(PC++, DISASM_CODE);
 
   B = true;
 
-  poke(0x0100 + SP--, PC >> 8);
-  poke(0x0100 + SP--, PC & 0x00ff);
-  poke(0x0100 + SP--, PS());
+  poke<debugging>(0x0100 + SP--, PC >> 8);
+  poke<debugging>(0x0100 + SP--, PC & 0x00ff);
+  poke<debugging>(0x0100 + SP--, PS());
 
   I = true;
 
-  PC = peek(0xfffe, DISASM_NONE);
-  PC |= ((uInt16)peek(0xffff, DISASM_NONE) << 8);
+  PC = peek<debugging>(0xfffe, DISASM_NONE);
+  PC |= ((uInt16)peek<debugging>(0xffff, DISASM_NONE) << 8);
 }')
 
 define(M6502_CLC, `{
@@ -540,7 +540,7 @@ define(M6502_CPY, `{
 
 define(M6502_DCP, `{
   uInt8 value = operand - 1;
-  poke(operandAddress, value);
+  poke<debugging>(operandAddress, value);
 
   uInt16 value2 = (uInt16)A - (uInt16)value;
   notZ = value2;
@@ -550,7 +550,7 @@ define(M6502_DCP, `{
 
 define(M6502_DEC, `{
   uInt8 value = operand - 1;
-  poke(operandAddress, value);
+  poke<debugging>(operandAddress, value);
 
   notZ = value;
   N = value & 0x80;
@@ -579,7 +579,7 @@ define(M6502_EOR, `{
 
 define(M6502_INC, `{
   uInt8 value = operand + 1;
-  poke(operandAddress, value);
+  poke<debugging>(operandAddress, value);
 
   notZ = value;
   N = value & 0x80;
@@ -599,7 +599,7 @@ define(M6502_INY, `{
 
 define(M6502_ISB, `{
   operand = operand + 1;
-  poke(operandAddress, operand);
+  poke<debugging>(operandAddress, operand);
 
   // N, V, Z, C flags are the same in either mode (C calculated at the end)
   Int32 sum = A - operand - (C ? 0 : 1);
@@ -633,16 +633,16 @@ define(M6502_JMP, `{
 }')
 
 define(M6502_JSR, `{
-  uInt8 low = peek(PC++, DISASM_CODE);
-  peek(0x0100 + SP, DISASM_NONE);
+  uInt8 low = peek<debugging>(PC++, DISASM_CODE);
+  peek<debugging>(0x0100 + SP, DISASM_NONE);
 
   // It seems that the 650x does not push the address of the next instruction
   // on the stack it actually pushes the address of the next instruction
   // minus one.  This is compensated for in the RTS instruction
-  poke(0x0100 + SP--, PC >> 8);
-  poke(0x0100 + SP--, PC & 0xff);
+  poke<debugging>(0x0100 + SP--, PC >> 8);
+  poke<debugging>(0x0100 + SP--, PC & 0xff);
 
-  PC = (low | ((uInt16)peek(PC, DISASM_CODE) << 8));
+  PC = (low | ((uInt16)peek<debugging>(PC, DISASM_CODE) << 8));
 }')
 
 define(M6502_LAS, `{
@@ -681,7 +681,7 @@ define(M6502_LSR, `{
   C = operand & 0x01;
 
   operand = (operand >> 1) & 0x7f;
-  poke(operandAddress, operand);
+  poke<debugging>(operandAddress, operand);
 
   notZ = operand;
   N = operand & 0x80;
@@ -716,28 +716,28 @@ define(M6502_ORA, `{
 }')
 
 define(M6502_PHA, `{
-  poke(0x0100 + SP--, A);
+  poke<debugging>(0x0100 + SP--, A);
 }')
 
 define(M6502_PHP, `{
-  poke(0x0100 + SP--, PS());
+  poke<debugging>(0x0100 + SP--, PS());
 }')
 
 define(M6502_PLA, `{
-  peek(0x0100 + SP++, DISASM_NONE);
-  A = peek(0x0100 + SP, DISASM_NONE);
+  peek<debugging>(0x0100 + SP++, DISASM_NONE);
+  A = peek<debugging>(0x0100 + SP, DISASM_NONE);
   notZ = A;
   N = A & 0x80;
 }')
 
 define(M6502_PLP, `{
-  peek(0x0100 + SP++, DISASM_NONE);
-  PS(peek(0x0100 + SP, DISASM_NONE));
+  peek<debugging>(0x0100 + SP++, DISASM_NONE);
+  PS(peek<debugging>(0x0100 + SP, DISASM_NONE));
 }')
 
 define(M6502_RLA, `{
   uInt8 value = (operand << 1) | (C ? 1 : 0);
-  poke(operandAddress, value);
+  poke<debugging>(operandAddress, value);
 
   A &= value;
   C = operand & 0x80;
@@ -752,7 +752,7 @@ define(M6502_ROL, `{
   C = operand & 0x80;
 
   operand = (operand << 1) | (oldC ? 1 : 0);
-  poke(operandAddress, operand);
+  poke<debugging>(operandAddress, operand);
 
   notZ = operand;
   N = operand & 0x80;
@@ -777,7 +777,7 @@ define(M6502_ROR, `{
   C = operand & 0x01;
 
   operand = ((operand >> 1) & 0x7f) | (oldC ? 0x80 : 0x00);
-  poke(operandAddress, operand);
+  poke<debugging>(operandAddress, operand);
 
   notZ = operand;
   N = operand & 0x80;
@@ -802,7 +802,7 @@ define(M6502_RRA, `{
   C = operand & 0x01;
 
   operand = ((operand >> 1) & 0x7f) | (oldC ? 0x80 : 0x00);
-  poke(operandAddress, operand);
+  poke<debugging>(operandAddress, operand);
 
   if(!D)
   {
@@ -835,21 +835,21 @@ define(M6502_RRA, `{
 }')
 
 define(M6502_RTI, `{
-  peek(0x0100 + SP++, DISASM_NONE);
-  PS(peek(0x0100 + SP++, DISASM_NONE));
-  PC = peek(0x0100 + SP++, DISASM_NONE);
-  PC |= ((uInt16)peek(0x0100 + SP, DISASM_NONE) << 8);
+  peek<debugging>(0x0100 + SP++, DISASM_NONE);
+  PS(peek<debugging>(0x0100 + SP++, DISASM_NONE));
+  PC = peek<debugging>(0x0100 + SP++, DISASM_NONE);
+  PC |= ((uInt16)peek<debugging>(0x0100 + SP, DISASM_NONE) << 8);
 }')
 
 define(M6502_RTS, `{
-  peek(0x0100 + SP++, DISASM_NONE);
-  PC = peek(0x0100 + SP++, DISASM_NONE);
-  PC |= ((uInt16)peek(0x0100 + SP, DISASM_NONE) << 8);
-  peek(PC++, DISASM_CODE);
+  peek<debugging>(0x0100 + SP++, DISASM_NONE);
+  PC = peek<debugging>(0x0100 + SP++, DISASM_NONE);
+  PC |= ((uInt16)peek<debugging>(0x0100 + SP, DISASM_NONE) << 8);
+  peek<debugging>(PC++, DISASM_CODE);
 }')
 
 define(M6502_SAX, `{
-  poke(operandAddress, A & X);
+  poke<debugging>(operandAddress, A & X);
 }')
 
 define(M6502_SBC, `{
@@ -904,26 +904,26 @@ define(M6502_SEI, `{
 define(M6502_SHA, `{
   // NOTE: There are mixed reports on the actual operation
   // of this instruction!
-  poke(operandAddress, A & X & (((operandAddress >> 8) & 0xff) + 1)); 
+  poke<debugging>(operandAddress, A & X & (((operandAddress >> 8) & 0xff) + 1)); 
 }')
 
 define(M6502_SHS, `{
   // NOTE: There are mixed reports on the actual operation
   // of this instruction!
   SP = A & X;
-  poke(operandAddress, A & X & (((operandAddress >> 8) & 0xff) + 1)); 
+  poke<debugging>(operandAddress, A & X & (((operandAddress >> 8) & 0xff) + 1)); 
 }')
 
 define(M6502_SHX, `{
   // NOTE: There are mixed reports on the actual operation
   // of this instruction!
-  poke(operandAddress, X & (((operandAddress >> 8) & 0xff) + 1)); 
+  poke<debugging>(operandAddress, X & (((operandAddress >> 8) & 0xff) + 1)); 
 }')
 
 define(M6502_SHY, `{
   // NOTE: There are mixed reports on the actual operation
   // of this instruction!
-  poke(operandAddress, Y & (((operandAddress >> 8) & 0xff) + 1)); 
+  poke<debugging>(operandAddress, Y & (((operandAddress >> 8) & 0xff) + 1)); 
 }')
 
 define(M6502_SLO, `{
@@ -931,7 +931,7 @@ define(M6502_SLO, `{
   C = operand & 0x80;
 
   operand <<= 1;
-  poke(operandAddress, operand);
+  poke<debugging>(operandAddress, operand);
 
   A |= operand;
   notZ = A;
@@ -943,7 +943,7 @@ define(M6502_SRE, `{
   C = operand & 0x01;
 
   operand = (operand >> 1) & 0x7f;
-  poke(operandAddress, operand);
+  poke<debugging>(operandAddress, operand);
 
   A ^= operand;
   notZ = A;
@@ -951,15 +951,15 @@ define(M6502_SRE, `{
 }')
 
 define(M6502_STA, `{
-  poke(operandAddress, A);
+  poke<debugging>(operandAddress, A);
 }')
 
 define(M6502_STX, `{
-  poke(operandAddress, X);
+  poke<debugging>(operandAddress, X);
 }')
 
 define(M6502_STY, `{
-  poke(operandAddress, Y);
+  poke<debugging>(operandAddress, Y);
 }')
 
 define(M6502_TAX, `{
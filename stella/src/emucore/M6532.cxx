@@ -30,7 +30,8 @@
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 M6532::M6532(const Console& console, const Settings& settings)
   : myConsole(console),
-    mySettings(settings)
+    mySettings(settings),
+    myRandomRAM(settings.handle("ramrandom"))
 {
 }
  
@@ -43,7 +44,7 @@ M6532::~M6532()
 void M6532::reset()
 {
   // Initialize the 128 bytes of memory
-  if(mySettings.getBool("ramrandom"))
+  if(mySettings.getBool(myRandomRAM))
     for(uInt32 t = 0; t < 128; ++t)
       myRAM[t] = mySystem->randGenerator().next();
   else
@@ -287,6 +288,48 @@ bool M6532::poke(uInt16 addr, uInt8 value)
   return true;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+uInt32 M6532::stableTimerReads(uInt16 addr, uInt32 cycles, uInt32 interval,
+                               uInt8& value) const
+{
+  // Only INTIM and TIMINT can be predicted; RAM and the I/O ports depend
+  // on things outside the RIOT
+  if((addr & 0x1080) != 0x0080 || (addr & 0x0200) == 0x0000 ||
+     (addr & 0x04) == 0x00)
+    return 0;
+
+  // Number of clocks since timer was set, at the time of the first read
+  Int32 timer = myTimer - (cycles - myCyclesWhenTimerSet);
+
+  if(addr & 0x01)   // TIMINT/INSTAT - Interrupt Flag
+  {
+    // Reading TIMINT clears the PA7 flag, so it must already be clear
+    if(myInterruptFlag & PA7Bit)
+      return 0;
+
+    value = myInterruptFlag;
+
+    // Once the timer flag is valid, only writing the timer changes it;
+    // otherwise it's updated by the first read after the timer expires
+    if(myTimerFlagValid)
+      return 0xffffffff;
+    else
+      return timer >= 0 ? timer / interval + 1 : 0;
+  }
+  else              // INTIM - Timer Output
+  {
+    // Reading INTIM clears the timer flag, so it must already be clear.
+    // After the timer expires each read can also update the flag, and
+    // the value changes every cycle anyway, so that isn't predicted.
+    if((myInterruptFlag & TimerBit) || timer < 0)
+      return 0;
+
+    // The value stays the same until the current interval runs out
+    value = (timer >> myIntervalShift) & 0xff;
+    return (timer & ((1 << myIntervalShift) - 1)) / interval + 1;
+  }
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void M6532::setTimerRegister(uInt8 value, uInt8 interval)
 {
@@ -341,7 +384,7 @@ bool M6532::save(Serializer& out) const
 {
   try
   {
-    out.putString(name());
+    out.putTag(name());
 
     out.putByteArray(myRAM, 128);
 
@@ -373,7 +416,7 @@ bool M6532::load(Serializer& in)
 {
   try
   {
-    if(in.getString() != name())
+    if(!in.checkTag(name()))
       return false;
 
     in.getByteArray(myRAM, 128);
@@ -447,7 +490,8 @@ Int32 M6532::intimClocks() const
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 M6532::M6532(const M6532& c)
   : myConsole(c.myConsole),
-    mySettings(c.mySettings)
+    mySettings(c.mySettings),
+    myRandomRAM(c.myRandomRAM)
 {
   assert(false);
 }
@@ -22,11 +22,11 @@
 
 class Console;
 class RiotDebug;
-class Settings;
 
 #include "bspf.hxx"
 #include "Device.hxx"
 #include "System.hxx"
+#include "Settings.hxx"
 
 /**
   This class models the M6532 RAM-I/O-Timer (aka RIOT) chip in the 2600
@@ -139,6 +139,25 @@ class M6532 : public Device
     */
     bool poke(uInt16 address, uInt8 value);
 
+    /**
+      Answer how many consecutive reads of the timer register at the
+      given address (INTIM or TIMINT) are guaranteed to return the same
+      value without changing the state of the RIOT.  The first read is
+      assumed to happen at system cycle 'cycles', and each one after that
+      'interval' cycles later.  This allows the CPU to fast-forward over
+      loops that do nothing but poll the timer.
+
+      @param address  The address of the register being polled
+      @param cycles   The system cycle at which the first read occurs
+      @param interval The number of system cycles between reads
+      @param value    The value returned by each of those reads
+
+      @return  The number of such reads (zero if the register can't be
+               predicted)
+    */
+    uInt32 stableTimerReads(uInt16 address, uInt32 cycles, uInt32 interval,
+                            uInt8& value) const;
+
   private:
     Int32 timerClocks() const
       { return myTimer - (mySystem->cycles() - myCyclesWhenTimerSet); }
@@ -167,6 +186,9 @@ class M6532 : public Device
     // Reference to the settings
     const Settings& mySettings;
 
+    // Handle of the 'ramrandom' setting
+    Settings::Handle myRandomRAM;
+
     // An amazing 128 bytes of RAM
     uInt8 myRAM[128];
 
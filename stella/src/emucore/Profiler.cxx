@@ -0,0 +1,192 @@
+//============================================================================
+//
+//   SSSS    tt          lll  lll
+//  SS  SS   tt           ll   ll
+//  SS     tttttt  eeee   ll   ll   aaaa
+//   SSSS    tt   ee  ee  ll   ll      aa
+//      SS   tt   eeeeee  ll   ll   aaaaa  --  "An Atari 2600 VCS Emulator"
+//  SS  SS   tt   ee      ll   ll  aa  aa
+//   SSSS     ttt  eeeee llll llll  aaaaa
+//
+// Copyright (c) 1995-2014 by Bradford W. Mott, Stephen Anthony
+// and the Stella Team
+//
+// See the file "License.txt" for information on usage and redistribution of
+// this file, and for a DISCLAIMER OF ALL WARRANTIES.
+//
+// $Id$
+//============================================================================
+
+#include <fstream>
+
+#include "Device.hxx"
+#include "Serializer.hxx"
+
+#include "Profiler.hxx"
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Profiler::Profiler(const Cartridge& cart, const string& md5)
+  : myCart(cart),
+    myMD5(md5),
+    myNumberOfDevices(0)
+{
+  for(uInt32 i = 0; i < kMaxBanks; ++i)
+    myBanks[i] = 0;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Profiler::~Profiler()
+{
+  for(uInt32 i = 0; i < kMaxBanks; ++i)
+    delete[] myBanks[i];
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Profiler::reset()
+{
+  for(uInt32 i = 0; i < kMaxBanks; ++i)
+  {
+    delete[] myBanks[i];
+    myBanks[i] = 0;
+  }
+  myNumberOfDevices = 0;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Profiler::PCEntry* Profiler::createBankTable(uInt16 bank)
+{
+  PCEntry* table = new PCEntry[kAddressMask + 1];
+  memset(table, 0, (kAddressMask + 1) * sizeof(PCEntry));
+
+  return myBanks[bank] = table;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Profiler::DeviceEntry& Profiler::createDeviceEntry(const Device* device)
+{
+  // If we somehow run out of room, the last entry collects the remainder
+  if(myNumberOfDevices == kMaxDevices)
+    return myDevices[kMaxDevices - 1];
+
+  DeviceEntry& entry = myDevices[myNumberOfDevices++];
+  entry.device = device;
+  entry.reads = entry.writes = 0;
+
+  return entry;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+uInt64 Profiler::totalInstructions() const
+{
+  uInt64 total = 0;
+  for(uInt32 bank = 0; bank < kMaxBanks; ++bank)
+    if(myBanks[bank])
+      for(uInt32 pc = 0; pc <= kAddressMask; ++pc)
+        total += myBanks[bank][pc].instructions;
+
+  return total;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+uInt64 Profiler::totalCycles() const
+{
+  uInt64 total = 0;
+  for(uInt32 bank = 0; bank < kMaxBanks; ++bank)
+    if(myBanks[bank])
+      for(uInt32 pc = 0; pc <= kAddressMask; ++pc)
+        total += myBanks[bank][pc].cycles;
+
+  return total;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool Profiler::saveCSV(const string& filename) const
+{
+  ofstream out(filename.c_str());
+  if(!out.is_open())
+    return false;
+
+  out << "# Stella profile for " << myMD5 << endl
+      << "bank,pc,instructions,cycles" << endl;
+  for(uInt32 bank = 0; bank < kMaxBanks; ++bank)
+  {
+    if(!myBanks[bank])
+      continue;
+
+    for(uInt32 pc = 0; pc <= kAddressMask; ++pc)
+    {
+      const PCEntry& entry = myBanks[bank][pc];
+      if(entry.instructions)
+        out << dec << bank << "," << hex << uppercase << setw(4)
+            << setfill('0') << pc << "," << dec << entry.instructions << ","
+            << entry.cycles << endl;
+    }
+  }
+
+  out << endl << "device,reads,writes" << endl;
+  for(uInt32 i = 0; i < myNumberOfDevices; ++i)
+    out << myDevices[i].device->name() << "," << myDevices[i].reads << ","
+        << myDevices[i].writes << endl;
+
+  return out.good();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool Profiler::saveBinary(const string& filename) const
+{
+  Serializer out(filename, false, true);
+  if(!out.isValid())
+    return false;
+
+  try
+  {
+    out.putString("StellaProfile");
+    out.putString(myMD5);
+
+    // Bank tables are stored sparsely, as (pc, instructions, cycles)
+    // triples for each executed address
+    for(uInt32 bank = 0; bank < kMaxBanks; ++bank)
+    {
+      if(!myBanks[bank])
+        continue;
+
+      uInt32 count = 0;
+      for(uInt32 pc = 0; pc <= kAddressMask; ++pc)
+        if(myBanks[bank][pc].instructions)
+          ++count;
+
+      out.putShort(bank);
+      out.putInt(count);
+      for(uInt32 pc = 0; pc <= kAddressMask; ++pc)
+      {
+        const PCEntry& entry = myBanks[bank][pc];
+        if(entry.instructions)
+        {
+          out.putShort(pc);
+          out.putInt(entry.instructions & 0xffffffff);
+          out.putInt(entry.instructions >> 32);
+          out.putInt(entry.cycles & 0xffffffff);
+          out.putInt(entry.cycles >> 32);
+        }
+      }
+    }
+    out.putShort(0xffff);  // end of bank tables
+
+    out.putInt(myNumberOfDevices);
+    for(uInt32 i = 0; i < myNumberOfDevices; ++i)
+    {
+      out.putString(myDevices[i].device->name());
+      out.putInt(myDevices[i].reads & 0xffffffff);
+      out.putInt(myDevices[i].reads >> 32);
+      out.putInt(myDevices[i].writes & 0xffffffff);
+      out.putInt(myDevices[i].writes >> 32);
+    }
+  }
+  catch(...)
+  {
+    cerr << "ERROR: Profiler::saveBinary" << endl;
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,194 @@
+//============================================================================
+//
+//   SSSS    tt          lll  lll
+//  SS  SS   tt           ll   ll
+//  SS     tttttt  eeee   ll   ll   aaaa
+//   SSSS    tt   ee  ee  ll   ll      aa
+//      SS   tt   eeeeee  ll   ll   aaaaa  --  "An Atari 2600 VCS Emulator"
+//  SS  SS   tt   ee      ll   ll  aa  aa
+//   SSSS     ttt  eeeee llll llll  aaaaa
+//
+// Copyright (c) 1995-2014 by Bradford W. Mott, Stephen Anthony
+// and the Stella Team
+//
+// See the file "License.txt" for information on usage and redistribution of
+// this file, and for a DISCLAIMER OF ALL WARRANTIES.
+//
+// $Id$
+//============================================================================
+
+#ifndef PROFILER_HXX
+#define PROFILER_HXX
+
+class Device;
+
+#include "bspf.hxx"
+#include "Cart.hxx"
+
+/**
+  This class collects an execution profile of the emulated machine.  For
+  every (bank, PC) pair it counts the number of instructions executed and
+  the number of system cycles they took, and for every device it counts
+  the number of reads and writes the CPU made to it.  Since each memory
+  access takes exactly one processor cycle, the latter is also the number
+  of cycles spent in each device.
+
+  The profiler is only fed by the core when Stella is compiled with
+  PROFILER_SUPPORT; otherwise it costs nothing.  It's attached to a
+  running system with System::setProfiler(), and the results can be
+  saved in either CSV or a compact binary format.
+
+  @author  Stella Team
+  @version $Id$
+*/
+class Profiler
+{
+  public:
+    /**
+      Create a new profiler for the given cartridge, which is used to
+      determine the bank each instruction is executed from.
+
+      @param cart  The cartridge being profiled
+      @param md5   The MD5 of the ROM image, which identifies the profile
+    */
+    Profiler(const Cartridge& cart, const string& md5);
+
+    /**
+      Destructor
+    */
+    virtual ~Profiler();
+
+  public:
+    /**
+      Discard all information collected so far.
+    */
+    void reset();
+
+    /**
+      Get the bank currently selected in the cartridge.  This should be
+      queried before an instruction executes, since the instruction itself
+      may switch banks.
+    */
+    uInt16 bank() const { return myCart.bank(); }
+
+    /**
+      Record that the instruction at the given address was executed.
+
+      @param bank    The bank the instruction was executed from
+      @param pc      The address of the instruction's opcode
+      @param cycles  The number of system cycles the instruction took
+      @param count   The number of times it was executed
+    */
+    void instruction(uInt16 bank, uInt16 pc, uInt32 cycles, uInt32 count = 1)
+    {
+      PCEntry& entry = bankTable(bank)[pc & kAddressMask];
+      entry.instructions += count;
+      entry.cycles += (uInt64)cycles * count;
+    }
+
+    /**
+      Record that the CPU accessed the given device.
+
+      @param device  The device which was accessed
+      @param write   Whether the access was a write (poke) or read (peek)
+      @param count   The number of accesses
+    */
+    void access(const Device* device, bool write, uInt32 count = 1)
+    {
+      DeviceEntry& entry = deviceEntry(device);
+      if(write)  entry.writes += count;
+      else       entry.reads  += count;
+    }
+
+    /**
+      Save the profile in CSV format.  The first table lists every
+      (bank, PC) pair which was executed, the second one every device.
+
+      @param filename  The file to save to
+      @return  True if the profile was saved, else false
+    */
+    bool saveCSV(const string& filename) const;
+
+    /**
+      Save the profile in a compact binary format, written with a
+      file-based Serializer.
+
+      @param filename  The file to save to
+      @return  True if the profile was saved, else false
+    */
+    bool saveBinary(const string& filename) const;
+
+    /**
+      Get the MD5 of the ROM being profiled.
+    */
+    const string& md5() const { return myMD5; }
+
+    /**
+      Get the total number of instructions/cycles recorded so far.
+    */
+    uInt64 totalInstructions() const;
+    uInt64 totalCycles() const;
+
+  private:
+    struct PCEntry
+    {
+      uInt64 instructions;
+      uInt64 cycles;
+    };
+
+    struct DeviceEntry
+    {
+      const Device* device;
+      uInt64 reads;
+      uInt64 writes;
+    };
+
+    enum {
+      kAddressMask = 0x1fff,  // the 6507 has a 13-bit address bus
+      kMaxBanks    = 256,     // larger bank numbers are wrapped
+      kMaxDevices  = 32
+    };
+
+    // Get the per-PC table for the given bank, creating it when necessary
+    PCEntry* bankTable(uInt16 bank)
+    {
+      PCEntry* table = myBanks[bank & (kMaxBanks - 1)];
+      return table ? table : createBankTable(bank & (kMaxBanks - 1));
+    }
+    PCEntry* createBankTable(uInt16 bank);
+
+    // Get the entry for the given device, creating it when necessary
+    DeviceEntry& deviceEntry(const Device* device)
+    {
+      // There are only ever a handful of devices in a system
+      for(uInt32 i = 0; i < myNumberOfDevices; ++i)
+        if(myDevices[i].device == device)
+          return myDevices[i];
+
+      return createDeviceEntry(device);
+    }
+    DeviceEntry& createDeviceEntry(const Device* device);
+
+  private:
+    // The cartridge, used to look up the current bank
+    const Cartridge& myCart;
+
+    // The MD5 of the ROM being profiled
+    string myMD5;
+
+    // Per-PC tables for each bank, allocated on first use
+    PCEntry* myBanks[kMaxBanks];
+
+    // Counters for each device accessed by the CPU
+    DeviceEntry myDevices[kMaxDevices];
+    uInt32 myNumberOfDevices;
+
+  private:
+    // Copy constructor isn't supported by this class so make it private
+    Profiler(const Profiler&);
+
+    // Assignment operator isn't supported by this class so make it private
+    Profiler& operator = (const Profiler&);
+};
+
+#endif
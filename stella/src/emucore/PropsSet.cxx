@@ -17,6 +17,7 @@
 // $Id: PropsSet.cxx 2838 2014-01-17 23:34:03Z stephena $
 //============================================================================
 
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <map>
@@ -119,28 +120,14 @@ bool PropertiesSet::getMD5(const string& md5, Properties& properties,
     }
   }
 
-  // Otherwise, search the internal database using binary search
+  // Otherwise, search the internal database
   if(!found)
   {
-    int low = 0, high = DEF_PROPS_SIZE - 1;
-    while(low <= high)
+    int i = findDefProps(md5);
+    if(i >= 0)
     {
-      int i = (low + high) / 2;
-      int cmp = BSPF_compareIgnoreCase(md5, DefProps[i][Cartridge_MD5]);
-
-      if(cmp == 0)  // found it
-      {
-        for(int p = 0; p < LastPropType; ++p)
-          if(DefProps[i][p][0] != 0)
-            properties.set((PropertyType)p, DefProps[i][p]);
-
-        found = true;
-        break;
-      }
-      else if(cmp < 0)
-        high = i - 1; // look at lower range
-      else
-        low = i + 1;  // look at upper range
+      copyDefProps(i, properties);
+      found = true;
     }
   }
 
@@ -221,11 +208,9 @@ void PropertiesSet::print() const
   for(int i = 0; i < DEF_PROPS_SIZE; ++i)
   {
     properties.setDefaults();
-    for(int p = 0; p < LastPropType; ++p)
-      if(DefProps[i][p][0] != 0)
-        properties.set((PropertyType)p, DefProps[i][p]);
+    copyDefProps(i, properties);
 
-    list.insert(make_pair(DefProps[i][Cartridge_MD5], properties));
+    list.insert(make_pair(properties.get(Cartridge_MD5), properties));
   }
 
   // Now, print the resulting list
@@ -233,3 +218,66 @@ void PropertiesSet::print() const
   for(PropsList::const_iterator i = list.begin(); i != list.end(); ++i)
     i->second.print();
 }
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+int PropertiesSet::findDefProps(const string& md5)
+{
+  // The database is keyed on the binary form of the MD5; anything that
+  // isn't an MD5 can't be in there
+  if(md5.length() != 32)
+    return -1;
+
+  uInt8 key[16];
+  for(int i = 0; i < 32; ++i)
+  {
+    char c = md5[i];
+    uInt8 nibble;
+    if(c >= '0' && c <= '9')       nibble = c - '0';
+    else if(c >= 'a' && c <= 'f')  nibble = c - 'a' + 10;
+    else if(c >= 'A' && c <= 'F')  nibble = c - 'A' + 10;
+    else                           return -1;
+
+    if(i & 1)  key[i >> 1] |= nibble;
+    else       key[i >> 1]  = nibble << 4;
+  }
+
+  // A single probe of the perfect hash built by 'create_props.pl'
+  uInt32 word[3];
+  for(int w = 0; w < 3; ++w)
+    word[w] = (key[w*4] << 24) | (key[w*4+1] << 16) |
+              (key[w*4+2] << 8) | key[w*4+3];
+
+  uInt32 d = DefPropsHashBucket[word[0] % DEF_PROPS_HASH_BUCKETS];
+  uInt16 i = DefPropsHashSlot[(word[1] + d * (word[2] | 1)) % DEF_PROPS_HASH_SLOTS];
+
+  return (i < DEF_PROPS_SIZE && memcmp(DefPropsMD5[i], key, 16) == 0) ? i : -1;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void PropertiesSet::copyDefProps(int index, Properties& properties)
+{
+  // The MD5 is only stored in binary form
+  static const char hex[] = "0123456789abcdef";
+  char md5[33];
+  for(int i = 0; i < 16; ++i)
+  {
+    md5[i*2]   = hex[DefPropsMD5[index][i] >> 4];
+    md5[i*2+1] = hex[DefPropsMD5[index][i] & 0x0f];
+  }
+  md5[32] = 0;
+  properties.set(Cartridge_MD5, md5);
+
+  // Then come the free-text properties, and the remaining ones are coded
+  for(int p = 0; p < DEF_PROPS_TEXT; ++p)
+  {
+    const char* value = DefPropsStrings + DefPropsText[index][p];
+    if(value[0] != 0)
+      properties.set((PropertyType)(Cartridge_Manufacturer + p), value);
+  }
+  for(int p = 0; p < DEF_PROPS_CODED; ++p)
+  {
+    const char* value = DefPropsStrings + DefPropsCodes[DefPropsCoded[index][p]];
+    if(value[0] != 0)
+      properties.set((PropertyType)(Cartridge_Rarity + p), value);
+  }
+}
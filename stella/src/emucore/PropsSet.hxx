@@ -122,6 +122,21 @@ class PropertiesSet
     */
     void print() const;
 
+  private:
+    /**
+      Find the entry with the given MD5 in the built-in database.
+
+      @param md5  The md5 of the entry to find
+      @return  The index of the entry, or -1 if it isn't in the database
+    */
+    static int findDefProps(const string& md5);
+
+    /**
+      Copy the built-in database entry at the given index into the
+      given properties (only the non-default values are set).
+    */
+    static void copyDefProps(int index, Properties& properties);
+
   private:
     typedef map<string, Properties> PropsList;
 
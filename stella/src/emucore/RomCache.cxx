@@ -0,0 +1,133 @@
+//============================================================================
+//
+//   SSSS    tt          lll  lll
+//  SS  SS   tt           ll   ll
+//  SS     tttttt  eeee   ll   ll   aaaa
+//   SSSS    tt   ee  ee  ll   ll      aa
+//      SS   tt   eeeeee  ll   ll   aaaaa  --  "An Atari 2600 VCS Emulator"
+//  SS  SS   tt   ee      ll   ll  aa  aa
+//   SSSS     ttt  eeeee llll llll  aaaaa
+//
+// Copyright (c) 1995-2014 by Bradford W. Mott, Stephen Anthony
+// and the Stella Team
+//
+// See the file "License.txt" for information on usage and redistribution of
+// this file, and for a DISCLAIMER OF ALL WARRANTIES.
+//
+// $Id$
+//============================================================================
+
+#include "Serializer.hxx"
+#include "Version.hxx"
+
+#include "RomCache.hxx"
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+const PropertyType RomCache::ourProps[kNumProps] = {
+  Cartridge_Type,
+  Display_Format
+};
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+RomCache::RomCache()
+  : myModified(false)
+{
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+RomCache::~RomCache()
+{
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool RomCache::load(const string& filename)
+{
+  myEntries.clear();
+  myModified = false;
+
+  Serializer in(filename, true);
+  if(!in.isValid())
+    return false;
+
+  try
+  {
+    if(in.getString() != "StellaRomCache" || in.getString() != STELLA_VERSION ||
+       in.getInt() != kNumProps)
+      return false;
+
+    uInt32 count = in.getInt();
+    for(uInt32 i = 0; i < count; ++i)
+    {
+      const string& md5 = in.getString();
+      Entry& entry = myEntries[md5];
+      for(uInt32 p = 0; p < kNumProps; ++p)
+        entry.value[p] = in.getString();
+    }
+  }
+  catch(...)
+  {
+    cerr << "ERROR: RomCache::load" << endl;
+    myEntries.clear();
+    return false;
+  }
+
+  return true;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool RomCache::save(const string& filename) const
+{
+  Serializer out(filename, false, true);
+  if(!out.isValid())
+    return false;
+
+  try
+  {
+    out.putString("StellaRomCache");
+    out.putString(STELLA_VERSION);
+    out.putInt(kNumProps);
+
+    out.putInt(myEntries.size());
+    for(EntryList::const_iterator iter = myEntries.begin();
+        iter != myEntries.end(); ++iter)
+    {
+      out.putString(iter->first);
+      for(uInt32 p = 0; p < kNumProps; ++p)
+        out.putString(iter->second.value[p]);
+    }
+  }
+  catch(...)
+  {
+    cerr << "ERROR: RomCache::save" << endl;
+    return false;
+  }
+
+  myModified = false;
+  return true;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool RomCache::get(const string& md5, Properties& props) const
+{
+  EntryList::const_iterator iter = myEntries.find(md5);
+  if(iter == myEntries.end())
+    return false;
+
+  // Only fill in what would otherwise be autodetected, so that a type or
+  // format given in the properties always wins over the cached one
+  for(uInt32 p = 0; p < kNumProps; ++p)
+    if(props.get(ourProps[p]) == "AUTO")
+      props.set(ourProps[p], iter->second.value[p]);
+
+  return true;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void RomCache::insert(const string& md5, const Properties& props)
+{
+  Entry& entry = myEntries[md5];
+  for(uInt32 p = 0; p < kNumProps; ++p)
+    entry.value[p] = props.get(ourProps[p]);
+
+  myModified = true;
+}
@@ -0,0 +1,123 @@
+//============================================================================
+//
+//   SSSS    tt          lll  lll
+//  SS  SS   tt           ll   ll
+//  SS     tttttt  eeee   ll   ll   aaaa
+//   SSSS    tt   ee  ee  ll   ll      aa
+//      SS   tt   eeeeee  ll   ll   aaaaa  --  "An Atari 2600 VCS Emulator"
+//  SS  SS   tt   ee      ll   ll  aa  aa
+//   SSSS     ttt  eeeee llll llll  aaaaa
+//
+// Copyright (c) 1995-2014 by Bradford W. Mott, Stephen Anthony
+// and the Stella Team
+//
+// See the file "License.txt" for information on usage and redistribution of
+// this file, and for a DISCLAIMER OF ALL WARRANTIES.
+//
+// $Id$
+//============================================================================
+
+#ifndef ROM_CACHE_HXX
+#define ROM_CACHE_HXX
+
+#include <map>
+
+#include "bspf.hxx"
+#include "Props.hxx"
+
+/**
+  This class remembers the results of analysing a ROM, keyed by its MD5,
+  so they don't have to be worked out again every time the ROM is loaded.
+  That is, the bankswitch type found by CartDetector::autodetectType() and
+  the display format found by running the TIA in the Console constructor.
+  Nothing else is stored, so properties from the DefProps table or the
+  user always take effect as usual.
+
+  A ROM found in the cache can then be started with these properties
+  filled in, so neither autodetection has anything left to do.  The cache
+  is stored in a binary file written with a Serializer; it's tagged with
+  the Stella version, since a newer version may well detect things
+  differently.
+
+  @author  Stella Team
+  @version $Id$
+*/
+class RomCache
+{
+  public:
+    /**
+      Create an empty cache.
+    */
+    RomCache();
+
+    /**
+      Destructor
+    */
+    virtual ~RomCache();
+
+  public:
+    /**
+      Load the cache from the given file, replacing the current contents.
+      A missing file, or one from another Stella version, leaves the cache
+      empty.
+
+      @param filename  Full pathname of the cache file
+      @return  True if the cache was loaded, else false
+    */
+    bool load(const string& filename);
+
+    /**
+      Save the cache to the given file.
+
+      @param filename  Full pathname of the cache file
+      @return  True if the cache was saved, else false
+    */
+    bool save(const string& filename) const;
+
+    /**
+      Fill in the cached analysis for the given ROM.  Only properties
+      which are still set to 'AUTO' are changed.
+
+      @param md5    The MD5 of the ROM image
+      @param props  The properties to update with the cached values
+      @return  True if the ROM was found in the cache, else false
+    */
+    bool get(const string& md5, Properties& props) const;
+
+    /**
+      Remember the analysis for the given ROM; any previous entry is
+      replaced.  The properties should be those the console actually
+      used, with the cartridge type and display format already resolved
+      (ie, not 'AUTO').
+
+      @param md5    The MD5 of the whole ROM image; for a multicart, this
+                    is not the MD5 of the sub-ROM that was started
+      @param props  The properties to take the analysed values from
+    */
+    void insert(const string& md5, const Properties& props);
+
+    /**
+      Answers whether the cache was changed since it was loaded or saved.
+    */
+    bool isModified() const { return myModified; }
+
+  private:
+    enum { kNumProps = 2 };
+
+    // The properties stored for each ROM, in file order
+    static const PropertyType ourProps[kNumProps];
+
+    struct Entry
+    {
+      string value[kNumProps];
+    };
+    typedef map<string, Entry> EntryList;
+
+    // The cached analysis for each ROM, keyed by MD5
+    EntryList myEntries;
+
+    // Whether there are entries which haven't been saved yet
+    mutable bool myModified;
+};
+
+#endif
@@ -18,15 +18,22 @@
 //============================================================================
 
 #include <fstream>
-#include <sstream>
+#include <cstring>
 
 #include "FSNode.hxx"
 #include "Serializer.hxx"
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-Serializer::Serializer(const string& filename, bool readonly)
+Serializer::Serializer(const string& filename, bool readonly, bool truncate)
   : myStream(NULL),
-    myUseFilestream(true)
+    myUseFilestream(true),
+    myBuffer(NULL),
+    myCapacity(0),
+    myEnd(0),
+    myReadPos(0),
+    myWritePos(0),
+    myFixedBuffer(false),
+    myReadOnly(readonly)
 {
   if(readonly)
   {
@@ -52,8 +59,10 @@ Serializer::Serializer(const string& filename, bool readonly)
     // However, if it *does* exist, we don't want to overwrite it
     // So we open in write and append mode - the write creates the file
     // when necessary, and the append doesn't delete any data if it
-    // already exists
-    fstream temp(filename.c_str(), ios::out | ios::app);
+    // already exists (unless we're asked to, so that a shorter stream
+    // doesn't leave the end of an older one behind)
+    fstream temp(filename.c_str(), truncate ? ios::out | ios::trunc :
+                                              ios::out | ios::app);
     temp.close();
 
     fstream* str = new fstream(filename.c_str(), ios::in | ios::out | ios::binary);
@@ -68,21 +77,32 @@ Serializer::Serializer(const string& filename, bool readonly)
   }
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Serializer::Serializer(uInt8* buffer, uInt32 size, bool readonly)
+  : myStream(NULL),
+    myUseFilestream(false),
+    myBuffer(buffer),
+    myCapacity(size),
+    myEnd(size),
+    myReadPos(0),
+    myWritePos(0),
+    myFixedBuffer(true),
+    myReadOnly(readonly)
+{
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Serializer::Serializer(void)
   : myStream(NULL),
-    myUseFilestream(false)
+    myUseFilestream(false),
+    myBuffer(NULL),
+    myCapacity(0),
+    myEnd(0),
+    myReadPos(0),
+    myWritePos(0),
+    myFixedBuffer(false),
+    myReadOnly(false)
 {
-  myStream = new stringstream(ios::in | ios::out | ios::binary);
-  
-  // For some reason, Windows and possibly OSX needs to store something in
-  // the stream before it is used for the first time
-  if(myStream)
-  {
-    myStream->exceptions( ios_base::failbit | ios_base::badbit | ios_base::eofbit );
-    putBool(true);
-    reset();
-  }
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -96,42 +116,112 @@ Serializer::~Serializer(void)
     delete myStream;
     myStream = NULL;
   }
+
+  if(!myFixedBuffer)
+    delete[] myBuffer;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 bool Serializer::isValid(void)
 {
-  return myStream != NULL;
+  return myUseFilestream ? myStream != NULL :
+         !myFixedBuffer || myBuffer != NULL;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Serializer::reset(void)
 {
-  myStream->clear();
-  myStream->seekg(ios_base::beg);
-  myStream->seekp(ios_base::beg);
+  if(myUseFilestream)
+  {
+    myStream->clear();
+    myStream->seekg(ios_base::beg);
+    myStream->seekp(ios_base::beg);
+  }
+  else
+    myReadPos = myWritePos = 0;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Serializer::truncate(uInt32 size)
+{
+  if(!myUseFilestream && size < myWritePos)
+  {
+    myWritePos = myEnd = size;
+    myReadPos = BSPF_min(myReadPos, size);
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Serializer::read(void* data, uInt32 size)
+{
+  if(myUseFilestream)
+    myStream->read((char*)data, size);
+  else
+  {
+    if(size > myEnd - myReadPos)
+      throw "Serializer: read past end of data";
+
+    memcpy(data, myBuffer + myReadPos, size);
+    myReadPos += size;
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Serializer::write(const void* data, uInt32 size)
+{
+  if(myUseFilestream)
+    myStream->write((const char*)data, size);
+  else
+  {
+    if(myReadOnly)
+      throw "Serializer: write to read-only buffer";
+
+    if(size > myCapacity - myWritePos)
+    {
+      if(myFixedBuffer)
+        throw "Serializer: write past end of buffer";
+
+      // Grow geometrically, so that a complete state costs only a few
+      // allocations the first time it's written, and none afterwards
+      uInt32 capacity = BSPF_max(myCapacity * 2, 4096u);
+      while(capacity - myWritePos < size)
+        capacity *= 2;
+
+      uInt8* buffer = new uInt8[capacity];
+      if(myEnd > 0)
+        memcpy(buffer, myBuffer, myEnd);
+      delete[] myBuffer;
+      myBuffer = buffer;
+      myCapacity = capacity;
+    }
+
+    memcpy(myBuffer + myWritePos, data, size);
+    myWritePos += size;
+    if(myWritePos > myEnd)
+      myEnd = myWritePos;
+  }
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 uInt8 Serializer::getByte(void)
 {
-  char buf;
-  myStream->read(&buf, 1);
+  uInt8 val = 0;
+  read(&val, 1);
 
-  return buf;
+  return val;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Serializer::getByteArray(uInt8* array, uInt32 size)
 {
-  myStream->read((char*)array, size);
+  read(array, size);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 uInt16 Serializer::getShort(void)
 {
   uInt16 val = 0;
-  myStream->read((char*)&val, sizeof(uInt16));
+  read(&val, sizeof(uInt16));
 
   return val;
 }
@@ -139,14 +229,14 @@ uInt16 Serializer::getShort(void)
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Serializer::getShortArray(uInt16* array, uInt32 size)
 {
-  myStream->read((char*)array, sizeof(uInt16)*size);
+  read(array, sizeof(uInt16)*size);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 uInt32 Serializer::getInt(void)
 {
   uInt32 val = 0;
-  myStream->read((char*)&val, sizeof(uInt32));
+  read(&val, sizeof(uInt32));
 
   return val;
 }
@@ -154,16 +244,22 @@ uInt32 Serializer::getInt(void)
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Serializer::getIntArray(uInt32* array, uInt32 size)
 {
-  myStream->read((char*)array, sizeof(uInt32)*size);
+  read(array, sizeof(uInt32)*size);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 string Serializer::getString(void)
 {
-  int len = getInt();
+  uInt32 len = getInt();
+
+  // Don't trust the length before we know the data is really there
+  if(!myUseFilestream && len > myEnd - myReadPos)
+    throw "Serializer: read past end of data";
+
   string str;
   str.resize(len);
-  myStream->read(&str[0], len);
+  if(len > 0)
+    read(&str[0], len);
 
   return str;
 }
@@ -174,48 +270,54 @@ bool Serializer::getBool(void)
   return getByte() == TruePattern;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool Serializer::checkTag(const string& name)
+{
+  return getInt() == tag(name);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Serializer::putByte(uInt8 value)
 {
-  myStream->write((char*)&value, 1);
+  write(&value, 1);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Serializer::putByteArray(const uInt8* array, uInt32 size)
 {
-  myStream->write((char*)array, size);
+  write(array, size);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Serializer::putShort(uInt16 value)
 {
-  myStream->write((char*)&value, sizeof(uInt16));
+  write(&value, sizeof(uInt16));
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Serializer::putShortArray(const uInt16* array, uInt32 size)
 {
-  myStream->write((char*)array, sizeof(uInt16)*size);
+  write(array, sizeof(uInt16)*size);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Serializer::putInt(uInt32 value)
 {
-  myStream->write((char*)&value, sizeof(uInt32));
+  write(&value, sizeof(uInt32));
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Serializer::putIntArray(const uInt32* array, uInt32 size)
 {
-  myStream->write((char*)array, sizeof(uInt32)*size);
+  write(array, sizeof(uInt32)*size);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Serializer::putString(const string& str)
 {
-  int len = str.length();
+  uInt32 len = str.length();
   putInt(len);
-  myStream->write(str.data(), len);
+  write(str.data(), len);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -223,3 +325,23 @@ void Serializer::putBool(bool b)
 {
   putByte(b ? TruePattern: FalsePattern);
 }
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Serializer::putTag(const string& name)
+{
+  putInt(tag(name));
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+uInt32 Serializer::tag(const string& name)
+{
+  // 32-bit FNV-1a; collisions only weaken a sanity check, they can't
+  // corrupt anything
+  uInt32 hash = 2166136261u;
+  for(uInt32 i = 0; i < name.length(); ++i)
+  {
+    hash ^= (uInt8)name[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
@@ -26,7 +26,12 @@
 /**
   This class implements a Serializer device, whereby data is serialized and
   read from/written to a binary stream in a system-independent way.  The
-  stream can be either an actual file, or an in-memory structure.
+  stream can be either an actual file, or an in-memory buffer.
+
+  In-memory data is copied straight into a contiguous buffer, which is
+  either owned (and grown as needed) by the Serializer, or supplied by the
+  caller with a fixed size.  Going past the end of the data throws an
+  exception, just like a file stream does.
 
   Bytes are written as characters, shorts as 2 characters (16-bits),
   integers as 4 characters (32-bits), strings are written as characters
@@ -46,14 +51,21 @@ class Serializer
       Creates a new Serializer device for streaming binary data.
 
       If a filename is provided, the stream will be to the given
-      filename.  Otherwise, the stream will be in memory.
+      filename.  If a buffer is provided, the stream will be to that
+      buffer, and is limited to its size.  Otherwise, the stream will be
+      to a buffer owned by the Serializer, which grows as needed.
 
-      If a file is opened readonly, we can never write to it.
+      If a file or buffer is opened readonly, we can never write to it.
+      Otherwise, an existing file is kept as it is (so it can be read and
+      partly overwritten) unless truncate is given, in which case it's
+      emptied first.
 
       The isValid() method must immediately be called to verify the stream
       was correctly initialized.
     */
-    Serializer(const string& filename, bool readonly = false);
+    Serializer(const string& filename, bool readonly = false,
+               bool truncate = false);
+    Serializer(uInt8* buffer, uInt32 size, bool readonly = false);
     Serializer(void);
 
     /**
@@ -73,6 +85,23 @@ class Serializer
     */
     void reset(void);
 
+    /**
+      Answers the in-memory data (not valid for files).
+    */
+    const uInt8* data(void) const { return myBuffer; }
+
+    /**
+      Answers the number of bytes written since the last reset (not valid
+      for files).
+    */
+    uInt32 size(void) const { return myWritePos; }
+
+    /**
+      Throws away everything written after the given number of bytes, so
+      that writing continues from there (not valid for files).
+    */
+    void truncate(uInt32 size);
+
     /**
       Reads a byte value (unsigned 8-bit) from the current input stream.
 
@@ -133,6 +162,15 @@ class Serializer
     */
     bool getBool(void);
 
+    /**
+      Reads a tag from the current input stream, and answers whether it
+      was written for the given name.
+
+      @param name  The name the tag is expected to be written for
+      @result  True if the tag matches the name
+    */
+    bool checkTag(const string& name);
+
     /**
       Writes an byte value (unsigned 8-bit) to the current output stream.
 
@@ -192,15 +230,54 @@ class Serializer
     */
     void putBool(bool b);
 
+    /**
+      Writes the tag for the given name to the current output stream.
+      A tag is a 32-bit hash of the name, used to mark (and later check)
+      the start of the data for an object in far less space than the
+      name itself.
+
+      @param name  The name to write the tag for
+    */
+    void putTag(const string& name);
+
+  private:
+    // Answers the tag for the given name
+    static uInt32 tag(const string& name);
+
+    // Copy data from/to the stream, throwing on any error
+    void read(void* data, uInt32 size);
+    void write(const void* data, uInt32 size);
+
   private:
-    // The stream to send the serialized data to.
+    // The stream to send the serialized data to (files only)
     iostream* myStream;
     bool myUseFilestream;
 
+    // The in-memory data, its allocated size, and the end of the valid
+    // data in it
+    uInt8* myBuffer;
+    uInt32 myCapacity;
+    uInt32 myEnd;
+
+    // The current read and write locations in the in-memory data
+    uInt32 myReadPos;
+    uInt32 myWritePos;
+
+    // Whether the buffer was supplied by the caller, and can't be resized
+    bool myFixedBuffer;
+    bool myReadOnly;
+
     enum {
       TruePattern  = 0xfe,
       FalsePattern = 0x01
     };
+
+  private:
+    // Copy constructor isn't supported by this class so make it private
+    Serializer(const Serializer&);
+
+    // Assignment operator isn't supported by this class so make it private
+    Serializer& operator = (const Serializer&);
 };
 
 #endif
@@ -32,7 +32,10 @@
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Settings::Settings(OSystem* osystem)
-  : myOSystem(osystem)
+  : myOSystem(osystem),
+    myIndex(0),
+    myIndexSize(0),
+    myIndexCount(0)
 {
   // Add this settings object to the OSystem
   myOSystem->attach(this);
@@ -81,6 +84,7 @@ Settings::Settings(OSystem* osystem)
   setInternal("fragsize", "512");
   setInternal("freq", "31400");
   setInternal("volume", "100");
+  setInternal("synthmusic", "false");
 
   // Input event options
   setInternal("keymap", "");
@@ -156,6 +160,7 @@ Settings::~Settings()
 {
   myInternalSettings.clear();
   myExternalSettings.clear();
+  delete[] myIndex;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -387,6 +392,7 @@ void Settings::validate()
 //    << "  -fragsize     <number>       The size of sound fragments (must be a power of two)\n"
 //    << "  -freq         <number>       Set sound sample output frequency (11025|22050|31400|44100|48000)\n"
 //    << "  -volume       <number>       Set the volume (0 - 100)\n"
+//    << "  -synthmusic   <1|0>          Synthesize DPC/DPC+ music straight into the sound output\n"
 //    << endl
 //  #endif
 //    << "  -cheat        <code>         Use the specified cheatcode (see manual for description)\n"
@@ -479,19 +485,14 @@ void Settings::validate()
 const Variant& Settings::value(const string& key) const
 {
   // Try to find the named setting and answer its value
-  int idx = -1;
-  if((idx = getInternalPos(key)) != -1)
-    return myInternalSettings[idx].value;
-  else if((idx = getExternalPos(key)) != -1)
-    return myExternalSettings[idx].value;
-  else
-    return EmptyVariant;
+  return setting(findHandle(key)).value;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Settings::setValue(const string& key, const Variant& value)
 {
-  if(int idx = getInternalPos(key) != -1)
+  int idx = getInternalPos(key);
+  if(idx != -1)
     setInternal(key, value, idx);
   else
     setExternal(key, value);
@@ -550,16 +551,20 @@ void Settings::setValue(const string& key, const Variant& value)
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 int Settings::getInternalPos(const string& key) const
 {
-  for(unsigned int i = 0; i < myInternalSettings.size(); ++i)
-    if(myInternalSettings[i].key == key)
-      return i;
-
-  return -1;
+  Handle h = findHandle(key);
+  return (h >= 0 && !(h & 1)) ? (h >> 1) : -1;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 int Settings::getExternalPos(const string& key) const
 {
+  Handle h = findHandle(key);
+  if(h >= 0 && (h & 1))
+    return h >> 1;
+  else if(h < 0)
+    return -1;
+
+  // The index answers the internal setting when a key is in both arrays
   for(unsigned int i = 0; i < myExternalSettings.size(); ++i)
     if(myExternalSettings[i].key == key)
       return i;
@@ -579,44 +584,23 @@ int Settings::setInternal(const string& key, const Variant& value,
     idx = pos;
   }
   else
-  {
-    for(unsigned int i = 0; i < myInternalSettings.size(); ++i)
-    {
-      if(myInternalSettings[i].key == key)
-      {
-        idx = i;
-        break;
-      }
-    }
-  }
+    idx = getInternalPos(key);
 
   if(idx != -1)
   {
-    myInternalSettings[idx].key   = key;
-    myInternalSettings[idx].value = value;
+    myInternalSettings[idx].assign(value);
     if(useAsInitial) myInternalSettings[idx].initialValue = value;
-
-    /*cerr << "modify internal: key = " << key
-         << ", value  = " << value
-         << ", ivalue = " << myInternalSettings[idx].initialValue
-         << " @ index = " << idx
-         << endl;*/
   }
   else
   {
     Setting setting;
-    setting.key   = key;
-    setting.value = value;
+    setting.key = key;
+    setting.assign(value);
     if(useAsInitial) setting.initialValue = value;
 
     myInternalSettings.push_back(setting);
     idx = myInternalSettings.size() - 1;
-
-    /*cerr << "insert internal: key = " << key
-         << ", value  = " << value
-         << ", ivalue = " << setting.initialValue
-         << " @ index = " << idx
-         << endl;*/
+    addToIndex(key, makeHandle(idx, false));
   }
 
   return idx;
@@ -634,47 +618,102 @@ int Settings::setExternal(const string& key, const Variant& value,
     idx = pos;
   }
   else
-  {
-    for(unsigned int i = 0; i < myExternalSettings.size(); ++i)
-    {
-      if(myExternalSettings[i].key == key)
-      {
-        idx = i;
-        break;
-      }
-    }
-  }
+    idx = getExternalPos(key);
 
   if(idx != -1)
   {
-    myExternalSettings[idx].key   = key;
-    myExternalSettings[idx].value = value;
+    myExternalSettings[idx].assign(value);
     if(useAsInitial) myExternalSettings[idx].initialValue = value;
-
-    /*cerr << "modify external: key = " << key
-         << ", value = " << value
-         << " @ index = " << idx
-         << endl;*/
   }
   else
   {
     Setting setting;
-    setting.key   = key;
-    setting.value = value;
+    setting.key = key;
+    setting.assign(value);
     if(useAsInitial) setting.initialValue = value;
 
     myExternalSettings.push_back(setting);
     idx = myExternalSettings.size() - 1;
 
-    /*cerr << "insert external: key = " << key
-         << ", value = " << value
-         << " @ index = " << idx
-         << endl;*/
+    // An internal setting with the same key takes precedence
+    if(getInternalPos(key) == -1)
+      addToIndex(key, makeHandle(idx, true));
   }
 
   return idx;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+uInt32 Settings::hashKey(const string& key)
+{
+  // FNV-1a
+  uInt32 hash = 2166136261u;
+  for(string::size_type i = 0; i < key.length(); ++i)
+    hash = (hash ^ (uInt8)key[i]) * 16777619u;
+
+  return hash;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Settings::Handle Settings::findHandle(const string& key) const
+{
+  if(myIndexCount == 0)
+    return kInvalidHandle;
+
+  // Linear probing; the table is never more than half full
+  const uInt32 mask = myIndexSize - 1;
+  for(uInt32 i = hashKey(key) & mask; myIndex[i] != kInvalidHandle;
+      i = (i + 1) & mask)
+  {
+    if(setting(myIndex[i]).key == key)
+      return myIndex[i];
+  }
+
+  return kInvalidHandle;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Settings::addToIndex(const string& key, Handle h)
+{
+  // Grow the table (and re-insert all entries) when it becomes half full
+  if(2 * (myIndexCount + 1) > myIndexSize)
+  {
+    Handle* oldIndex = myIndex;
+    uInt32 oldSize = myIndexSize;
+
+    myIndexSize = oldSize ? 2 * oldSize : 256;
+    myIndex = new Handle[myIndexSize];
+    for(uInt32 i = 0; i < myIndexSize; ++i)
+      myIndex[i] = kInvalidHandle;
+
+    const uInt32 mask = myIndexSize - 1;
+    for(uInt32 i = 0; i < oldSize; ++i)
+    {
+      if(oldIndex[i] == kInvalidHandle)
+        continue;
+
+      uInt32 j = hashKey(setting(oldIndex[i]).key) & mask;
+      while(myIndex[j] != kInvalidHandle)
+        j = (j + 1) & mask;
+      myIndex[j] = oldIndex[i];
+    }
+    delete[] oldIndex;
+  }
+
+  // Replace an existing entry for this key, or claim an empty slot
+  const uInt32 mask = myIndexSize - 1;
+  uInt32 i = hashKey(key) & mask;
+  while(myIndex[i] != kInvalidHandle && setting(myIndex[i]).key != key)
+    i = (i + 1) & mask;
+
+  if(myIndex[i] == kInvalidHandle)
+    ++myIndexCount;
+  myIndex[i] = h;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+const Settings::Setting Settings::ourEmptySetting;
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Settings::Settings(const Settings&)
 {
@@ -29,6 +29,12 @@ class OSystem;
 /**
   This class provides an interface for accessing frontend specific settings.
 
+  Keys are interned in a hash index when a setting is first added, and each
+  setting caches its value converted to the basic types, so lookups by name
+  don't depend on the number of settings.  Code which reads the same setting
+  repeatedly (ie, on every reset) can resolve it once with handle() and use
+  the handle-based accessors, which skip hashing the key entirely.
+
   @author  Stephen Anthony
   @version $Id: Settings.hxx 2838 2014-01-17 23:34:03Z stephena $
 */
@@ -36,6 +42,14 @@ class Settings
 {
   friend class OSystem;
 
+  public:
+    /**
+      A reference to a setting, resolved once by key.  Since settings are
+      never removed, a handle stays valid as long as this object exists.
+    */
+    typedef Int32 Handle;
+    enum { kInvalidHandle = -1 };
+
   public:
     /**
       Create a new settings abstract class
@@ -94,6 +108,26 @@ class Settings
     const string& getString(const string& key) const { return value(key).toString(); }
     const GUI::Size getSize(const string& key) const { return value(key).toSize();   }
 
+    /**
+      Get a handle for the specified key, for use with the accessors below.
+
+      @param key The key of the setting to lookup
+      @return The handle, or kInvalidHandle if the setting doesn't exist
+    */
+    Handle handle(const string& key) const { return findHandle(key); }
+
+    /**
+      Convenience methods to return specific types from a previously
+      resolved handle.  An invalid handle acts like an empty setting.
+
+      @param h The handle of the setting to lookup
+      @return The specific type value of the setting
+    */
+    int getInt(Handle h) const     { return setting(h).intValue;   }
+    float getFloat(Handle h) const { return setting(h).floatValue; }
+    bool getBool(Handle h) const   { return setting(h).boolValue;  }
+    const string& getString(Handle h) const { return setting(h).value.toString(); }
+
   protected:
     /**
       This method will be called to load the current settings from an rc file.
@@ -130,6 +164,21 @@ class Settings
       string key;
       Variant value;
       Variant initialValue;
+
+      // The value converted to each basic type, updated on every change
+      int intValue;
+      float floatValue;
+      bool boolValue;
+
+      Setting() : intValue(0), floatValue(0.0), boolValue(false) { }
+
+      void assign(const Variant& v)
+      {
+        value      = v;
+        intValue   = v.toInt();
+        floatValue = v.toFloat();
+        boolValue  = v.toBool();
+      }
     };
     typedef Common::Array<Setting> SettingsArray;
 
@@ -148,6 +197,23 @@ class Settings
     int setExternal(const string& key, const Variant& value,
                     int pos = -1, bool useAsInitial = false);
 
+  private:
+    // Handles encode the array (bit 0 set for external) and position
+    static Handle makeHandle(int pos, bool external)
+      { return (pos << 1) | (external ? 1 : 0); }
+
+    const Setting& setting(Handle h) const
+    {
+      if(h < 0)         return ourEmptySetting;
+      else if(h & 1)    return myExternalSettings[h >> 1];
+      else              return myInternalSettings[h >> 1];
+    }
+
+    /** Hash index maintenance */
+    static uInt32 hashKey(const string& key);
+    Handle findHandle(const string& key) const;
+    void addToIndex(const string& key, Handle h);
+
   private:
     // Holds key,value pairs that are necessary for Stella to
     // function and must be saved on each program exit.
@@ -156,6 +222,14 @@ class Settings
     // Holds auxiliary key,value pairs that shouldn't be saved on
     // program exit.
     SettingsArray myExternalSettings;
+
+    // Open-addressed hash index from key to handle (size is a power of 2)
+    Handle* myIndex;
+    uInt32 myIndexSize;
+    uInt32 myIndexCount;
+
+    // Answered for invalid handles
+    static const Setting ourEmptySetting;
 };
 
 #endif
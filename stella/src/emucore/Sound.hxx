@@ -21,6 +21,7 @@
 #define SOUND_HXX
 
 class OSystem;
+class Cartridge;
 
 #include "Serializable.hxx"
 #include "bspf.hxx"
@@ -110,6 +111,23 @@ class Sound : public Serializable
     */
     virtual void set(uInt16 addr, uInt8 value, Int32 cycle) = 0;
 
+    /**
+      Sets the cartridge whose own music is mixed into the sound output
+      (see Cartridge::musicLevels()).
+
+      @param cart The cartridge, or 0 for none
+    */
+    virtual void setMusicCart(Cartridge* cart) = 0;
+
+    /**
+      Enables or disables skipping the sound, for when the emulation runs
+      for a while without any of the sound being generated (for instance
+      to autodetect the display format).
+
+      @param state True to skip the sound, false to generate it again
+    */
+    virtual void setSkipping(bool state) = 0;
+
     /**
       Sets the volume of the sound device to the specified level.  The
       volume is given as a percentage from 0 to 100.  Values outside
@@ -24,20 +24,32 @@
 #include "Console.hxx"
 #include "Cart.hxx"
 #include "Control.hxx"
+#include "Sound.hxx"
 #include "Switches.hxx"
 #include "System.hxx"
+#include "TIA.hxx"
 #include "Serializable.hxx"
 
 #include "StateManager.hxx"
 
-#define STATE_HEADER "03090100state"
-#define MOVIE_HEADER "03030000movie"
+#define STATE_HEADER "03090300state"
+#define MOVIE_HEADER "03090300movie"
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 StateManager::StateManager(OSystem* osystem)
   : myOSystem(osystem),
     myCurrentSlot(0),
-    myActiveMode(kOffMode)
+    myActiveMode(kOffMode),
+    myMovieInterval(kMovieKeyframeInterval),
+    myMovieKeyframeInterval(kMovieKeyframeInterval),
+    myHistoryId(0),
+    myRewindBuffer(NULL),
+    myRewindBufferSize(kRewindBufferSize),
+    myRewindEntries(NULL),
+    myRewindMaxFrames(kRewindMaxFrames),
+    myRewindKeyframeInterval(kRewindKeyframeInterval),
+    myKeyframe(NULL),
+    myStateScratch(NULL)
 {
   reset();
 }
@@ -45,6 +57,7 @@ StateManager::StateManager(OSystem* osystem)
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 StateManager::~StateManager()
 {
+  allocateRewind(false);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -56,118 +69,371 @@ bool StateManager::isActive()
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 bool StateManager::toggleRecordMode()
 {
-#if 0
+  if(!&myOSystem->console())
+    return false;
+
   if(myActiveMode != kMovieRecordMode)  // Turn on movie record mode
   {
-    myActiveMode = kOffMode;
+    if(myActiveMode == kRewindRecordMode)
+      allocateRewind(false);
 
-    string moviefile = /*myOSystem->baseDir() +*/ "test.inp";
-    if(myMovieWriter.isOpen())
-      myMovieWriter.close();
-    if(!myMovieWriter.open(moviefile))
-      return false;
+    clearMovie();
+    myMovieInterval = myMovieKeyframeInterval;
+    myMD5 = myOSystem->console().properties().get(Cartridge_MD5);
+    myHistoryId = (uInt32)myOSystem->getTicks();
+    myActiveMode = kMovieRecordMode;
+  }
+  else  // Turn off movie record mode
+  {
+    myActiveMode = kOffMode;
 
-    // Prepend the ROM md5 so this state file only works with that ROM
-    myMovieWriter.putString(myOSystem->console().properties().get(Cartridge_MD5));
+    // A reset asked for since the last frame still has to be done
+    if(myMovieResetPending)
+    {
+      myMovieResetPending = false;
+      myOSystem->console().system().reset();
+    }
+  }
 
-    if(!myOSystem->console().save(myMovieWriter))
-      return false;
+  return myActiveMode == kMovieRecordMode;
+}
 
-    // Save controller types for this ROM
-    // We need to check this, since some controllers save more state than
-    // normal, and those states files wouldn't be compatible with normal
-    // controllers.
-    myMovieWriter.putString(
-      myOSystem->console().controller(Controller::Left).name());
-    myMovieWriter.putString(
-      myOSystem->console().controller(Controller::Right).name());
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool StateManager::togglePlaybackMode()
+{
+  if(myActiveMode != kMoviePlaybackMode)  // Turn on movie playback mode
+  {
+    if(myActiveMode == kRewindRecordMode)
+      allocateRewind(false);
 
-    // If we get this far, we're really in movie record mode
-    myActiveMode = kMovieRecordMode;
+    myActiveMode = kOffMode;
+    if(seekMovie(0))
+    {
+      myHistoryId = (uInt32)myOSystem->getTicks();
+      myActiveMode = kMoviePlaybackMode;
+    }
   }
-  else  // Turn off movie record mode
-  {
+  else  // Turn off movie playback mode
     myActiveMode = kOffMode;
-    myMovieWriter.close();
+
+  return myActiveMode == kMoviePlaybackMode;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool StateManager::seekMovie(uInt32 frame)
+{
+  if(myActiveMode == kMovieRecordMode || myMovieKeyframes.isEmpty() ||
+     frame > myMovieFrames)
     return false;
+
+  // Start from the last keyframe at or before the frame
+  uInt32 index = findMovieKeyframe(frame);
+  if(!loadMovieKeyframe(index))
+    return false;
+
+  myMovieFrame = myMovieKeyframes[index].frame;
+  myMovieInputPos = myMovieKeyframes[index].input;
+
+  // Then emulate up to it, with the inputs recorded; nobody hears the
+  // frames in between
+  bool played = true;
+  myOSystem->sound().setSkipping(true);
+  while(played && myMovieFrame < frame)
+  {
+    played = playMovieInput();
+    if(played)
+      myOSystem->console().tia().update();
   }
+  myOSystem->sound().setSkipping(false);
 
-  return myActiveMode == kMovieRecordMode;
-#endif
-  return false;
+  return played;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-bool StateManager::toggleRewindMode()
+void StateManager::setMovieKeyframeInterval(uInt32 interval)
 {
-  // FIXME - For now, I'm going to use this to activate movie playback
-#if 0
-  // Close the writer, since we're about to re-open in read mode
-  myMovieWriter.close();
+  myMovieKeyframeInterval = BSPF_max(interval, 1u);
+}
 
-  if(myActiveMode != kMoviePlaybackMode)  // Turn on movie playback mode
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool StateManager::saveMovie(const string& filename)
+{
+  if(myMovieKeyframes.isEmpty() || !&myOSystem->console())
+    return false;
+
+  Serializer out(filename, false, true);
+  if(!out.isValid())
+    return false;
+
+  try
+  {
+    out.putTag(MOVIE_HEADER);
+
+    // The movie only works with the ROM and controllers it was made with
+    out.putString(myMD5);
+    out.putString(myOSystem->console().controller(Controller::Left).name());
+    out.putString(myOSystem->console().controller(Controller::Right).name());
+
+    out.putInt(myMovieInterval);
+    out.putInt(myMovieFrames);
+    out.putString(string((const char*)myMovieInput.data(), myMovieInput.size()));
+    out.putString(string((const char*)myMovieStates.data(), myMovieStates.size()));
+
+    out.putInt(myMovieKeyframes.size());
+    for(uInt32 i = 0; i < myMovieKeyframes.size(); ++i)
+    {
+      out.putInt(myMovieKeyframes[i].frame);
+      out.putInt(myMovieKeyframes[i].input);
+      out.putInt(myMovieKeyframes[i].offset);
+      out.putInt(myMovieKeyframes[i].length);
+      out.putInt(myMovieKeyframes[i].size);
+    }
+  }
+  catch(...)
   {
+    cerr << "ERROR: StateManager::saveMovie" << endl;
+    return false;
+  }
+
+  return true;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool StateManager::loadMovie(const string& filename)
+{
+  if(myActiveMode == kMovieRecordMode || myActiveMode == kMoviePlaybackMode)
     myActiveMode = kOffMode;
+  clearMovie();
 
-    string moviefile = /*myOSystem->baseDir() + */ "test.inp";
-    if(myMovieReader.isOpen())
-      myMovieReader.close();
-    if(!myMovieReader.open(moviefile))
-      return false;
+  if(!&myOSystem->console())
+    return false;
 
-    // Check the ROM md5
-    if(myMovieReader.getString() !=
-       myOSystem->console().properties().get(Cartridge_MD5))
-      return false;
+  Serializer in(filename, true);
+  if(!in.isValid())
+    return false;
 
-    if(!myOSystem->console().load(myMovieReader))
+  try
+  {
+    const string& md5 = myOSystem->console().properties().get(Cartridge_MD5);
+    if(!in.checkTag(MOVIE_HEADER) || in.getString() != md5 ||
+       in.getString() != myOSystem->console().controller(Controller::Left).name() ||
+       in.getString() != myOSystem->console().controller(Controller::Right).name())
       return false;
 
-    // Check controller types
-    const string& left  = myMovieReader.getString();
-    const string& right = myMovieReader.getString();
+    uInt32 interval = in.getInt();
+    uInt32 frames = in.getInt();
+    const string& input = in.getString();
+    const string& states = in.getString();
+    uInt32 keyframes = in.getInt();
 
-    if(left != myOSystem->console().controller(Controller::Left).name() ||
-       right != myOSystem->console().controller(Controller::Right).name())
+    if(interval == 0 || frames == 0 || keyframes == 0 || keyframes > frames)
       return false;
 
-    // If we get this far, we're really in movie record mode
-    myActiveMode = kMoviePlaybackMode;
+    for(uInt32 i = 0; i < keyframes; ++i)
+    {
+      MovieKeyframe key;
+      key.frame  = in.getInt();
+      key.input  = in.getInt();
+      key.offset = in.getInt();
+      key.length = in.getInt();
+      key.size   = in.getInt();
+
+      // The keyframes start the movie and come in order, and they point
+      // inside it; a run-length code can't expand a byte into more than 128
+      bool ordered = i == 0 ? key.frame == 0 :
+        key.frame > myMovieKeyframes[i - 1].frame &&
+        key.input > myMovieKeyframes[i - 1].input;
+      if(!ordered || key.frame >= frames ||
+         key.input >= input.size() || key.offset > states.size() ||
+         key.length > states.size() - key.offset ||
+         key.size > kMaxStateSize || key.size / 128 > key.length)
+      {
+        clearMovie();
+        return false;
+      }
+      myMovieKeyframes.push_back(key);
+    }
+
+    myMovieInput.putByteArray((const uInt8*)input.data(), input.size());
+    myMovieStates.putByteArray((const uInt8*)states.data(), states.size());
+    myMovieInterval = interval;
+    myMovieFrames = frames;
+    myMD5 = md5;
   }
-  else  // Turn off movie playback mode
+  catch(...)
   {
+    cerr << "ERROR: StateManager::loadMovie" << endl;
+    clearMovie();
+    return false;
+  }
+
+  return true;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool StateManager::toggleRewindMode()
+{
+  if(myActiveMode != kRewindRecordMode)  // Turn on rewind mode
+  {
+    allocateRewind(true);
+    myActiveMode = kRewindRecordMode;
+  }
+  else  // Turn off rewind mode
+  {
+    allocateRewind(false);
     myActiveMode = kOffMode;
-    myMovieReader.close();
+  }
+
+  return myActiveMode == kRewindRecordMode;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void StateManager::setRewindLimits(uInt32 bufferSize, uInt32 maxFrames,
+                                   uInt32 keyframeInterval)
+{
+  myRewindBufferSize = bufferSize;
+  myRewindMaxFrames = BSPF_max(maxFrames, 1u);
+  myRewindKeyframeInterval = BSPF_max(keyframeInterval, 1u);
+
+  allocateRewind(myActiveMode == kRewindRecordMode);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool StateManager::rewindState(uInt32 frames)
+{
+  if(frames == 0 || frames > myRewindCut - myRewindFirst)
     return false;
+
+  uInt32 frame = myRewindCut - frames;
+  const RewindEntry& entry = myRewindEntries[frame % myRewindMaxFrames];
+
+  // The keyframe we encode against is normally the one we need, since
+  // rewinding is mostly done a few frames at a time
+  if(!myKeyframeValid || myKeyframeNumber != entry.keyframe)
+  {
+    const RewindEntry& key = myRewindEntries[entry.keyframe % myRewindMaxFrames];
+    myKeyframeSize = decodeState(myRewindBuffer + key.offset, key.length, NULL,
+                                 myKeyframe, myStateCapacity);
+    myKeyframeNumber = entry.keyframe;
+    myKeyframeValid = myKeyframeSize > 0;
   }
 
-  return myActiveMode == kMoviePlaybackMode;
-#endif
-  return false;
+  bool loaded = false;
+  if(myKeyframeValid)
+  {
+    uInt8* state = myKeyframe;
+    uInt32 size = myKeyframeSize;
+    if(frame != entry.keyframe)
+    {
+      state = myStateScratch;
+      size = decodeState(myRewindBuffer + entry.offset, entry.length,
+                         myKeyframe, state, myKeyframeSize);
+    }
+
+    Serializer in(state, size, true);
+    loaded = size > 0 && loadState(in);
+  }
+
+  // Recording continues from here
+  myRewindCut = frame;
+
+  return loaded;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+StateManager::RewindStats StateManager::rewindStats() const
+{
+  RewindStats stats;
+  stats.frames     = myRewindCut - myRewindFirst;
+  stats.keyframes  = myRewindKeyframes;
+  stats.bytes      = myRewindBytes;
+  stats.bufferSize = myRewindBuffer ? myRewindBufferSize : 0;
+  stats.stateSize  = myKeyframeSize;
+  stats.lastBytes  = myRewindLastBytes;
+  stats.recorded   = myRewindRecorded;
+  stats.recordTime = myRewindTime;
+
+  return stats;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void StateManager::update()
 {
-#if 0
   switch(myActiveMode)
   {
     case kMovieRecordMode:
-      myOSystem->console().controller(Controller::Left).save(myMovieWriter);
-      myOSystem->console().controller(Controller::Right).save(myMovieWriter);
-      myOSystem->console().switches().save(myMovieWriter);
+    {
+      // A reset asked for since the last frame is done now.  It randomizes
+      // what it resets, so playback can't just do it again; it loads the
+      // keyframe taken right after it instead
+      bool reset = myMovieResetPending;
+      if(reset)
+      {
+        myMovieResetPending = false;
+        myOSystem->console().system().reset();
+      }
+
+      // Each keyframe holds the state from the start of its frame, with
+      // the frame's inputs already applied
+      bool keyframe = reset || myMovieFrames % myMovieInterval == 0;
+      if(keyframe)
+      {
+        myState.reset();
+        if(!saveState(myState))
+        {
+          myActiveMode = kOffMode;
+          break;
+        }
+
+        MovieKeyframe key;
+        key.frame = myMovieFrames;
+        key.input = myMovieInput.size();
+        key.offset = myMovieStates.size();
+        key.size = myState.size();
+        reserveStateBuffers(key.size);
+        key.length = encodeState(myState.data(), NULL, key.size, myStateScratch);
+#ifdef STATE_CHECK
+        checkEncodedState(myState.data(), NULL, key.size, myStateScratch,
+                          key.length);
+#endif
+        myMovieStates.putByteArray(myStateScratch, key.length);
+        myMovieKeyframes.push_back(key);
+      }
+      recordMovieInput(keyframe, reset);
       break;
+    }
 
     case kMoviePlaybackMode:
-      myOSystem->console().controller(Controller::Left).load(myMovieReader);
-      myOSystem->console().controller(Controller::Right).load(myMovieReader);
-      myOSystem->console().switches().load(myMovieReader);
+      if(!playMovieInput())
+        myActiveMode = kOffMode;
+      break;
+
+    case kRewindRecordMode:
+      addRewindState();
       break;
 
     default:
       break;
   }
-#endif
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void StateManager::resetSystem()
+{
+  if(!&myOSystem->console())
+    return;
+
+  if(myActiveMode == kMovieRecordMode)
+  {
+    myMovieResetPending = true;
+    return;
+  }
+
+  // The movie no longer decides what happens
+  if(myActiveMode == kMoviePlaybackMode)
+    myActiveMode = kOffMode;
+
+  myOSystem->console().system().reset();
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -195,11 +461,11 @@ void StateManager::loadState(int slot)
     // First test if we have a valid header
     // If so, do a complete state load using the Console
     buf.str("");
-    if(in.getString() != STATE_HEADER)
+    if(!in.checkTag(STATE_HEADER))
       buf << "Incompatible state " << slot << " file";
     else
     {
-      if(in.getString() == myOSystem->console().cartridge().name())
+      if(in.checkTag(myOSystem->console().cartridge().name()))
       {
         if(myOSystem->console().load(in))
           buf << "State " << slot << " loaded";
@@ -238,10 +504,10 @@ void StateManager::saveState(int slot)
 
     // Add header so that if the state format changes in the future,
     // we'll know right away, without having to parse the rest of the file
-    out.putString(STATE_HEADER);
+    out.putTag(STATE_HEADER);
 
     // Sanity check; prepend the cart type/name
-    out.putString(myOSystem->console().cartridge().name());
+    out.putTag(myOSystem->console().cartridge().name());
 
     // Do a complete state save using the Console
     buf.str("");
@@ -275,18 +541,25 @@ void StateManager::changeState()
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 bool StateManager::loadState(Serializer& in)
 {
-  if(&myOSystem->console())
+  try
   {
-    // Make sure the file can be opened for reading
-    if(in.isValid())
+    if(&myOSystem->console())
     {
-      // First test if we have a valid header and cart type
-      // If so, do a complete state load using the Console
-      return in.getString() == STATE_HEADER &&
-             in.getString() == myOSystem->console().cartridge().name() &&
-             myOSystem->console().load(in);
+      // Make sure the file can be opened for reading
+      if(in.isValid())
+      {
+        // First test if we have a valid header and cart type
+        // If so, do a complete state load using the Console
+        return in.checkTag(STATE_HEADER) &&
+               in.checkTag(myOSystem->console().cartridge().name()) &&
+               myOSystem->console().load(in);
+      }
     }
   }
+  catch(...)
+  {
+    cerr << "ERROR: StateManager::loadState(Serializer&)" << endl;
+  }
   return false;
 }
 
@@ -302,10 +575,10 @@ bool StateManager::saveState(Serializer& out)
       {
         // Add header so that if the state format changes in the future,
         // we'll know right away, without having to parse the rest of the file
-        out.putString(STATE_HEADER);
+        out.putTag(STATE_HEADER);
 
         // Sanity check; prepend the cart type/name
-        out.putString(myOSystem->console().cartridge().name());
+        out.putTag(myOSystem->console().cartridge().name());
 
         // Do a complete state save using the Console
         if(myOSystem->console().save(out))
@@ -321,28 +594,602 @@ bool StateManager::saveState(Serializer& out)
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-void StateManager::reset()
+bool StateManager::savePosition(Serializer& out)
+{
+  try
+  {
+    out.putInt(myHistoryId);
+    out.putInt(myActiveMode == kRewindRecordMode ? myRewindCut : myMovieFrame);
+  }
+  catch(...)
+  {
+    cerr << "ERROR: StateManager::savePosition" << endl;
+    return false;
+  }
+  return true;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void StateManager::loadPosition(Serializer& in)
 {
-#if 0
-  myCurrentSlot = 0;
+  bool valid = false;
+  uInt32 frame = 0;
+  try
+  {
+    valid = in.getInt() == myHistoryId;
+    frame = in.getInt();
+  }
+  catch(...)
+  {
+    cerr << "ERROR: StateManager::loadPosition" << endl;
+    valid = false;
+  }
 
   switch(myActiveMode)
   {
     case kMovieRecordMode:
-      myMovieWriter.close();
+      if(!valid || !truncateMovie(frame))
+        myActiveMode = kOffMode;
       break;
 
     case kMoviePlaybackMode:
-      myMovieReader.close();
+      if(!valid || frame > myMovieFrames ||
+         !findMovieInput(frame, myMovieInputPos))
+        myActiveMode = kOffMode;
+      else
+        myMovieFrame = frame;
+      break;
+
+    case kRewindRecordMode:
+      // The states rewound past are still held until the next one is
+      // recorded, so a state saved before rewinding can take them back
+      if(valid && frame >= myRewindFirst &&
+         frame <= myRewindFirst + myRewindCount)
+        myRewindCut = frame;
+      else
+        dropNewerRewindStates(myRewindFirst);
       break;
 
     default:
       break;
   }
-  myActiveMode = kOffMode;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void StateManager::reset()
+{
+  // The movie and rewind history belong to whatever was running before;
+  // rewind mode stays on, to record whatever runs next
+  if(myActiveMode != kRewindRecordMode)
+    myActiveMode = kOffMode;
+  clearMovie();
+  myMD5 = "";
+
+  allocateRewind(myActiveMode == kRewindRecordMode);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void StateManager::recordMovieInput(bool keyframe, bool reset)
+{
+  Console& console = myOSystem->console();
+  for(int i = 0; i < 2; ++i)
+  {
+    Controller& controller =
+      console.controller(i == 0 ? Controller::Left : Controller::Right);
+
+    // The pins are read back the same way a state is saved
+    myPinState.reset();
+    controller.save(myPinState);
+    myPinState.reset();
+    uInt8 pins = 0;
+    for(int pin = 0; pin < 5; ++pin)
+      if(myPinState.getBool())
+        pins |= 1 << pin;
+    Int32 five = (Int32) myPinState.getInt();
+    Int32 nine = (Int32) myPinState.getInt();
+
+    // Only paddles change the analog pins, so they're logged only when
+    // they change, and at every keyframe so that playback can start there
+    bool analog = keyframe || five != myMovieAnalog[i][0] ||
+                  nine != myMovieAnalog[i][1];
+    if(analog)
+      pins |= 0x80;
+
+    // A reset is logged with the pins of the left controller
+    if(i == 0 && reset)
+      pins |= 0x40;
+
+    myMovieInput.putByte(pins);
+    if(analog)
+    {
+      myMovieInput.putInt(five);
+      myMovieInput.putInt(nine);
+      myMovieAnalog[i][0] = five;
+      myMovieAnalog[i][1] = nine;
+    }
+  }
+  myMovieInput.putByte(console.switches().read());
+
+  myMovieFrame = ++myMovieFrames;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool StateManager::readMovieInput(uInt32& pos, uInt8* pins, uInt8& switches)
+{
+  const uInt8* input = myMovieInput.data();
+  uInt32 end = myMovieInput.size();
+  for(int i = 0; i < 2; ++i)
+  {
+    if(pos >= end)
+      return false;
+    pins[i] = input[pos++];
+    if(pins[i] & 0x80)
+    {
+      if(end - pos < 8)
+        return false;
+      memcpy(&myMovieAnalog[i][0], input + pos, 4);
+      memcpy(&myMovieAnalog[i][1], input + pos + 4, 4);
+      pos += 8;
+    }
+  }
+
+  if(pos >= end)
+    return false;
+  switches = input[pos++];
+
+  return true;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool StateManager::playMovieInput()
+{
+  uInt8 pins[2], switches;
+  if(myMovieFrame >= myMovieFrames ||
+     !readMovieInput(myMovieInputPos, pins, switches))
+    return false;
+
+  // A reset was recorded with a keyframe of the state it left, which is
+  // loaded over a reset here (that also clears what a state doesn't hold)
+  Console& console = myOSystem->console();
+  if(pins[0] & 0x40)
+  {
+    uInt32 index = findMovieKeyframe(myMovieFrame);
+    if(myMovieKeyframes[index].frame != myMovieFrame)
+      return false;
+    console.system().reset();
+    if(!loadMovieKeyframe(index))
+      return false;
+  }
+
+  // The pins are set the same way a state is loaded
+  for(int i = 0; i < 2; ++i)
+  {
+    myPinState.reset();
+    for(int pin = 0; pin < 5; ++pin)
+      myPinState.putBool(pins[i] & (1 << pin));
+    myPinState.putInt(myMovieAnalog[i][0]);
+    myPinState.putInt(myMovieAnalog[i][1]);
+    myPinState.reset();
+    console.controller(i == 0 ? Controller::Left : Controller::Right).load(myPinState);
+  }
+
+  myPinState.reset();
+  myPinState.putByte(switches);
+  myPinState.reset();
+  console.switches().load(myPinState);
+
+  ++myMovieFrame;
+  return true;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+uInt32 StateManager::findMovieKeyframe(uInt32 frame) const
+{
+  // The last keyframe at or before the frame; the first one is at frame 0
+  uInt32 low = 0, high = myMovieKeyframes.size();
+  while(high - low > 1)
+  {
+    uInt32 middle = (low + high) / 2;
+    if(myMovieKeyframes[middle].frame <= frame)
+      low = middle;
+    else
+      high = middle;
+  }
+
+  return low;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool StateManager::loadMovieKeyframe(uInt32 index)
+{
+  const MovieKeyframe& key = myMovieKeyframes[index];
+  uInt32 capacity = 0;
+  try
+  {
+    capacity = reserveStateBuffers(key.size);
+  }
+  catch(...)
+  {
+    cerr << "ERROR: StateManager::loadMovieKeyframe" << endl;
+    return false;
+  }
+  uInt32 size = decodeState(myMovieStates.data() + key.offset, key.length,
+                            NULL, myStateScratch, capacity);
+
+  Serializer in(myStateScratch, size, true);
+  return size == key.size && loadState(in);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool StateManager::findMovieInput(uInt32 frame, uInt32& pos)
+{
+  if(myMovieKeyframes.size() == 0)
+  {
+    pos = 0;
+    return frame == 0;
+  }
+
+  // Inputs can only be walked forward, from the keyframe before the frame
+  uInt32 index = findMovieKeyframe(frame);
+  pos = myMovieKeyframes[index].input;
+  uInt8 pins[2], switches;
+  for(uInt32 f = myMovieKeyframes[index].frame; f < frame; ++f)
+    if(!readMovieInput(pos, pins, switches))
+      return false;
+
+  return true;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool StateManager::truncateMovie(uInt32 frame)
+{
+  if(frame > myMovieFrames)
+    return false;
+
+  while(myMovieKeyframes.size() > 0 &&
+        myMovieKeyframes[myMovieKeyframes.size() - 1].frame >= frame)
+    myMovieKeyframes.remove_at(myMovieKeyframes.size() - 1);
+
+  uInt32 pos = 0;
+  if(!findMovieInput(frame, pos))
+    return false;
+  myMovieInput.truncate(pos);
+
+  if(myMovieKeyframes.size() > 0)
+  {
+    const MovieKeyframe& key = myMovieKeyframes[myMovieKeyframes.size() - 1];
+    myMovieStates.truncate(key.offset + key.length);
+  }
+  else
+    myMovieStates.truncate(0);
+
+  myMovieFrames = myMovieFrame = frame;
+  myMovieResetPending = false;
+  return true;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void StateManager::clearMovie()
+{
+  myMovieInput.reset();
+  myMovieStates.reset();
+  myMovieKeyframes.clear();
+  myMovieFrames = myMovieFrame = myMovieInputPos = 0;
+  myMovieResetPending = false;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+uInt32 StateManager::reserveStateBuffers(uInt32 size)
+{
+  // Worst case, the encoding adds a byte for every 128 bytes
+  uInt32 maxLength = size + (size + 127) / 128;
+  if(maxLength > myStateCapacity)
+  {
+    delete[] myKeyframe;
+    delete[] myStateScratch;
+    myKeyframe = new uInt8[maxLength];
+    myStateScratch = new uInt8[maxLength];
+    myStateCapacity = maxLength;
+    myKeyframeValid = false;
+  }
+
+  return maxLength;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void StateManager::addRewindState()
+{
+  uInt64 start = myOSystem->getTicks();
+
+  // The states rewound past are replaced by this one
+  if(myRewindCut < myRewindFirst + myRewindCount)
+    dropNewerRewindStates(myRewindCut);
+
+  myState.reset();
+  if(!saveState(myState))
+    return;
+
+  const uInt8* state = myState.data();
+  uInt32 size = myState.size();
+
+  if(reserveStateBuffers(size) > myRewindBufferSize)
+    return;
+
+  uInt32 frame = myRewindFirst + myRewindCount;
+  bool keyframe = !myKeyframeValid || size != myKeyframeSize ||
+                  frame - myKeyframeNumber >= myRewindKeyframeInterval;
+  uInt32 length = encodeState(state, keyframe ? NULL : myKeyframe, size,
+                              myStateScratch);
+
+  // Make room for it, dropping the oldest states as needed; a state never
+  // wraps around the end of the buffer, the rest of it is left unused
+  bool wrap = myRewindHead + length > myRewindBufferSize;
+  uInt32 offset = wrap ? 0 : myRewindHead;
+  while(myRewindCount > 0)
+  {
+    const RewindEntry& oldest =
+      myRewindEntries[myRewindFirst % myRewindMaxFrames];
+    if(myRewindCount < myRewindMaxFrames &&
+       !(wrap && oldest.offset >= myRewindHead) &&
+       (oldest.offset >= offset + length ||
+        oldest.offset + oldest.length <= offset))
+      break;
+
+    dropOldestRewindState();
+  }
+
+  // All the history may be gone, including the keyframe this state was
+  // encoded against
+  if(!keyframe && myRewindCount == 0)
+  {
+    keyframe = true;
+    length = encodeState(state, NULL, size, myStateScratch);
+  }
+  if(myRewindCount == 0)
+  {
+    myRewindFirst = frame;
+    offset = 0;
+  }
+
+  memcpy(myRewindBuffer + offset, myStateScratch, length);
+  RewindEntry& entry = myRewindEntries[frame % myRewindMaxFrames];
+  entry.offset = offset;
+  entry.length = length;
+  entry.keyframe = keyframe ? frame : myKeyframeNumber;
+#ifdef STATE_CHECK
+  checkEncodedState(state, keyframe ? NULL : myKeyframe, size,
+                    myRewindBuffer + offset, length);
+#endif
+
+  ++myRewindCount;
+  myRewindCut = frame + 1;
+  myRewindHead = offset + length;
+  myRewindBytes += length;
+  myRewindLastBytes = length;
+
+  if(keyframe)
+  {
+    memcpy(myKeyframe, state, size);
+    myKeyframeSize = size;
+    myKeyframeNumber = frame;
+    myKeyframeValid = true;
+    ++myRewindKeyframes;
+  }
+
+  ++myRewindRecorded;
+  myRewindTime += myOSystem->getTicks() - start;
+
+#ifdef STATE_CHECK
+  checkRewindHistory();
+#endif
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void StateManager::dropOldestRewindState()
+{
+  // States can't outlive their keyframe, so the oldest is always a keyframe
+  do
+  {
+    const RewindEntry& oldest =
+      myRewindEntries[myRewindFirst % myRewindMaxFrames];
+    myRewindBytes -= oldest.length;
+    if(oldest.keyframe == myRewindFirst)
+      --myRewindKeyframes;
+
+    ++myRewindFirst;
+    --myRewindCount;
+  }
+  while(myRewindCount > 0 &&
+        myRewindEntries[myRewindFirst % myRewindMaxFrames].keyframe != myRewindFirst);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void StateManager::dropNewerRewindStates(uInt32 frame)
+{
+  while(myRewindFirst + myRewindCount > frame)
+  {
+    --myRewindCount;
+    const RewindEntry& newest =
+      myRewindEntries[(myRewindFirst + myRewindCount) % myRewindMaxFrames];
+    myRewindBytes -= newest.length;
+    if(newest.keyframe == myRewindFirst + myRewindCount)
+      --myRewindKeyframes;
+  }
+  if(myRewindCount > 0)
+  {
+    const RewindEntry& newest =
+      myRewindEntries[(myRewindFirst + myRewindCount - 1) % myRewindMaxFrames];
+    myRewindHead = newest.offset + newest.length;
+  }
+  else
+    myRewindFirst = myRewindHead = 0;
+  myRewindCut = myRewindFirst + myRewindCount;
+
+  if(myKeyframeNumber >= myRewindFirst + myRewindCount)
+    myKeyframeValid = false;
+
+#ifdef STATE_CHECK
+  checkRewindHistory();
 #endif
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void StateManager::allocateRewind(bool enable)
+{
+  delete[] myRewindBuffer;
+  delete[] myRewindEntries;
+  delete[] myKeyframe;
+  delete[] myStateScratch;
+  myRewindBuffer = NULL;
+  myRewindEntries = NULL;
+  myKeyframe = myStateScratch = NULL;
+  myStateCapacity = 0;
+
+  myRewindFirst = myRewindCount = myRewindHead = myRewindCut = 0;
+  myKeyframeSize = myKeyframeNumber = 0;
+  myKeyframeValid = false;
+
+  myRewindBytes = myRewindKeyframes = myRewindLastBytes = 0;
+  myRewindRecorded = myRewindTime = 0;
+
+  if(enable)
+  {
+    myRewindBuffer = new uInt8[myRewindBufferSize];
+    myRewindEntries = new RewindEntry[myRewindMaxFrames];
+    myHistoryId = (uInt32)myOSystem->getTicks();
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+uInt32 StateManager::encodeState(const uInt8* state, const uInt8* ref,
+                                 uInt32 size, uInt8* out)
+{
+  // Most of a state is the same as in its keyframe, so the difference
+  // (XOR) is mostly zero.  It's stored as runs: a control byte 0x80 + n
+  // means n + 1 zero bytes, a control byte n means n + 1 bytes follow.
+  uInt8* start = out;
+  uInt32 i = 0;
+  while(i < size)
+  {
+    uInt32 run = 0;
+    while(i + run < size && run < 128 &&
+          state[i + run] == (ref ? ref[i + run] : 0))
+      ++run;
+    if(run > 0)
+    {
+      *out++ = 0x80 + run - 1;
+      i += run;
+      continue;
+    }
+
+    // A single equal byte is cheaper to keep in a literal run than to end it
+    uInt8* control = out++;
+    for(run = 0; i < size && run < 128; ++run, ++i)
+    {
+      if(state[i] == (ref ? ref[i] : 0) && i + 1 < size &&
+         state[i + 1] == (ref ? ref[i + 1] : 0))
+        break;
+      *out++ = state[i] ^ (ref ? ref[i] : 0);
+    }
+    *control = run - 1;
+  }
+
+  return out - start;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+uInt32 StateManager::decodeState(const uInt8* in, uInt32 length,
+                                 const uInt8* ref, uInt8* state, uInt32 size)
+{
+  const uInt8* end = in + length;
+  uInt32 i = 0;
+  while(in < end)
+  {
+    uInt8 control = *in++;
+    uInt32 run = (control & 0x7f) + 1;
+    if(run > size - i)
+      return 0;
+
+    if(control & 0x80)
+    {
+      for(uInt32 j = 0; j < run; ++j, ++i)
+        state[i] = ref ? ref[i] : 0;
+    }
+    else
+    {
+      if(run > (uInt32)(end - in))
+        return 0;
+      for(uInt32 j = 0; j < run; ++j, ++i)
+        state[i] = *in++ ^ (ref ? ref[i] : 0);
+    }
+  }
+
+  return i;
+}
+
+#ifdef STATE_CHECK
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool StateManager::checkEncodedState(const uInt8* state, const uInt8* ref,
+                                     uInt32 size, const uInt8* in,
+                                     uInt32 length)
+{
+  uInt8* decoded = new uInt8[size];
+  bool ok = decodeState(in, length, ref, decoded, size) == size &&
+            memcmp(decoded, state, size) == 0;
+  delete[] decoded;
+
+  if(!ok)
+    cerr << "ERROR: StateManager: state of " << size << " bytes doesn't "
+         << "decode back from its " << length << " encoded bytes" << endl;
+  return ok;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool StateManager::checkRewindHistory() const
+{
+  bool ok = myRewindCount <= myRewindMaxFrames;
+  uInt32 bytes = 0, keyframes = 0, end = 0;
+  bool wrapped = false;
+  for(uInt32 i = 0; ok && i < myRewindCount; ++i)
+  {
+    uInt32 frame = myRewindFirst + i;
+    const RewindEntry& entry = myRewindEntries[frame % myRewindMaxFrames];
+    const RewindEntry& oldest = myRewindEntries[myRewindFirst % myRewindMaxFrames];
+
+    // Each state starts where the one before it ends, except once, when
+    // it wraps around to the start of the buffer; from then on, states
+    // have to end before the oldest one starts
+    if(i > 0 && entry.offset != end)
+    {
+      ok = !wrapped && entry.offset == 0;
+      wrapped = true;
+    }
+    end = entry.offset + entry.length;
+    ok = ok && end <= myRewindBufferSize &&
+         (!wrapped || end <= oldest.offset);
+
+    // The oldest state is a keyframe, and every other state is encoded
+    // against a keyframe that's still held
+    ok = ok && entry.keyframe >= myRewindFirst && entry.keyframe <= frame &&
+         (i > 0 || entry.keyframe == frame) &&
+         myRewindEntries[entry.keyframe % myRewindMaxFrames].keyframe ==
+           entry.keyframe;
+
+    bytes += entry.length;
+    if(entry.keyframe == frame)
+      ++keyframes;
+  }
+  ok = ok && bytes == myRewindBytes && keyframes == myRewindKeyframes &&
+       end == myRewindHead;
+
+  if(!ok)
+    cerr << "ERROR: StateManager: rewind history of " << myRewindCount
+         << " states starting at frame " << myRewindFirst
+         << " is inconsistent" << endl;
+  return ok;
+}
+#endif
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 StateManager::StateManager(const StateManager&)
 {
@@ -22,6 +22,7 @@
 
 class OSystem;
 
+#include "Array.hxx"
 #include "Serializer.hxx"
 
 /**
@@ -34,6 +35,20 @@ class OSystem;
 */
 class StateManager
 {
+  public:
+    // How the rewind history is doing, to judge its cost
+    struct RewindStats
+    {
+      uInt32 frames;      // the number of states that can be rewound to
+      uInt32 keyframes;   // how many of those are keyframes
+      uInt32 bytes;       // the compressed size of all states held
+      uInt32 bufferSize;  // the size of the ring buffer holding them
+      uInt32 stateSize;   // the uncompressed size of one state
+      uInt32 lastBytes;   // the compressed size of the newest state
+      uInt64 recorded;    // the number of states recorded so far
+      uInt64 recordTime;  // the time spent recording them, in microseconds
+    };
+
   public:
     /**
       Create a new statemananger class
@@ -51,9 +66,118 @@ class StateManager
     */
     bool isActive();
 
+    /**
+      Start or stop recording a movie: the inputs of every frame (the
+      controller pins, console switches and resets), with a keyframe state
+      every so often.  Starting throws away the movie currently held.
+
+      @return  True if movie record mode is now on
+    */
     bool toggleRecordMode();
+
+    /**
+      Start or stop playing back the movie currently held, from its first
+      frame.  The recorded inputs override the real ones, and playback
+      stops by itself at the end of the movie.
+
+      @return  True if movie playback mode is now on
+    */
+    bool togglePlaybackMode();
+
+    /**
+      Answers whether movie playback mode is on
+    */
+    bool isPlaybackMode() const { return myActiveMode == kMoviePlaybackMode; }
+
+    /**
+      Go to the given frame of the movie currently held, so that it's the
+      next one played back.  This loads the nearest keyframe before it and
+      emulates the frames in between, so it takes the same time no matter
+      where it seeks to.  Not possible while recording.
+
+      @param frame  The frame to go to, up to the length of the movie
+      @return  False if there's no such frame, or on load errors
+    */
+    bool seekMovie(uInt32 frame);
+
+    /**
+      Answers the number of frames in the movie, and the next frame to be
+      recorded or played back.
+    */
+    uInt32 movieLength() const { return myMovieFrames; }
+    uInt32 movieFrame() const  { return myMovieFrame; }
+
+    /**
+      Set the number of frames between keyframes in the next movie
+      recorded; fewer mean faster seeking but bigger movies.
+    */
+    void setMovieKeyframeInterval(uInt32 interval);
+
+    /**
+      Save the movie currently held to the given file.
+
+      @return  False if there's no movie, or on any save errors
+    */
+    bool saveMovie(const string& filename);
+
+    /**
+      Load a movie from the given file, replacing the one currently held.
+      The movie must have been recorded with the current ROM and
+      controllers.
+
+      @return  False on any load errors
+    */
+    bool loadMovie(const string& filename);
+
+    /**
+      Start or stop recording the state of every frame, so that emulation
+      can later be rewound.  Stopping throws the history away.
+
+      @return  True if rewind mode is now on
+    */
     bool toggleRewindMode();
 
+    /**
+      Answers whether rewind mode is on
+    */
+    bool isRewindMode() const { return myActiveMode == kRewindRecordMode; }
+
+    /**
+      Set how much history rewind mode keeps.  Any history recorded so
+      far is thrown away.
+
+      @param bufferSize  The size of the buffer holding the states, in bytes
+      @param maxFrames   The most states held, no matter how small
+      @param keyframeInterval  The number of frames between full states;
+                               the others are stored relative to them
+    */
+    void setRewindLimits(uInt32 bufferSize, uInt32 maxFrames,
+                         uInt32 keyframeInterval);
+
+    /**
+      Go back to the state recorded the given number of frames ago (1 is
+      the newest state).  That state and all newer ones are removed from
+      the history when the next state is recorded; they're recorded again
+      as emulation continues.
+
+      @param frames  How many frames to go back
+      @return  False if there's not that much history, or on load errors
+    */
+    bool rewindState(uInt32 frames = 1);
+
+    /**
+      Answers the current size and cost of the rewind history.
+    */
+    RewindStats rewindStats() const;
+
+    /**
+      Reset the system, as asked for by the user.  While recording a movie
+      the reset is done when the next frame starts, and recorded with it
+      (along with the state right after it, since a reset randomizes what
+      it resets); while playing one back, playback stops.
+    */
+    void resetSystem();
+
     /**
       Updates the state of the system based on the currently active mode
     */
@@ -98,11 +222,104 @@ class StateManager
     */
     bool saveState(Serializer& out);
 
+    /**
+      Save where the movie being recorded or played back, or the rewind
+      history, is, after a state the frontend saves with saveState(), so
+      that loadPosition() can take it back there when the state is loaded
+      again.
+
+      @param out  The Serializer object to use
+
+      @return  False on any save errors, else true
+    */
+    bool savePosition(Serializer& out);
+
+    /**
+      Take the movie being recorded or played back, or the rewind history,
+      to where it was when the state just loaded was saved.  Frames
+      recorded since then are thrown away, since they didn't happen after
+      all (as with the frames a frontend runs ahead).  Recording or
+      playback stops if the state wasn't saved with this movie, or is past
+      its end; the rewind history is emptied if the state wasn't saved
+      with it, or its frame is no longer held.
+
+      @param in  The Serializer object to use
+    */
+    void loadPosition(Serializer& in);
+
     /**
       Resets manager to defaults
     */
     void reset();
 
+  private:
+    // Append the current inputs to the movie, as the next frame
+    void recordMovieInput(bool keyframe, bool reset);
+
+    // Apply the inputs of the next frame in the movie, answering false
+    // at its end
+    bool playMovieInput();
+
+    // Read the inputs of a frame in the movie that start at the given
+    // position, moving it to the next frame (and updating the analog
+    // pins); answers false at the end of the input log
+    bool readMovieInput(uInt32& pos, uInt8* pins, uInt8& switches);
+
+    // Answer the index of the last keyframe at or before the given frame
+    uInt32 findMovieKeyframe(uInt32 frame) const;
+
+    // Find where the inputs of the given frame start in the input log
+    bool findMovieInput(uInt32 frame, uInt32& pos);
+
+    // Load the state of the keyframe with the given index
+    bool loadMovieKeyframe(uInt32 index);
+
+    // Throw away the frames recorded from the given one on
+    bool truncateMovie(uInt32 frame);
+
+    // Throw away the movie currently held
+    void clearMovie();
+
+    // Make sure the state buffers can hold a state of the given size,
+    // answering the most it can take when encoded
+    uInt32 reserveStateBuffers(uInt32 size);
+
+    // Record the current state into the rewind history
+    void addRewindState();
+
+    // Remove the oldest state from the rewind history, along with any
+    // states that depended on it
+    void dropOldestRewindState();
+
+    // Remove the state recorded at the given frame and all newer ones
+    // from the rewind history
+    void dropNewerRewindStates(uInt32 frame);
+
+    // Allocate (or free) the rewind history, throwing away its contents
+    void allocateRewind(bool enable);
+
+    // Compress a state with run-length encoding, relative to the given
+    // reference state (if any); answers the compressed size
+    static uInt32 encodeState(const uInt8* state, const uInt8* ref,
+                              uInt32 size, uInt8* out);
+
+    // Reverse encodeState(), answering the uncompressed size (or 0 on
+    // errors)
+    static uInt32 decodeState(const uInt8* in, uInt32 length,
+                              const uInt8* ref, uInt8* state, uInt32 size);
+
+#ifdef STATE_CHECK
+    // Check that an encoded state decodes back to the state it was
+    // encoded from, complaining on cerr if it doesn't
+    static bool checkEncodedState(const uInt8* state, const uInt8* ref,
+                                  uInt32 size, const uInt8* in, uInt32 length);
+
+    // Check that the states in the rewind history follow each other in
+    // the buffer without overlapping, that each one's keyframe is held,
+    // and that the running totals add up, complaining on cerr if not
+    bool checkRewindHistory() const;
+#endif
+
   private:
     // Copy constructor isn't supported by this class so make it private
     StateManager(const StateManager&);
@@ -120,7 +337,19 @@ class StateManager
     };
 
     enum {
-      kVersion = 001
+      kVersion = 001,
+
+      // By default, rewind keeps 5 minutes of NTSC frames in 4 MB
+      kRewindBufferSize       = 4 * 1024 * 1024,
+      kRewindMaxFrames        = 5 * 60 * 60,
+      kRewindKeyframeInterval = 60,
+
+      // Seeking in a movie emulates up to a second of NTSC frames
+      kMovieKeyframeInterval  = 60,
+
+      // No state comes anywhere near this big; bigger ones in a movie
+      // file are taken to be bogus
+      kMaxStateSize           = 1024 * 1024
     };
 
     // The parent OSystem object
@@ -135,9 +364,95 @@ class StateManager
     // MD5 of the currently active ROM (either in movie or rewind mode)
     string myMD5;
 
-    // Serializer classes used to save/load the eventstream
-    Serializer myMovieWriter;
-    Serializer myMovieReader;
+    // A state in a movie, for the frame it's recorded at (a multiple of
+    // the keyframe interval, or right after a reset)
+    struct MovieKeyframe
+    {
+      uInt32 frame;   // the frame it's the state at the start of
+      uInt32 input;   // where the frame's inputs start in the input log
+      uInt32 offset;  // where the compressed state starts
+      uInt32 length;  // the size of the compressed state
+      uInt32 size;    // the size of the state itself
+    };
+    typedef Common::Array<MovieKeyframe> MovieKeyframeList;
+
+    // The movie: the input log, the compressed keyframe states, and where
+    // the keyframes are in both
+    Serializer myMovieInput;
+    Serializer myMovieStates;
+    MovieKeyframeList myMovieKeyframes;
+    uInt32 myMovieInterval;
+    uInt32 myMovieFrames;
+
+    // The keyframe interval for the next movie recorded
+    uInt32 myMovieKeyframeInterval;
+
+    // The next frame to be recorded or played back, and where its inputs
+    // are in the input log
+    uInt32 myMovieFrame;
+    uInt32 myMovieInputPos;
+
+    // The analog pins of each controller, which are only logged when
+    // they change
+    Int32 myMovieAnalog[2][2];
+
+    // Indicates a reset was asked for while recording, to be done (and
+    // recorded) when the next frame starts
+    bool myMovieResetPending;
+
+    // Identifies the movie being recorded or played back, or the rewind
+    // history, so that positions saved with another one aren't applied to it
+    uInt32 myHistoryId;
+
+    // Used to get and set the pins of a controller
+    Serializer myPinState;
+
+    // A state in the rewind history; keyframes are compressed on their
+    // own, the others as the difference from their keyframe
+    struct RewindEntry
+    {
+      uInt32 offset;    // where the compressed state starts in the buffer
+      uInt32 length;    // the size of the compressed state
+      uInt32 keyframe;  // the frame number of its keyframe (its own, for
+                        // keyframes)
+    };
+
+    // The rewind history: the compressed states are stored one after the
+    // other in a ring buffer, and described by a ring of entries indexed
+    // by frame number.  States are dropped oldest first when either is full.
+    uInt8* myRewindBuffer;
+    uInt32 myRewindBufferSize;
+    RewindEntry* myRewindEntries;
+    uInt32 myRewindMaxFrames;
+    uInt32 myRewindKeyframeInterval;
+
+    // The frame number of the oldest state held, the number of states
+    // held, and where the next compressed state goes in the buffer
+    uInt32 myRewindFirst;
+    uInt32 myRewindCount;
+    uInt32 myRewindHead;
+
+    // The frame rewinding has gone back to; the states from it on are
+    // dropped when the next one is recorded, so that until then, loading
+    // a state saved before rewinding can still take them back
+    uInt32 myRewindCut;
+
+    // The state being recorded, the keyframe the next states are encoded
+    // against, and room for a compressed/decompressed state
+    Serializer myState;
+    uInt8* myKeyframe;
+    uInt8* myStateScratch;
+    uInt32 myStateCapacity;
+    uInt32 myKeyframeSize;
+    uInt32 myKeyframeNumber;
+    bool myKeyframeValid;
+
+    // Running totals for rewindStats()
+    uInt32 myRewindBytes;
+    uInt32 myRewindKeyframes;
+    uInt32 myRewindLastBytes;
+    uInt64 myRewindRecorded;
+    uInt64 myRewindTime;
 };
 
 #endif
@@ -25,6 +25,9 @@
 #include "M6532.hxx"
 #include "TIA.hxx"
 #include "System.hxx"
+#ifdef PROFILER_SUPPORT
+  #include "Profiler.hxx"
+#endif
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 System::System(uInt16 n, uInt16 m)
@@ -40,6 +43,10 @@ System::System(uInt16 n, uInt16 m)
     myDataBusLocked(false),
     mySystemInAutodetect(false)
 {
+#ifdef PROFILER_SUPPORT
+  myProfiler = 0;
+#endif
+
   // Make sure the arguments are reasonable
   assert((1 <= m) && (m <= n) && (n <= 16));
 
@@ -158,6 +165,16 @@ void System::resetCycles()
   myCycles = 0;
 }
 
+#ifdef PROFILER_SUPPORT
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void System::setProfiler(Profiler* profiler)
+{
+  myProfiler = profiler;
+  if(myM6502 != 0)
+    myM6502->setProfiler(profiler);
+}
+#endif
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void System::setPageAccess(uInt16 page, const PageAccess& access)
 {
@@ -185,6 +202,28 @@ System::PageAccessType System::getPageAccessType(uInt16 addr) const
   return myPageAccessTable[(addr & myAddressMask) >> myPageShift].type;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Device* System::getPeekDevice(uInt16 addr) const
+{
+  const PageAccess& access =
+      myPageAccessTable[(addr & myAddressMask) >> myPageShift];
+
+  return access.directPeekBase ? 0 : access.device;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool System::peekDirect(uInt16 addr, uInt8& value) const
+{
+  const PageAccess& access =
+      myPageAccessTable[(addr & myAddressMask) >> myPageShift];
+
+  if(!access.directPeekBase)
+    return false;
+
+  value = *(access.directPeekBase + (addr & myPageMask));
+  return true;
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void System::setDirtyPage(uInt16 addr)
 {
@@ -216,6 +255,11 @@ uInt8 System::peek(uInt16 addr, uInt8 flags)
 {
   PageAccess& access = myPageAccessTable[(addr & myAddressMask) >> myPageShift];
 
+#ifdef PROFILER_SUPPORT
+  if(myProfiler)
+    myProfiler->access(access.device, false);
+#endif
+
 #ifdef DEBUGGER_SUPPORT
   // Set access type
   if(access.codeAccessBase)
@@ -244,7 +288,12 @@ void System::poke(uInt16 addr, uInt8 value)
 {
   uInt16 page = (addr & myAddressMask) >> myPageShift;
   PageAccess& access = myPageAccessTable[page];
-  
+
+#ifdef PROFILER_SUPPORT
+  if(myProfiler)
+    myProfiler->access(access.device, true);
+#endif
+
   // See if this page uses direct accessing or not 
   if(access.directPokeBase)
   {
@@ -309,7 +358,7 @@ bool System::save(Serializer& out) const
 {
   try
   {
-    out.putString(name());
+    out.putTag(name());
     out.putInt(myCycles);
     out.putByte(myDataBusState);
 
@@ -335,7 +384,7 @@ bool System::load(Serializer& in)
 {
   try
   {
-    if(in.getString() != name())
+    if(!in.checkTag(name()))
       return false;
 
     myCycles = in.getInt();
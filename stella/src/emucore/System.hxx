@@ -25,6 +25,7 @@ class M6502;
 class M6532;
 class TIA;
 class NullDevice;
+class Profiler;
 
 #include "bspf.hxx"
 #include "Device.hxx"
@@ -198,6 +199,22 @@ class System : public Serializable
     */
     bool autodetectMode() const { return mySystemInAutodetect; }
 
+#ifdef PROFILER_SUPPORT
+    /**
+      Attach a profiler to the system and its processor, or detach the
+      current one when passed the null pointer.  The system doesn't take
+      ownership of the profiler.
+
+      @param profiler  The profiler to collect statistics in
+    */
+    void setProfiler(Profiler* profiler);
+
+    /**
+      Answer the profiler attached to the system, if any.
+    */
+    Profiler* profiler() const { return myProfiler; }
+#endif
+
   public:
     /**
       Get the current state of the data bus in the system.  The current
@@ -370,6 +387,28 @@ class System : public Serializable
     */
     System::PageAccessType getPageAccessType(uInt16 addr) const;
 
+    /**
+      Get the device whose peek method handles reads from the given
+      address, or the null pointer if the page containing the address
+      uses direct accessing for reads.
+
+      @param addr  The address contained in the page in question
+      @return  The device handling reads from the address, if any
+    */
+    Device* getPeekDevice(uInt16 addr) const;
+
+    /**
+      Get the byte at the specified address, but only if the page
+      containing the address uses direct accessing for reads.  Such reads
+      never have side effects, so this may be used to inspect memory
+      (ie, code in ROM) without disturbing the state of the system.
+
+      @param addr   The address from which the value should be loaded
+      @param value  The byte at the address, if it could be read directly
+      @return  True if the byte could be read directly, else false
+    */
+    bool peekDirect(uInt16 addr, uInt8& value) const;
+
     /**
       Mark the page containing this address as being dirty.
 
@@ -471,6 +510,11 @@ class System : public Serializable
     // Some parts of the codebase need to act differently in such a case
     bool mySystemInAutodetect;
 
+#ifdef PROFILER_SUPPORT
+    // Profiler collecting statistics on device accesses, or the null pointer
+    Profiler* myProfiler;
+#endif
+
   private:
     // Copy constructor isn't supported by this class so make it private
     System(const System&);
@@ -272,7 +272,7 @@ bool TIA::save(Serializer& out) const
 
   try
   {
-    out.putString(device);
+    out.putTag(device);
 
     out.putInt(myClockWhenFrameStarted);
     out.putInt(myClockStartDisplay);
@@ -375,7 +375,7 @@ bool TIA::load(Serializer& in)
 
   try
   {
-    if(in.getString() != device)
+    if(!in.checkTag(device))
       return false;
 
     myClockWhenFrameStarted = (Int32) in.getInt();
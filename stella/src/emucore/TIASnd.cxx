@@ -42,6 +42,7 @@ void TIASound::reset()
   polyInit(Bit4, 4, 4, 3);
   polyInit(Bit5, 5, 5, 3);
   polyInit(Bit9, 9, 9, 5);
+  clockActionInit();
 
   // Initialize instance variables
   for(int chan = 0; chan <= 1; ++chan)
@@ -59,6 +60,8 @@ void TIASound::reset()
   }
 
   myOutputCounter = 0;
+  myBlep[0].reset();
+  myBlep[1].reset();
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -177,12 +180,126 @@ void TIASound::volume(uInt32 percent)
     myVolumePercentage = percent;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+inline Int16 TIASound::clockChannel(int chan, Int16 v, Int16 audv)
+{
+  // The P5 counter has multiple uses, so we increment it here
+  uInt8 p5 = myP5[chan] + 1;
+  if (p5 == POLY5_SIZE)
+    p5 = 0;
+  myP5[chan] = p5;
+
+  switch(myClockAction[myAUDC[chan]][p5])
+  {
+    case TOGGLE:
+      // If the output was set turn it off, else turn it on
+      return v ? 0 : audv;
+
+    case DIV3:
+      if (--myDiv3Cnt[chan])
+        return v;
+      myDiv3Cnt[chan] = 3;
+      return v ? 0 : audv;
+
+    case SET_POLY4:
+      // Increase the poly4 counter
+      if (++myP4[chan] == POLY4_SIZE)
+        myP4[chan] = 0;
+      return Bit4[myP4[chan]] ? audv : 0;
+
+    case SET_POLY5:
+      return Bit5[p5] ? audv : 0;
+
+    case SET_POLY9:
+      // Increase the poly9 counter
+      if (++myP9[chan] == POLY9_SIZE)
+        myP9[chan] = 0;
+      return Bit9[myP9[chan]] ? audv : 0;
+
+    case SET_TO_0:
+      return 0;
+
+    default:  // NO_CLOCK
+      return v;
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+inline uInt32 TIASound::output(Int16*& buffer, uInt32& samples, uInt32 steps,
+                               Int16 v0, Int16 v1)
+{
+  Int16 left = v0, right = v1;
+  if(myChannelMode != Hardware2Stereo)
+    left = right = v0 + v1;
+  bool stereo = myChannelMode != Hardware1;
+
+  // At the native rate every step is exactly one sample
+  if(myOutputFrequency == 31400 && myOutputCounter < 31400)
+  {
+    uInt32 n = BSPF_min(steps, samples);
+    samples -= n;
+    if(stereo)
+      for(uInt32 i = 0; i < n; ++i)
+      {
+        *(buffer++) = left;
+        *(buffer++) = right;
+      }
+    else
+      for(uInt32 i = 0; i < n; ++i)
+        *(buffer++) = left;
+    return n;
+  }
+
+  // At other rates the output is band-limited instead; the levels change
+  // at the start of the first step, myOutputCounter / 31400 of the way to
+  // the next sample
+  if(myOutputFrequency != 31400)
+  {
+    bool split = myChannelMode == Hardware2Stereo;
+    uInt32 phase = (myOutputCounter * BlepSynth::PHASES) / 31400;
+    myBlep[0].setLevel(phase, left);
+    if(split)
+      myBlep[1].setLevel(phase, right);
+
+    uInt32 step = 0;
+    while((samples > 0) && (step < steps))
+    {
+      ++step;
+      myOutputCounter += myOutputFrequency;
+      while((samples > 0) && (myOutputCounter >= 31400))
+      {
+        Int16 sample = myBlep[0].read();
+        *(buffer++) = sample;
+        if(stereo)
+          *(buffer++) = split ? myBlep[1].read() : sample;
+        myOutputCounter -= 31400;
+        samples--;
+      }
+    }
+    return step;
+  }
+
+  uInt32 step = 0;
+  while((samples > 0) && (step < steps))
+  {
+    ++step;
+    myOutputCounter += myOutputFrequency;
+    while((samples > 0) && (myOutputCounter >= 31400))
+    {
+      *(buffer++) = left;
+      if(stereo)
+        *(buffer++) = right;
+      myOutputCounter -= 31400;
+      samples--;
+    }
+  }
+  return step;
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void TIASound::process(Int16* buffer, uInt32 samples)
 {
   // Make temporary local copy
-  uInt8 audc0 = myAUDC[0], audc1 = myAUDC[1];
-  uInt8 p5_0 = myP5[0], p5_1 = myP5[1];
   uInt8 div_n_cnt0 = myDivNCnt[0], div_n_cnt1 = myDivNCnt[1];
   Int16 v0 = myVolume[0], v1 = myVolume[1];
 
@@ -190,9 +307,41 @@ void TIASound::process(Int16* buffer, uInt32 samples)
   Int16 audv0 = (myAUDV[0] * myVolumePercentage) / 100,
         audv1 = (myAUDV[1] * myVolumePercentage) / 100;
 
+  // Band-limited output may still be owed samples from the last step, and
+  // each step has to start before the next sample
+  if(myOutputFrequency != 31400)
+  {
+    while((samples > 0) && (myOutputCounter >= 31400))
+    {
+      Int16 sample = myBlep[0].read();
+      *(buffer++) = sample;
+      if(myChannelMode != Hardware1)
+        *(buffer++) = myChannelMode == Hardware2Stereo ? myBlep[1].read() : sample;
+      myOutputCounter -= 31400;
+      samples--;
+    }
+  }
+
   // Loop until the sample buffer is full
   while(samples > 0)
   {
+    // The output can only change when a divide by n counter is at 1, so
+    // until then the counters just count down while the same output is
+    // repeated (forever when both channels are volume only)
+    uInt32 steps = ~0u;
+    if(div_n_cnt0 > 0)
+      steps = div_n_cnt0 - 1;
+    if(div_n_cnt1 > 0)
+      steps = BSPF_min(steps, (uInt32)(div_n_cnt1 - 1));
+
+    if(steps > 0)
+    {
+      steps = output(buffer, samples, steps, v0, v1);
+      if(div_n_cnt0 > 0) div_n_cnt0 -= steps;
+      if(div_n_cnt1 > 0) div_n_cnt1 -= steps;
+      continue;
+    }
+
     // Process channel 0
     if (div_n_cnt0 > 1)
     {
@@ -200,70 +349,8 @@ void TIASound::process(Int16* buffer, uInt32 samples)
     }
     else if (div_n_cnt0 == 1)
     {
-      int prev_bit5 = Bit5[p5_0];
       div_n_cnt0 = myDivNMax[0];
-
-      // The P5 counter has multiple uses, so we increment it here
-      p5_0++;
-      if (p5_0 == POLY5_SIZE)
-        p5_0 = 0;
-
-      // Check clock modifier for clock tick
-      if ((audc0 & 0x02) == 0 ||
-         ((audc0 & 0x01) == 0 && Div31[p5_0]) ||
-         ((audc0 & 0x01) == 1 && Bit5[p5_0]) ||
-         ((audc0 & 0x0f) == POLY5_DIV3 && Bit5[p5_0] != prev_bit5))
-      {
-        if (audc0 & 0x04)       // Pure modified clock selected
-        {
-          if ((audc0 & 0x0f) == POLY5_DIV3) // POLY5 -> DIV3 mode
-          {
-            if ( Bit5[p5_0] != prev_bit5 )
-            {
-              myDiv3Cnt[0]--;
-              if ( !myDiv3Cnt[0] )
-              {
-                myDiv3Cnt[0] = 3;
-                v0 = v0 ? 0 : audv0;
-              }
-            }
-          }
-          else
-          {
-            // If the output was set turn it off, else turn it on
-            v0 = v0 ? 0 : audv0;
-          }
-        }
-        else if (audc0 & 0x08)  // Check for p5/p9
-        {
-          if (audc0 == POLY9)   // Check for poly9
-          {
-            // Increase the poly9 counter
-            myP9[0]++;
-            if (myP9[0] == POLY9_SIZE)
-              myP9[0] = 0;
-
-            v0 = Bit9[myP9[0]] ? audv0 : 0;
-          }
-          else if ( audc0 & 0x02 )
-          {
-            v0 = (v0 || audc0 & 0x01) ? 0 : audv0;
-          }
-          else  // Must be poly5
-          {
-            v0 = Bit5[p5_0] ? audv0 : 0;
-          }
-        }
-        else  // Poly4 is the only remaining option
-        {
-          // Increase the poly4 counter
-          myP4[0]++;
-          if (myP4[0] == POLY4_SIZE)
-            myP4[0] = 0;
-
-          v0 = Bit4[myP4[0]] ? audv0 : 0;
-        }
-      }
+      v0 = clockChannel(0, v0, audv0);
     }
 
     // Process channel 1
@@ -273,116 +360,167 @@ void TIASound::process(Int16* buffer, uInt32 samples)
     }
     else if (div_n_cnt1 == 1)
     {
-      int prev_bit5 = Bit5[p5_1];
-
       div_n_cnt1 = myDivNMax[1];
+      v1 = clockChannel(1, v1, audv1);
+    }
 
-      // The P5 counter has multiple uses, so we increment it here
-      p5_1++;
-      if (p5_1 == POLY5_SIZE)
-        p5_1 = 0;
+    output(buffer, samples, 1, v0, v1);
+  }
 
-      // Check clock modifier for clock tick
-      if ((audc1 & 0x02) == 0 ||
-         ((audc1 & 0x01) == 0 && Div31[p5_1]) ||
-         ((audc1 & 0x01) == 1 && Bit5[p5_1]) ||
-         ((audc1 & 0x0f) == POLY5_DIV3 && Bit5[p5_1] != prev_bit5))
+  // Save for next round
+  myVolume[0] = v0;
+  myVolume[1] = v1;
+  myDivNCnt[0] = div_n_cnt0;
+  myDivNCnt[1] = div_n_cnt1;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void TIASound::skip(uInt32 samples)
+{
+  // Take external volume into account
+  Int16 audv[2];
+  audv[0] = (myAUDV[0] * myVolumePercentage) / 100;
+  audv[1] = (myAUDV[1] * myVolumePercentage) / 100;
+
+  for(int chan = 0; chan < 2; ++chan)
+  {
+    // A volume only channel is never clocked, others are first clocked
+    // when the divide by n counter gets to 1 and then every n samples
+    uInt32 cnt = myDivNCnt[chan];
+    if(cnt == 0)
+      continue;
+    if(samples < cnt)
+    {
+      myDivNCnt[chan] = cnt - samples;
+      continue;
+    }
+
+    uInt32 max = myDivNMax[chan];
+    myDivNCnt[chan] = max - (samples - cnt) % max;
+    skipChannel(chan, (samples - cnt) / max + 1, audv[chan]);
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void TIASound::skipChannel(int chan, uInt32 ticks, Int16 audv)
+{
+  Int16 v = myVolume[chan];
+  uInt8 audc = myAUDC[chan];
+
+  // Whole P5 cycles clock the output a fixed number of times, no matter
+  // which position they start at
+  uInt32 actions = (ticks / POLY5_SIZE) * myClockCount[audc];
+  if(actions > 0)
+  {
+    switch(myClockKind[audc])
+    {
+      case TOGGLE:
+        // After the first toggle only whether the rest are odd matters
+        v = v ? 0 : audv;
+        if(!(actions & 1))
+          v = v ? 0 : audv;
+        break;
+
+      case DIV3:
       {
-        if (audc1 & 0x04)       // Pure modified clock selected
+        uInt32 cnt = myDiv3Cnt[chan];
+        if(actions < cnt)
+          myDiv3Cnt[chan] = cnt - actions;
+        else
         {
-          if ((audc1 & 0x0f) == POLY5_DIV3)   // POLY5 -> DIV3 mode
-          {
-            if ( Bit5[p5_1] != prev_bit5 )
-            {
-              myDiv3Cnt[1]--;
-              if ( ! myDiv3Cnt[1] )
-              {
-                myDiv3Cnt[1] = 3;
-                v1 = v1 ? 0 : audv1;
-              }
-            }
-          }
-          else
-          {
-            // If the output was set turn it off, else turn it on
-            v1 = v1 ? 0 : audv1;
-          }
+          myDiv3Cnt[chan] = 3 - (actions - cnt) % 3;
+          v = v ? 0 : audv;
+          if(!(((actions - cnt) / 3) & 1))
+            break;
+          v = v ? 0 : audv;
         }
-        else if (audc1 & 0x08)  // Check for p5/p9
-        {
-          if (audc1 == POLY9)   // Check for poly9
-          {
-            // Increase the poly9 counter
-            myP9[1]++;
-            if (myP9[1] == POLY9_SIZE)
-              myP9[1] = 0;
+        break;
+      }
 
-            v1 = Bit9[myP9[1]] ? audv1 : 0;
-          }
-          else if ( audc1 & 0x02 )
-          {
-            v1 = (v1 || audc1 & 0x01) ? 0 : audv1;
-          }
-          else  // Must be poly5
-          {
-            v1 = Bit5[p5_1] ? audv1 : 0;
-          }
-        }
-        else  // Poly4 is the only remaining option
-        {
-          // Increase the poly4 counter
-          myP4[1]++;
-          if (myP4[1] == POLY4_SIZE)
-            myP4[1] = 0;
+      case SET_POLY4:
+        myP4[chan] = (myP4[chan] + actions) % POLY4_SIZE;
+        v = Bit4[myP4[chan]] ? audv : 0;
+        break;
 
-          v1 = Bit4[myP4[1]] ? audv1 : 0;
-        }
+      case SET_POLY5:
+      {
+        // The P5 counter is back where it started, so the output was last
+        // set at the last position before that which is clocked
+        uInt8 p5 = myP5[chan];
+        while(myClockAction[audc][p5] == NO_CLOCK)
+          p5 = p5 == 0 ? POLY5_SIZE - 1 : p5 - 1;
+        v = Bit5[p5] ? audv : 0;
+        break;
       }
+
+      case SET_POLY9:
+        myP9[chan] = (myP9[chan] + actions) % POLY9_SIZE;
+        v = Bit9[myP9[chan]] ? audv : 0;
+        break;
+
+      case SET_TO_0:
+        v = 0;
+        break;
     }
+  }
 
-    myOutputCounter += myOutputFrequency;
+  // The rest of a P5 cycle is clocked as usual
+  for(uInt32 i = ticks % POLY5_SIZE; i > 0; --i)
+    v = clockChannel(chan, v, audv);
+
+  myVolume[chan] = v;
+}
 
-    switch(myChannelMode)
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void TIASound::clockActionInit()
+{
+  for(int audc = 0; audc < 16; ++audc)
+  {
+    myClockKind[audc] = NO_CLOCK;
+    myClockCount[audc] = 0;
+
+    for(int p5 = 0; p5 < POLY5_SIZE; ++p5)
     {
-      case Hardware2Mono:  // mono sampling with 2 hardware channels
-        while((samples > 0) && (myOutputCounter >= 31400))
-        {
-          Int16 byte = v0 + v1;
-          *(buffer++) = byte;
-          *(buffer++) = byte;
-          myOutputCounter -= 31400;
-          samples--;
-        }
-        break;
+      int prev_bit5 = Bit5[p5 == 0 ? POLY5_SIZE - 1 : p5 - 1];
+      uInt8 action = NO_CLOCK;
 
-      case Hardware2Stereo:  // stereo sampling with 2 hardware channels
-        while((samples > 0) && (myOutputCounter >= 31400))
+      // Check clock modifier for clock tick
+      if ((audc & 0x02) == 0 ||
+         ((audc & 0x01) == 0 && Div31[p5]) ||
+         ((audc & 0x01) == 1 && Bit5[p5]) ||
+         (audc == POLY5_DIV3 && Bit5[p5] != prev_bit5))
+      {
+        if (audc & 0x04)       // Pure modified clock selected
         {
-          *(buffer++) = v0;
-          *(buffer++) = v1;
-          myOutputCounter -= 31400;
-          samples--;
+          if (audc == POLY5_DIV3) // POLY5 -> DIV3 mode
+          {
+            if (Bit5[p5] != prev_bit5)
+              action = DIV3;
+          }
+          else
+            action = TOGGLE;
         }
-        break;
-
-      case Hardware1:  // mono/stereo sampling with only 1 hardware channel
-        while((samples > 0) && (myOutputCounter >= 31400))
+        else if (audc & 0x08)  // Check for p5/p9
         {
-          *(buffer++) = v0 + v1;
-          myOutputCounter -= 31400;
-          samples--;
+          if (audc == POLY9)   // Check for poly9
+            action = SET_POLY9;
+          else if (audc & 0x02)
+            action = (audc & 0x01) ? SET_TO_0 : TOGGLE;
+          else  // Must be poly5
+            action = SET_POLY5;
         }
-        break;
+        else  // Poly4 is the only remaining option
+          action = SET_POLY4;
+      }
+      myClockAction[audc][p5] = action;
+
+      if(action != NO_CLOCK)
+      {
+        myClockKind[audc] = action;
+        myClockCount[audc]++;
+      }
     }
   }
-
-  // Save for next round
-  myP5[0] = p5_0;
-  myP5[1] = p5_1;
-  myVolume[0] = v0;
-  myVolume[1] = v1;
-  myDivNCnt[0] = div_n_cnt0;
-  myDivNCnt[1] = div_n_cnt1;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
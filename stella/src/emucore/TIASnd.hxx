@@ -21,13 +21,15 @@
 #define TIASOUND_HXX
 
 #include "bspf.hxx"
+#include "BlepSynth.hxx"
 
 /**
   This class implements a fairly accurate emulation of the TIA sound
   hardware.  This class uses code/ideas from z26 and MESS.
 
   Currently, the sound generation routines work at 31400Hz only.
-  Resampling can be done by passing in a different output frequency.
+  Resampling can be done by passing in a different output frequency, in
+  which case the output is band-limited (see BlepSynth).
 
   @author  Bradford W. Mott, Stephen Anthony, z26 and MESS teams
   @version $Id: TIASnd.hxx 2838 2014-01-17 23:34:03Z stephena $
@@ -94,6 +96,15 @@ class TIASound
     */
     void process(Int16* buffer, uInt32 samples);
 
+    /**
+      Advance the sound emulation by the given number of samples (at the
+      native 31400Hz) without generating them.  This leaves the sound in
+      the same state process() would, at a small fraction of its cost.
+
+      @param samples The number of samples to skip
+    */
+    void skip(uInt32 samples);
+
     /**
       Set the volume of the samples created (0-100)
     */
@@ -102,6 +113,50 @@ class TIASound
   private:
     void polyInit(uInt8* poly, int size, int f0, int f1);
 
+    /**
+      Fill in the clock action table (see myClockAction) from the
+      polynomials, which must be initialized first
+    */
+    void clockActionInit();
+
+    /**
+      Clock the divide by n counter output of the given channel into its
+      P5 counter and, depending on AUDCx, the output generator
+
+      @param chan  The channel to clock
+      @param v     The current output volume of the channel
+      @param audv  The volume the channel outputs when its output bit is set
+
+      @return  The new output volume of the channel
+    */
+    inline Int16 clockChannel(int chan, Int16 v, Int16 audv);
+
+    /**
+      Clock the divide by n counter output of the given channel into its
+      P5 counter the given number of times, like clockChannel() does but
+      without going through each whole P5 cycle
+
+      @param chan   The channel to clock
+      @param ticks  The number of times to clock it
+      @param audv   The volume the channel outputs when its output bit is set
+    */
+    void skipChannel(int chan, uInt32 ticks, Int16 audv);
+
+    /**
+      Output the given channel volumes for up to the given number of
+      steps of the 31400Hz sound clock, or until the buffer is full
+
+      @param buffer   The location to store samples at, which is advanced
+      @param samples  The room left in the buffer, which is decremented
+      @param steps    The number of sound clock steps
+      @param v0       The volume output by channel 0
+      @param v1       The volume output by channel 1
+
+      @return  The number of steps taken
+    */
+    inline uInt32 output(Int16*& buffer, uInt32& samples, uInt32 steps,
+                         Int16 v0, Int16 v1);
+
   private:
     // Definitions for AUDCx (15, 16)
     enum AUDCxRegister
@@ -133,6 +188,18 @@ class TIASound
                           // then another 8 for 16-bit sound
     };
 
+    // What clocking a channel's P5 counter does to its output generator;
+    // this depends only on AUDCx and the new (and previous) P5 bit
+    enum ClockAction {
+      NO_CLOCK,   // the clock modifier suppresses the clock
+      TOGGLE,     // pure tone, the output is inverted
+      DIV3,       // POLY5 -> DIV3 mode, every third clock toggles
+      SET_POLY4,  // the output follows the 4-bit POLY
+      SET_POLY5,  // the output follows the 5-bit POLY
+      SET_POLY9,  // the output follows the 9-bit POLY
+      SET_TO_0    // the output is turned off
+    };
+
     enum ChannelMode {
       Hardware2Mono,    // mono sampling with 2 hardware channels
       Hardware2Stereo,  // stereo sampling with 2 hardware channels
@@ -160,6 +227,9 @@ class TIASound
     Int32  myOutputCounter;
     uInt32 myVolumePercentage;
 
+    // Synthesizers for the left and right output when resampling
+    BlepSynth myBlep[2];
+
     /*
       Initialize the bit patterns for the polynomials (at runtime).
 
@@ -179,6 +249,21 @@ class TIASound
       implemented by using counters.
     */
     static const uInt8 Div31[POLY5_SIZE];
+
+    /*
+      The ClockAction of each AUDCx mode for each position of the P5
+      counter (after it was clocked).  Looking these up replaces testing
+      the AUDCx bits every time a channel is clocked.
+    */
+    uInt8 myClockAction[16][POLY5_SIZE];
+
+    /*
+      The one ClockAction other than NO_CLOCK each AUDCx mode has, and
+      how many of the P5 positions have it.  Every position is clocked once
+      per P5 cycle, so this is how far a whole cycle advances the output.
+    */
+    uInt8 myClockKind[16];
+    uInt8 myClockCount[16];
 };
 
 #endif
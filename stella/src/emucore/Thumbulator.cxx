@@ -36,6 +36,20 @@ using namespace Common;
 //#define THUMB_DISS
 //#define THUMB_DBUG
 
+// Uncomment the following (or build with THUMB_INSTRUMENT=1) to count
+// memory accesses, and to check the processor mode on register accesses;
+// by default only the direct paths used by DPC+ code are compiled in
+//#define THUMB_INSTRUMENT
+
+#if defined(THUMB_DISS) || defined(THUMB_DBUG)
+  #define THUMB_INSTRUMENT
+#endif
+
+#if defined(THUMB_INSTRUMENT)
+  #define DO_STAT(statement) statement
+#else
+  #define DO_STAT(statement)
+#endif
 #if defined(THUMB_DISS)
   #define DO_DISS(statement) statement
 #else
@@ -47,17 +61,31 @@ using namespace Common;
   #define DO_DBUG(statement)
 #endif
 
+// Halfwords are stored in little-endian order
+#ifdef __BIG_ENDIAN__
+  #define GET16(mem, index) ((((mem)[index]>>8)|((mem)[index]<<8))&0xffff)
+  #define PUT16(mem, index, data) \
+    (mem)[index]=((((data)&0xFFFF)>>8)|(((data)&0xffff)<<8))&0xffff
+#else
+  #define GET16(mem, index) ((mem)[index])
+  #define PUT16(mem, index, data) (mem)[index]=(data)&0xFFFF
+#endif
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Thumbulator::Thumbulator(const uInt16* rom_ptr, uInt16* ram_ptr, bool traponfatal)
   : rom(rom_ptr),
     ram(ram_ptr)
 {
+  decodeCache = new Decoded[ROMSIZE/2];
+  memset(decodeCache, 0, (ROMSIZE/2) * sizeof(Decoded));
+
   trapFatalErrors(traponfatal);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Thumbulator::~Thumbulator()
 {
+  delete[] decodeCache;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -66,7 +94,7 @@ string Thumbulator::run( void )
   reset();
   for(;;)
   {
-    if (execute()) break;
+    if (execute_trace()) break;
     if (instructions > 500000) // way more than would otherwise be possible
       throw "instructions > 500000";
   }
@@ -77,6 +105,17 @@ string Thumbulator::run( void )
   return statusMsg.str();
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Thumbulator::Stats Thumbulator::stats() const
+{
+  Stats s;
+  s.instructions = (uInt32)instructions;
+  s.reads = armreads;
+  s.writes = armwrites;
+  s.cycles = armcycles;
+  return s;
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 inline int Thumbulator::fatalError(const char* opcode, uInt32 v1, const char* msg)
 {
@@ -103,12 +142,14 @@ inline int Thumbulator::fatalError(const char* opcode, uInt32 v1, uInt32 v2,
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Thumbulator::dump_counters ( void )
 {
+#if defined(THUMB_INSTRUMENT)
   cout << endl << endl
        << "instructions " << instructions << endl
        << "fetches      " << fetches << endl
        << "reads        " << reads << endl
        << "writes       " << writes << endl
        << "memcycles    " << (fetches+reads+writes) << endl;
+#endif
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -116,20 +157,20 @@ void Thumbulator::dump_regs( void )
 {
   for (int cnt = 1; cnt < 14; cnt++)
   {
-    statusMsg << "R" << cnt << " = " << Base::HEX8 << reg_sys[cnt-1] << "  ";
+    statusMsg << "R" << cnt << " = " << Base::HEX8 << reg_norm[cnt-1] << "  ";
     if(cnt % 4 == 0) statusMsg << endl;
   }
   statusMsg << endl
-            << "SP = " << Base::HEX8 << reg_svc[13] << "  "
-            << "LR = " << Base::HEX8 << reg_svc[14] << "  "
-            << "PC = " << Base::HEX8 << reg_sys[15] << "  "
+            << "SP = " << Base::HEX8 << reg_norm[13] << "  "
+            << "LR = " << Base::HEX8 << reg_norm[14] << "  "
+            << "PC = " << Base::HEX8 << reg_norm[15] << "  "
             << endl;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 uInt32 Thumbulator::fetch16 ( uInt32 addr )
 {
-  fetches++;
+  DO_STAT(fetches++);
 
   uInt32 data;
   switch(addr&0xF0000000)
@@ -191,6 +232,15 @@ uInt32 Thumbulator::fetch32 ( uInt32 addr )
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Thumbulator::write16 ( uInt32 addr, uInt32 data )
 {
+#if !defined(THUMB_INSTRUMENT)
+  // Aligned writes to RAM outside the bankswitch code area
+  if(((addr&0xFFFFE001)==0x40000000) && ((addr>=0x40000c00)||(addr<=0x40000028)))
+  {
+    PUT16(ram,(addr&RAMADDMASK)>>1,data);
+    return;
+  }
+#endif
+
   if((addr>0x40001fff)&&(addr<0x50000000))
     fatalError("write16", addr, "abort - out of range");
   else if((addr>0x40000028)&&(addr<0x40000c00))
@@ -198,7 +248,7 @@ void Thumbulator::write16 ( uInt32 addr, uInt32 data )
   if(addr&1)
     fatalError("write16", addr, "abort - misaligned");
 
-  writes++;
+  DO_STAT(writes++);
 
   DO_DBUG(statusMsg << "write16(" << Base::HEX8 << addr << "," << Base::HEX8 << data << ")" << endl);
 
@@ -228,6 +278,17 @@ void Thumbulator::write16 ( uInt32 addr, uInt32 data )
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Thumbulator::write32 ( uInt32 addr, uInt32 data )
 {
+#if !defined(THUMB_INSTRUMENT)
+  // Aligned writes to RAM outside the bankswitch code area
+  if(((addr&0xFFFFE003)==0x40000000) && ((addr>=0x40000c00)||(addr<=0x40000024)))
+  {
+    addr=(addr&RAMADDMASK)>>1;
+    PUT16(ram,addr,data);
+    PUT16(ram,addr+1,data>>16);
+    return;
+  }
+#endif
+
   if(addr&3)
     fatalError("write32", addr, "abort - misaligned");
 
@@ -264,6 +325,14 @@ void Thumbulator::write32 ( uInt32 addr, uInt32 data )
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 uInt32 Thumbulator::read16 ( uInt32 addr )
 {
+#if !defined(THUMB_INSTRUMENT)
+  // Aligned reads from ROM or RAM
+  if((addr&0xFFFF8001)==0x00000000)
+    return GET16(rom,addr>>1);
+  else if((addr&0xFFFFE001)==0x40000000)
+    return GET16(ram,(addr&RAMADDMASK)>>1);
+#endif
+
   uInt32 data;
 
   if((addr>0x40001fff)&&(addr<0x50000000))
@@ -273,7 +342,7 @@ uInt32 Thumbulator::read16 ( uInt32 addr )
   if(addr&1)
     fatalError("read16", addr, "abort - misaligned");
 
-  reads++;
+  DO_STAT(reads++);
 
   switch(addr&0xF0000000)
   {
@@ -312,6 +381,20 @@ uInt32 Thumbulator::read16 ( uInt32 addr )
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 uInt32 Thumbulator::read32 ( uInt32 addr )
 {
+#if !defined(THUMB_INSTRUMENT)
+  // Aligned reads from ROM or RAM
+  if((addr&0xFFFF8003)==0x00000000)
+  {
+    addr>>=1;
+    return (GET16(rom,addr+1)<<16)|GET16(rom,addr);
+  }
+  else if((addr&0xFFFFE003)==0x40000000)
+  {
+    addr=(addr&RAMADDMASK)>>1;
+    return (GET16(ram,addr+1)<<16)|GET16(ram,addr);
+  }
+#endif
+
   if(addr&3)
     fatalError("read32", addr, "abort - misaligned");
 
@@ -334,19 +417,12 @@ uInt32 Thumbulator::read_register ( uInt32 reg )
 {
   reg&=0xF;
 
-  uInt32 data;
-  switch(cpsr&0x1F)
-  {
-    case MODE_SVC:
-      switch(reg) // TODO (SA) - does this do anything other than default?
-      {
-        default: data=reg_sys[reg]; break;
-        case 13: case 14: data=reg_svc[reg]; break;
-      }
-      DO_DBUG(statusMsg << "read_register(" << dec << reg << ")=" << Base::HEX8 << data << endl);
-      return(data);
-  }
-  return fatalError("read_register", cpsr, "invalid cpsr mode");
+#if defined(THUMB_INSTRUMENT)
+  if((cpsr&0x1F)!=MODE_SVC)
+    return fatalError("read_register", cpsr, "invalid cpsr mode");
+  DO_DBUG(statusMsg << "read_register(" << dec << reg << ")=" << Base::HEX8 << reg_norm[reg] << endl);
+#endif
+  return reg_norm[reg];
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -354,143 +430,102 @@ uInt32 Thumbulator::write_register ( uInt32 reg, uInt32 data )
 {
   reg&=0xF;
 
+#if defined(THUMB_INSTRUMENT)
   DO_DBUG(statusMsg << "write_register(" << dec << reg << "," << Base::HEX8 << data << ")" << endl);
-  switch(cpsr&0x1F)
-  {
-    case MODE_SVC:
-      switch(reg) // TODO (SA) - does this do anything other than default?
-      {
-        default: reg_sys[reg]=data; break;
-        case 13: case 14: reg_svc[reg]=data; break;
-      }
-      return(data);
-  }
-  return fatalError("write_register", cpsr, "invalid cpsr mode");
+  if((cpsr&0x1F)!=MODE_SVC)
+    return fatalError("write_register", cpsr, "invalid cpsr mode");
+#endif
+  return reg_norm[reg]=data;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-void Thumbulator::do_zflag ( uInt32 x )
+// The flags are evaluated lazily: each of these only records the values
+// the flag depends on, and the flag itself is computed when it's read
+inline void Thumbulator::do_nzflag ( uInt32 x )
 {
-  if(x==0) cpsr|=CPSR_Z;
-  else     cpsr&=~CPSR_Z;
+  nzValue=x;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-void Thumbulator::do_nflag ( uInt32 x )
+inline void Thumbulator::do_cflag ( uInt32 a, uInt32 b, uInt32 c )
 {
-  if(x&0x80000000) cpsr|=CPSR_N;
-  else             cpsr&=~CPSR_N;
+  cflagA=a;
+  cflagB=b;
+  cflagIn=c;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-void Thumbulator::do_cflag ( uInt32 a, uInt32 b, uInt32 c )
+inline void Thumbulator::do_sub_vflag ( uInt32 a, uInt32 b, uInt32 c )
 {
-  uInt32 rc;
-
-  cpsr&=~CPSR_C;
-  rc=(a&0x7FFFFFFF)+(b&0x7FFFFFFF)+c; //carry in
-  rc = (rc>>31)+(a>>31)+(b>>31);  //carry out
-  if(rc&2)
-    cpsr|=CPSR_C;
+  // a-b overflows exactly when a+~b does
+  vflagA=a;
+  vflagB=~b;
+  vflagResult=c;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-void Thumbulator::do_sub_vflag ( uInt32 a, uInt32 b, uInt32 c )
+inline void Thumbulator::do_add_vflag ( uInt32 a, uInt32 b, uInt32 c )
 {
-  cpsr&=~CPSR_V;
-
-  //if the sign bits are different
-  if((a&0x80000000)^(b&0x80000000))
-  {
-    //and result matches b
-    if((b&0x80000000)==(c&0x80000000))
-      cpsr|=CPSR_V;
-  }
+  vflagA=a;
+  vflagB=b;
+  vflagResult=c;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-void Thumbulator::do_add_vflag ( uInt32 a, uInt32 b, uInt32 c )
+inline void Thumbulator::do_cflag_bit ( uInt32 x )
 {
-  cpsr&=~CPSR_V;
-
-  //if sign bits are the same
-  if((a&0x80000000)==(b&0x80000000))
-  {
-    //and the result is different
-    if((b&0x80000000)!=(c&0x80000000))
-      cpsr|=CPSR_V;
-  }
+  // 0xFFFFFFFF + 0 + x carries out exactly when x is set
+  cflagA=0xFFFFFFFF;
+  cflagB=0;
+  cflagIn=x ? 1 : 0;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-void Thumbulator::do_cflag_bit ( uInt32 x )
+inline void Thumbulator::do_vflag_bit ( uInt32 x )
 {
-  if(x) cpsr|=CPSR_C;
-  else  cpsr&=~CPSR_C;
+  vflagA=vflagB=0;
+  vflagResult=x ? 0x80000000 : 0;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-void Thumbulator::do_vflag_bit ( uInt32 x )
+uInt32 Thumbulator::read_cpsr ( void ) const
 {
-  if(x) cpsr|=CPSR_V;
-  else  cpsr&=~CPSR_V;
+  uInt32 flags=0;
+  if(flagN()) flags|=CPSR_N;
+  if(flagZ()) flags|=CPSR_Z;
+  if(flagC()) flags|=CPSR_C;
+  if(flagV()) flags|=CPSR_V;
+
+  return (cpsr&~(CPSR_N|CPSR_Z|CPSR_C|CPSR_V))|flags;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-int Thumbulator::execute ( void )
+void Thumbulator::decode ( uInt32 inst, Decoded& d )
 {
-  uInt32 pc, sp, inst,
-         ra,rb,rc,
-         rm,rd,rn,rs,
-         op;
-
-  pc=read_register(15);
-  inst=fetch16(pc-2);
-  pc+=2;
-  write_register(15,pc);
-  DO_DISS(statusMsg << Base::HEX8 << (pc-5) << ": " << Base::HEX4 << inst << " ");
-
-  instructions++;
+  d.rd=d.rn=d.rm=0;
+  d.inst=inst;
+  d.count=0;
+  d.imm=0;
 
   //ADC
   if((inst&0xFFC0)==0x4140)
   {
-    rd=(inst>>0)&0x07;
-    rm=(inst>>3)&0x07;
-    DO_DISS(statusMsg << "adc r" << dec << rd << ",r" << dec << rm << endl);
-    ra=read_register(rd);
-    rb=read_register(rm);
-    rc=ra+rb;
-    if(cpsr&CPSR_C)
-      rc++;
-    write_register(rd,rc);
-    do_nflag(rc);
-    do_zflag(rc);
-    if(cpsr&CPSR_C) do_cflag(ra,rb,1);
-    else            do_cflag(ra,rb,0);
-    do_add_vflag(ra,rb,rc);
-    return(0);
+    d.op=Op_adc;
+    d.rd=(inst>>0)&0x07;
+    d.rm=(inst>>3)&0x07;
+    return;
   }
 
   //ADD(1) small immediate two registers
   if((inst&0xFE00)==0x1C00)
   {
-    rd=(inst>>0)&0x7;
-    rn=(inst>>3)&0x7;
-    rb=(inst>>6)&0x7;
-    if(rb)
+    if((inst>>6)&0x7)
     {
-      DO_DISS(statusMsg << "adds r" << dec << rd << ",r" << dec << rn << ","
-                        << "#0x" << Base::HEX2 << rb << endl);
-      ra=read_register(rn);
-      rc=ra+rb;
-      //fprintf(stderr,"0x%08X = 0x%08X + 0x%08X\n",rc,ra,rb);
-      write_register(rd,rc);
-      do_nflag(rc);
-      do_zflag(rc);
-      do_cflag(ra,rb,0);
-      do_add_vflag(ra,rb,rc);
-      return(0);
+      d.op=Op_add1;
+      d.rd=(inst>>0)&0x7;
+      d.rn=(inst>>3)&0x7;
+      d.imm=(inst>>6)&0x7;
+      return;
     }
     else
     {
@@ -501,35 +536,20 @@ int Thumbulator::execute ( void )
   //ADD(2) big immediate one register
   if((inst&0xF800)==0x3000)
   {
-    rb=(inst>>0)&0xFF;
-    rd=(inst>>8)&0x7;
-    DO_DISS(statusMsg << "adds r" << dec << rd << ",#0x" << Base::HEX2 << rb << endl);
-    ra=read_register(rd);
-    rc=ra+rb;
-    write_register(rd,rc);
-    do_nflag(rc);
-    do_zflag(rc);
-    do_cflag(ra,rb,0);
-    do_add_vflag(ra,-rb,rc);
-    return(0);
+    d.op=Op_add2;
+    d.imm=(inst>>0)&0xFF;
+    d.rd=(inst>>8)&0x7;
+    return;
   }
 
   //ADD(3) three registers
   if((inst&0xFE00)==0x1800)
   {
-    rd=(inst>>0)&0x7;
-    rn=(inst>>3)&0x7;
-    rm=(inst>>6)&0x7;
-    DO_DISS(statusMsg << "adds r" << dec << rd << ",r" << dec << rn << ",r" << rm << endl);
-    ra=read_register(rn);
-    rb=read_register(rm);
-    rc=ra+rb;
-    write_register(rd,rc);
-    do_nflag(rc);
-    do_zflag(rc);
-    do_cflag(ra,rb,0);
-    do_add_vflag(ra,rb,rc);
-    return(0);
+    d.op=Op_add3;
+    d.rd=(inst>>0)&0x7;
+    d.rn=(inst>>3)&0x7;
+    d.rm=(inst>>6)&0x7;
+    return;
   }
 
   //ADD(4) two registers one or both high no flags
@@ -539,332 +559,111 @@ int Thumbulator::execute ( void )
     {
       //UNPREDICTABLE
     }
-    rd=(inst>>0)&0x7;
-    rd|=(inst>>4)&0x8;
-    rm=(inst>>3)&0xF;
-    DO_DISS(statusMsg << "add r" << dec << rd << ",r" << dec << rm << endl);
-    ra=read_register(rd);
-    rb=read_register(rm);
-    rc=ra+rb;
-    //fprintf(stderr,"0x%08X = 0x%08X + 0x%08X\n",rc,ra,rb);
-    write_register(rd,rc);
-    return(0);
+    d.op=Op_add4;
+    d.rd=(inst>>0)&0x7;
+    d.rd|=(inst>>4)&0x8;
+    d.rm=(inst>>3)&0xF;
+    return;
   }
 
   //ADD(5) rd = pc plus immediate
   if((inst&0xF800)==0xA000)
   {
-    rb=(inst>>0)&0xFF;
-    rd=(inst>>8)&0x7;
-    rb<<=2;
-    DO_DISS(statusMsg << "add r" << dec << rd << ",PC,#0x" << Base::HEX2 << rb << endl);
-    ra=read_register(15);
-    rc=(ra&(~3))+rb;
-    write_register(rd,rc);
-    return(0);
+    d.op=Op_add5;
+    d.imm=((inst>>0)&0xFF)<<2;
+    d.rd=(inst>>8)&0x7;
+    return;
   }
 
   //ADD(6) rd = sp plus immediate
   if((inst&0xF800)==0xA800)
   {
-    rb=(inst>>0)&0xFF;
-    rd=(inst>>8)&0x7;
-    rb<<=2;
-    DO_DISS(statusMsg << "add r" << dec << rd << ",SP,#0x" << Base::HEX2 << rb << endl);
-    ra=read_register(13);
-    rc=ra+rb;
-    write_register(rd,rc);
-    return(0);
+    d.op=Op_add6;
+    d.imm=((inst>>0)&0xFF)<<2;
+    d.rd=(inst>>8)&0x7;
+    return;
   }
 
   //ADD(7) sp plus immediate
   if((inst&0xFF80)==0xB000)
   {
-    rb=(inst>>0)&0x7F;
-    rb<<=2;
-    DO_DISS(statusMsg << "add SP,#0x" << Base::HEX2 << rb << endl);
-    ra=read_register(13);
-    rc=ra+rb;
-    write_register(13,rc);
-    return(0);
+    d.op=Op_add7;
+    d.imm=((inst>>0)&0x7F)<<2;
+    return;
   }
 
   //AND
   if((inst&0xFFC0)==0x4000)
   {
-    rd=(inst>>0)&0x7;
-    rm=(inst>>3)&0x7;
-    DO_DISS(statusMsg << "ands r" << dec << rd << ",r" << dec << rm << endl);
-    ra=read_register(rd);
-    rb=read_register(rm);
-    rc=ra&rb;
-    write_register(rd,rc);
-    do_nflag(rc);
-    do_zflag(rc);
-    return(0);
+    d.op=Op_and;
+    d.rd=(inst>>0)&0x7;
+    d.rm=(inst>>3)&0x7;
+    return;
   }
 
   //ASR(1) two register immediate
   if((inst&0xF800)==0x1000)
   {
-    rd=(inst>>0)&0x07;
-    rm=(inst>>3)&0x07;
-    rb=(inst>>6)&0x1F;
-    DO_DISS(statusMsg << "asrs r" << dec << rd << ",r" << dec << rm << ",#0x" << Base::HEX2 << rb << endl);
-    rc=read_register(rm);
-    if(rb==0)
-    {
-      if(rc&0x80000000)
-      {
-        do_cflag_bit(1);
-        rc=~0;
-      }
-      else
-      {
-        do_cflag_bit(0);
-        rc=0;
-      }
-    }
-    else
-    {
-      do_cflag_bit(rc&(1<<(rb-1)));
-      ra=rc&0x80000000;
-      rc>>=rb;
-      if(ra) //asr, sign is shifted in
-      {
-        rc|=(~0)<<(32-rb);
-      }
-    }
-    write_register(rd,rc);
-    do_nflag(rc);
-    do_zflag(rc);
-    return(0);
+    d.op=Op_asr1;
+    d.rd=(inst>>0)&0x07;
+    d.rm=(inst>>3)&0x07;
+    d.imm=(inst>>6)&0x1F;
+    return;
   }
 
   //ASR(2) two register
   if((inst&0xFFC0)==0x4100)
   {
-    rd=(inst>>0)&0x07;
-    rs=(inst>>3)&0x07;
-    DO_DISS(statusMsg << "asrs r" << dec << rd << ",r" << dec << rs << endl);
-    rc=read_register(rd);
-    rb=read_register(rs);
-    rb&=0xFF;
-    if(rb==0)
-    {
-    }
-    else if(rb<32)
-    {
-      do_cflag_bit(rc&(1<<(rb-1)));
-      ra=rc&0x80000000;
-      rc>>=rb;
-      if(ra) //asr, sign is shifted in
-      {
-        rc|=(~0)<<(32-rb);
-      }
-    }
-    else
-    {
-      if(rc&0x80000000)
-      {
-        do_cflag_bit(1);
-        rc=(~0);
-      }
-      else
-      {
-        do_cflag_bit(0);
-        rc=0;
-      }
-    }
-    write_register(rd,rc);
-    do_nflag(rc);
-    do_zflag(rc);
-    return(0);
+    d.op=Op_asr2;
+    d.rd=(inst>>0)&0x07;
+    d.rn=(inst>>3)&0x07;
+    return;
   }
 
   //B(1) conditional branch
   if((inst&0xF000)==0xD000)
   {
-    rb=(inst>>0)&0xFF;
-    if(rb&0x80)
-      rb|=(~0)<<8;
-    op=(inst>>8)&0xF;
-    rb<<=1;
-    rb+=pc;
-    rb+=2;
-    switch(op)
+    if(((inst>>8)&0xF)<0xE)
     {
-      case 0x0: //b eq  z set
-        DO_DISS(statusMsg << "beq 0x" << Base::HEX8 << (rb-3) << endl);
-        if(cpsr&CPSR_Z)
-        {
-          write_register(15,rb);
-        }
-        return(0);
-
-      case 0x1: //b ne  z clear
-        DO_DISS(statusMsg << "bne 0x" << Base::HEX8 << (rb-3) << endl);
-        if(!(cpsr&CPSR_Z))
-        {
-          write_register(15,rb);
-        }
-        return(0);
-
-      case 0x2: //b cs c set
-        DO_DISS(statusMsg << "bcs 0x" << Base::HEX8 << (rb-3) << endl);
-        if(cpsr&CPSR_C)
-        {
-          write_register(15,rb);
-        }
-        return(0);
-
-      case 0x3: //b cc c clear
-        DO_DISS(statusMsg << "bcc 0x" << Base::HEX8 << (rb-3) << endl);
-        if(!(cpsr&CPSR_C))
-        {
-          write_register(15,rb);
-        }
-        return(0);
-
-      case 0x4: //b mi n set
-        DO_DISS(statusMsg << "bmi 0x" << Base::HEX8 << (rb-3) << endl);
-        if(cpsr&CPSR_N)
-        {
-          write_register(15,rb);
-        }
-        return(0);
-
-      case 0x5: //b pl n clear
-        DO_DISS(statusMsg << "bpl 0x" << Base::HEX8 << (rb-3) << endl);
-        if(!(cpsr&CPSR_N))
-        {
-          write_register(15,rb);
-        }
-        return(0);
-
-      case 0x6: //b vs v set
-        DO_DISS(statusMsg << "bvs 0x" << Base::HEX8 << (rb-3) << endl);
-        if(cpsr&CPSR_V)
-        {
-          write_register(15,rb);
-        }
-        return(0);
-
-      case 0x7: //b vc v clear
-        DO_DISS(statusMsg << "bvc 0x" << Base::HEX8 << (rb-3) << endl);
-        if(!(cpsr&CPSR_V))
-        {
-          write_register(15,rb);
-        }
-        return(0);
-
-      case 0x8: //b hi c set z clear
-        DO_DISS(statusMsg << "bhi 0x" << Base::HEX8 << (rb-3) << endl);
-        if((cpsr&CPSR_C)&&(!(cpsr&CPSR_Z)))
-        {
-          write_register(15,rb);
-        }
-        return(0);
-
-      case 0x9: //b ls c clear or z set
-        DO_DISS(statusMsg << "bls 0x" << Base::HEX8 << (rb-3) << endl);
-        if((cpsr&CPSR_Z)||(!(cpsr&CPSR_C)))
-        {
-          write_register(15,rb);
-        }
-        return(0);
-
-      case 0xA: //b ge N == V
-        DO_DISS(statusMsg << "bge 0x" << Base::HEX8 << (rb-3) << endl);
-        ra=0;
-        if(  (cpsr&CPSR_N) &&  (cpsr&CPSR_V) ) ra++;
-        if((!(cpsr&CPSR_N))&&(!(cpsr&CPSR_V))) ra++;
-        if(ra)
-        {
-          write_register(15,rb);
-        }
-        return(0);
-
-      case 0xB: //b lt N != V
-        DO_DISS(statusMsg << "blt 0x" << Base::HEX8 << (rb-3) << endl);
-        ra=0;
-        if((!(cpsr&CPSR_N))&&(cpsr&CPSR_V)) ra++;
-        if((!(cpsr&CPSR_V))&&(cpsr&CPSR_N)) ra++;
-        if(ra)
-        {
-          write_register(15,rb);
-        }
-        return(0);
-
-      case 0xC: //b gt Z==0 and N == V
-        DO_DISS(statusMsg << "bgt 0x" << Base::HEX8 << (rb-3) << endl);
-        ra=0;
-        if(  (cpsr&CPSR_N) &&  (cpsr&CPSR_V) ) ra++;
-        if((!(cpsr&CPSR_N))&&(!(cpsr&CPSR_V))) ra++;
-        if(cpsr&CPSR_Z) ra=0;
-        if(ra)
-        {
-          write_register(15,rb);
-        }
-        return(0);
-
-      case 0xD: //b le Z==1 or N != V
-        DO_DISS(statusMsg << "ble 0x" << Base::HEX8 << (rb-3) << endl);
-        ra=0;
-        if((!(cpsr&CPSR_N))&&(cpsr&CPSR_V)) ra++;
-        if((!(cpsr&CPSR_V))&&(cpsr&CPSR_N)) ra++;
-        if(cpsr&CPSR_Z) ra++;
-        if(ra)
-        {
-          write_register(15,rb);
-        }
-        return(0);
-
-      case 0xE:
-        //undefined instruction
-        break;
-
-      case 0xF:
-        //swi
-        break;
+      d.op=Op_b1;
+      d.imm=(inst>>0)&0xFF;
+      if(d.imm&0x80)
+        d.imm|=(~0)<<8;
+      d.imm<<=1;
+      d.imm+=2;
+      d.rd=(inst>>8)&0xF;
+      return;
     }
+    //0xE: undefined instruction, 0xF: swi
   }
 
   //B(2) unconditional branch
   if((inst&0xF800)==0xE000)
   {
-    rb=(inst>>0)&0x7FF;
-    if(rb&(1<<10))
-      rb|=(~0)<<11;
-    rb<<=1;
-    rb+=pc;
-    rb+=2;
-    DO_DISS(statusMsg << "B 0x" << Base::HEX8 << (rb-3) << endl);
-    write_register(15,rb);
-    return(0);
+    d.op=Op_b2;
+    d.imm=(inst>>0)&0x7FF;
+    if(d.imm&(1<<10))
+      d.imm|=(~0)<<11;
+    d.imm<<=1;
+    d.imm+=2;
+    return;
   }
 
   //BIC
   if((inst&0xFFC0)==0x4380)
   {
-    rd=(inst>>0)&0x7;
-    rm=(inst>>3)&0x7;
-    DO_DISS(statusMsg << "bics r" << dec << rd << ",r" << dec << rm << endl);
-    ra=read_register(rd);
-    rb=read_register(rm);
-    rc=ra&(~rb);
-    write_register(rd,rc);
-    do_nflag(rc);
-    do_zflag(rc);
-    return(0);
+    d.op=Op_bic;
+    d.rd=(inst>>0)&0x7;
+    d.rm=(inst>>3)&0x7;
+    return;
   }
 
   //BKPT
   if((inst&0xFF00)==0xBE00)
   {
-    rb=(inst>>0)&0xFF;
-    statusMsg << "bkpt 0x" << Base::HEX2 << rb << endl;
-    return(1);
+    d.op=Op_bkpt;
+    d.imm=(inst>>0)&0xFF;
+    return;
   }
 
   //BL/BLX(1)
@@ -872,123 +671,63 @@ int Thumbulator::execute ( void )
   {
     if((inst&0x1800)==0x1000) //H=b10
     {
-      DO_DISS(statusMsg << endl);
-      halfadd=inst;
-      return(0);
+      d.op=Op_bl_prefix;
+      return;
     }
     else if((inst&0x1800)==0x1800) //H=b11
     {
-      //branch to thumb
-      rb=halfadd&((1<<11)-1);
-      if(rb&1<<10)
-        rb|=(~((1<<11)-1)); //sign extend
-      rb<<=11;
-      rb|=inst&((1<<11)-1);
-      rb<<=1;
-      rb+=pc;
-      DO_DISS(statusMsg << "bl 0x" << Base::HEX8 << (rb-3) << endl);
-      write_register(14,pc-2);
-      write_register(15,rb);
-      return(0);
+      d.op=Op_bl;
+      d.imm=inst&((1<<11)-1);
+      return;
     }
     else if((inst&0x1800)==0x0800) //H=b01
     {
-      //fprintf(stderr,"cannot branch to arm 0x%08X 0x%04X\n",pc,inst);
-      // fxq: this should exit the code without having to detect it
-      return(1);
+      d.op=Op_blx1;
+      return;
     }
   }
 
   //BLX(2)
   if((inst&0xFF87)==0x4780)
   {
-    rm=(inst>>3)&0xF;
-    DO_DISS(statusMsg << "blx r" << dec << rm << endl);
-    rc=read_register(rm);
-    //fprintf(stderr,"blx r%u 0x%X 0x%X\n",rm,rc,pc);
-    rc+=2;
-    if(rc&1)
-    {
-      write_register(14,pc-2);
-      write_register(15,rc);
-      return(0);
-    }
-    else
-    {
-      //fprintf(stderr,"cannot branch to arm 0x%08X 0x%04X\n",pc,inst);
-      // fxq: this could serve as exit code
-      return(1);
-    }
+    d.op=Op_blx2;
+    d.rm=(inst>>3)&0xF;
+    return;
   }
 
   //BX
   if((inst&0xFF87)==0x4700)
   {
-    rm=(inst>>3)&0xF;
-    DO_DISS(statusMsg << "bx r" << dec << rm << endl);
-    rc=read_register(rm);
-    rc+=2;
-    //fprintf(stderr,"bx r%u 0x%X 0x%X\n",rm,rc,pc);
-    if(rc&1)
-    {
-      write_register(15,rc);
-      return(0);
-    }
-    else
-    {
-      //fprintf(stderr,"cannot branch to arm 0x%08X 0x%04X\n",pc,inst);
-      // fxq: or maybe this one??
-      return(1);
-    }
+    d.op=Op_bx;
+    d.rm=(inst>>3)&0xF;
+    return;
   }
 
   //CMN
   if((inst&0xFFC0)==0x42C0)
   {
-    rn=(inst>>0)&0x7;
-    rm=(inst>>3)&0x7;
-    DO_DISS(statusMsg << "cmns r" << dec << rn << ",r" << dec << rm << endl);
-    ra=read_register(rn);
-    rb=read_register(rm);
-    rc=ra+rb;
-    do_nflag(rc);
-    do_zflag(rc);
-    do_cflag(ra,rb,0);
-    do_add_vflag(ra,rb,rc);
-    return(0);
+    d.op=Op_cmn;
+    d.rn=(inst>>0)&0x7;
+    d.rm=(inst>>3)&0x7;
+    return;
   }
 
   //CMP(1) compare immediate
   if((inst&0xF800)==0x2800)
   {
-    rb=(inst>>0)&0xFF;
-    rn=(inst>>8)&0x07;
-    DO_DISS(statusMsg << "cmp r" << dec << rn << ",#0x" << Base::HEX2 << rb << endl);
-    ra=read_register(rn);
-    rc=ra-rb;
-    //fprintf(stderr,"0x%08X 0x%08X\n",ra,rb);
-    do_nflag(rc);
-    do_zflag(rc);
-    do_cflag(ra,~rb,1);
-    do_sub_vflag(ra,rb,rc);
-    return(0);
+    d.op=Op_cmp1;
+    d.imm=(inst>>0)&0xFF;
+    d.rn=(inst>>8)&0x07;
+    return;
   }
 
   //CMP(2) compare register
   if((inst&0xFFC0)==0x4280)
   {
-    rn=(inst>>0)&0x7;
-    rm=(inst>>3)&0x7;
-    DO_DISS(statusMsg << "cmps r" << dec << rn << ",r" << dec << rm << endl);
-    ra=read_register(rn);
-    rb=read_register(rm);
-    rc=ra-rb;
-    //fprintf(stderr,"0x%08X 0x%08X\n",ra,rb);
-    do_nflag(rc);
-    do_zflag(rc);
-    do_cflag(ra,~rb,1);
-    do_sub_vflag(ra,rb,rc);
-    return(0);
+    d.op=Op_cmp2;
+    d.rn=(inst>>0)&0x7;
+    d.rm=(inst>>3)&0x7;
+    return;
   }
 
   //CMP(3) compare high register
@@ -998,37 +737,22 @@ int Thumbulator::execute ( void )
     {
       //UNPREDICTABLE
     }
-    rn=(inst>>0)&0x7;
-    rn|=(inst>>4)&0x8;
-    if(rn==0xF)
+    d.op=Op_cmp3;
+    d.rn=(inst>>0)&0x7;
+    d.rn|=(inst>>4)&0x8;
+    if(d.rn==0xF)
     {
       //UNPREDICTABLE
     }
-    rm=(inst>>3)&0xF;
-    DO_DISS(statusMsg << "cmps r" << dec << rn << ",r" << dec << rm << endl);
-    ra=read_register(rn);
-    rb=read_register(rm);
-    rc=ra-rb;
-    do_nflag(rc);
-    do_zflag(rc);
-    do_cflag(ra,~rb,1);
-    do_sub_vflag(ra,rb,rc);
-
-#if 0
-    if(cpsr&CPSR_N) statusMsg << "N"; else statusMsg << "n";
-    if(cpsr&CPSR_Z) statusMsg << "Z"; else statusMsg << "z";
-    if(cpsr&CPSR_C) statusMsg << "C"; else statusMsg << "c";
-    if(cpsr&CPSR_V) statusMsg << "V"; else statusMsg << "v";
-    statusMsg << " -- 0x" << Base::HEX8 << ra << " 0x" << Base::HEX8 << rb << endl;
-#endif
-    return(0);
+    d.rm=(inst>>3)&0xF;
+    return;
   }
 
   //CPS
   if((inst&0xFFE8)==0xB660)
   {
-    DO_DISS(statusMsg << "cps TODO" << endl);
-    return(1);
+    d.op=Op_cps;
+    return;
   }
 
   //CPY copy high register
@@ -1036,918 +760,1843 @@ int Thumbulator::execute ( void )
   {
     //same as mov except you can use both low registers
     //going to let mov handle high registers
-    rd=(inst>>0)&0x7;
-    rm=(inst>>3)&0x7;
-    DO_DISS(statusMsg << "cpy r" << dec << rd << ",r" << dec << rm << endl);
-    rc=read_register(rm);
-    write_register(rd,rc);
-    return(0);
+    d.op=Op_cpy;
+    d.rd=(inst>>0)&0x7;
+    d.rm=(inst>>3)&0x7;
+    return;
   }
 
   //EOR
   if((inst&0xFFC0)==0x4040)
   {
-    rd=(inst>>0)&0x7;
-    rm=(inst>>3)&0x7;
-    DO_DISS(statusMsg << "eors r" << dec << rd << ",r" << dec << rm << endl);
-    ra=read_register(rd);
-    rb=read_register(rm);
-    rc=ra^rb;
-    write_register(rd,rc);
-    do_nflag(rc);
-    do_zflag(rc);
-    return(0);
+    d.op=Op_eor;
+    d.rd=(inst>>0)&0x7;
+    d.rm=(inst>>3)&0x7;
+    return;
   }
 
   //LDMIA
   if((inst&0xF800)==0xC800)
   {
-    rn=(inst>>8)&0x7;
-  #if defined(THUMB_DISS)
-    statusMsg << "ldmia r" << dec << rn << "!,{";
-    for(ra=0,rb=0x01,rc=0;rb;rb=(rb<<1)&0xFF,ra++)
-    {
-      if(inst&rb)
-      {
-        if(rc) statusMsg << ",";
-        statusMsg << "r" << dec << ra;
-        rc++;
-      }
-    }
-    statusMsg << "}" << endl;
-  #endif
-    sp=read_register(rn);
-    for(ra=0,rb=0x01;rb;rb=(rb<<1)&0xFF,ra++)
-    {
-      if(inst&rb)
-      {
-        write_register(ra,read32(sp));
-        sp+=4;
-      }
-    }
-    write_register(rn,sp);
-    return(0);
+    d.op=Op_ldmia;
+    d.rn=(inst>>8)&0x7;
+    d.imm=inst&0xFF;
+    return;
   }
 
   //LDR(1) two register immediate
   if((inst&0xF800)==0x6800)
   {
-    rd=(inst>>0)&0x07;
-    rn=(inst>>3)&0x07;
-    rb=(inst>>6)&0x1F;
-    rb<<=2;
-    DO_DISS(statusMsg << "ldr r" << dec << rd << ",[r" << dec << rn << ",#0x" << Base::HEX2 << rb << "]" << endl);
-    rb=read_register(rn)+rb;
-    rc=read32(rb);
-    write_register(rd,rc);
-    return(0);
+    d.op=Op_ldr1;
+    d.rd=(inst>>0)&0x07;
+    d.rn=(inst>>3)&0x07;
+    d.imm=((inst>>6)&0x1F)<<2;
+    return;
   }
 
   //LDR(2) three register
   if((inst&0xFE00)==0x5800)
   {
-    rd=(inst>>0)&0x7;
-    rn=(inst>>3)&0x7;
-    rm=(inst>>6)&0x7;
-    DO_DISS(statusMsg << "ldr r" << dec << rd << ",[r" << dec << rn << ",r" << dec << "]" << endl);
-    rb=read_register(rn)+read_register(rm);
-    rc=read32(rb);
-    write_register(rd,rc);
-    return(0);
+    d.op=Op_ldr2;
+    d.rd=(inst>>0)&0x7;
+    d.rn=(inst>>3)&0x7;
+    d.rm=(inst>>6)&0x7;
+    return;
   }
 
   //LDR(3)
   if((inst&0xF800)==0x4800)
   {
-    rb=(inst>>0)&0xFF;
-    rd=(inst>>8)&0x07;
-    rb<<=2;
-    DO_DISS(statusMsg << "ldr r" << dec << rd << ",[PC+#0x" << Base::HEX2 << rb << "] ");
-    ra=read_register(15);
-    ra&=~3;
-    rb+=ra;
-    DO_DISS(statusMsg << ";@ 0x" << Base::HEX2 << rb << endl);
-    rc=read32(rb);
-    write_register(rd,rc);
-    return(0);
+    d.op=Op_ldr3;
+    d.imm=((inst>>0)&0xFF)<<2;
+    d.rd=(inst>>8)&0x07;
+    return;
   }
 
   //LDR(4)
   if((inst&0xF800)==0x9800)
   {
-    rb=(inst>>0)&0xFF;
-    rd=(inst>>8)&0x07;
-    rb<<=2;
-    DO_DISS(statusMsg << "ldr r" << dec << rd << ",[SP+#0x" << Base::HEX2 << rb << "]" << endl);
-    ra=read_register(13);
-    //ra&=~3;
-    rb+=ra;
-    rc=read32(rb);
-    write_register(rd,rc);
-    return(0);
+    d.op=Op_ldr4;
+    d.imm=((inst>>0)&0xFF)<<2;
+    d.rd=(inst>>8)&0x07;
+    return;
   }
 
   //LDRB(1)
   if((inst&0xF800)==0x7800)
   {
-    rd=(inst>>0)&0x07;
-    rn=(inst>>3)&0x07;
-    rb=(inst>>6)&0x1F;
-    DO_DISS(statusMsg << "ldrb r" << dec << rd << ",[r" << dec << rn << ",#0x" << Base::HEX2 << rb << "]" << endl);
-    rb=read_register(rn)+rb;
-    rc=read16(rb&(~1));
-    if(rb&1)
-    {
-      rc>>=8;
-    }
-    else
-    {
-    }
-    write_register(rd,rc&0xFF);
-    return(0);
+    d.op=Op_ldrb1;
+    d.rd=(inst>>0)&0x07;
+    d.rn=(inst>>3)&0x07;
+    d.imm=(inst>>6)&0x1F;
+    return;
   }
 
   //LDRB(2)
   if((inst&0xFE00)==0x5C00)
   {
-    rd=(inst>>0)&0x7;
-    rn=(inst>>3)&0x7;
-    rm=(inst>>6)&0x7;
-    DO_DISS(statusMsg << "ldrb r" << dec << rd << ",[r" << dec << rn << ",r" << dec << rm << "]" << endl);
-    rb=read_register(rn)+read_register(rm);
-    rc=read16(rb&(~1));
-    if(rb&1)
-    {
-      rc>>=8;
-    }
-    else
-    {
-    }
-    write_register(rd,rc&0xFF);
-    return(0);
+    d.op=Op_ldrb2;
+    d.rd=(inst>>0)&0x7;
+    d.rn=(inst>>3)&0x7;
+    d.rm=(inst>>6)&0x7;
+    return;
   }
 
   //LDRH(1)
   if((inst&0xF800)==0x8800)
   {
-    rd=(inst>>0)&0x07;
-    rn=(inst>>3)&0x07;
-    rb=(inst>>6)&0x1F;
-    rb<<=1;
-    DO_DISS(statusMsg << "ldrh r" << dec << rd << ",[r" << dec << rn << ",#0x" << Base::HEX2 << rb << "]" << endl);
-    rb=read_register(rn)+rb;
-    rc=read16(rb);
-    write_register(rd,rc&0xFFFF);
-    return(0);
+    d.op=Op_ldrh1;
+    d.rd=(inst>>0)&0x07;
+    d.rn=(inst>>3)&0x07;
+    d.imm=((inst>>6)&0x1F)<<1;
+    return;
   }
 
   //LDRH(2)
   if((inst&0xFE00)==0x5A00)
   {
-    rd=(inst>>0)&0x7;
-    rn=(inst>>3)&0x7;
-    rm=(inst>>6)&0x7;
-    DO_DISS(statusMsg << "ldrh r" << dec << rd << ",[r" << dec << rn << ",r" << dec << rm << "]" << endl);
-    rb=read_register(rn)+read_register(rm);
-    rc=read16(rb);
-    write_register(rd,rc&0xFFFF);
-    return(0);
+    d.op=Op_ldrh2;
+    d.rd=(inst>>0)&0x7;
+    d.rn=(inst>>3)&0x7;
+    d.rm=(inst>>6)&0x7;
+    return;
   }
 
   //LDRSB
   if((inst&0xFE00)==0x5600)
   {
-    rd=(inst>>0)&0x7;
-    rn=(inst>>3)&0x7;
-    rm=(inst>>6)&0x7;
-    DO_DISS(statusMsg << "ldrsb r" << dec << rd << ",[r" << dec << rn << ",r" << dec << rm << "]" << endl);
-    rb=read_register(rn)+read_register(rm);
-    rc=read16(rb&(~1));
-    if(rb&1)
-    {
-      rc>>=8;
-    }
-    else
-    {
-    }
-    rc&=0xFF;
-    if(rc&0x80) rc|=((~0)<<8);
-    write_register(rd,rc);
-    return(0);
+    d.op=Op_ldrsb;
+    d.rd=(inst>>0)&0x7;
+    d.rn=(inst>>3)&0x7;
+    d.rm=(inst>>6)&0x7;
+    return;
   }
 
   //LDRSH
   if((inst&0xFE00)==0x5E00)
   {
-    rd=(inst>>0)&0x7;
-    rn=(inst>>3)&0x7;
-    rm=(inst>>6)&0x7;
-    DO_DISS(statusMsg << "ldrsh r" << dec << rd << ",[r" << dec << rn << ",r" << dec << rm << "]" << endl);
-    rb=read_register(rn)+read_register(rm);
-    rc=read16(rb);
-    rc&=0xFFFF;
-    if(rc&0x8000) rc|=((~0)<<16);
-    write_register(rd,rc);
-    return(0);
+    d.op=Op_ldrsh;
+    d.rd=(inst>>0)&0x7;
+    d.rn=(inst>>3)&0x7;
+    d.rm=(inst>>6)&0x7;
+    return;
   }
 
   //LSL(1)
   if((inst&0xF800)==0x0000)
   {
-    rd=(inst>>0)&0x07;
-    rm=(inst>>3)&0x07;
-    rb=(inst>>6)&0x1F;
-    DO_DISS(statusMsg << "lsls r" << dec << rd << ",r" << dec << rm << ",#0x" << Base::HEX2 << rb << endl);
-    rc=read_register(rm);
-    if(rb==0)
-    {
-      //if immed_5 == 0
-      //C unnaffected
-      //result not shifted
-    }
-    else
-    {
-      //else immed_5 > 0
-      do_cflag_bit(rc&(1<<(32-rb)));
-      rc<<=rb;
-    }
-    write_register(rd,rc);
-    do_nflag(rc);
-    do_zflag(rc);
-    return(0);
+    d.op=Op_lsl1;
+    d.rd=(inst>>0)&0x07;
+    d.rm=(inst>>3)&0x07;
+    d.imm=(inst>>6)&0x1F;
+    return;
   }
 
   //LSL(2) two register
   if((inst&0xFFC0)==0x4080)
   {
-    rd=(inst>>0)&0x07;
-    rs=(inst>>3)&0x07;
-    DO_DISS(statusMsg << "lsls r" << dec << rd << ",r" << dec << rs << endl);
-    rc=read_register(rd);
-    rb=read_register(rs);
-    rb&=0xFF;
-    if(rb==0)
-    {
-    }
-    else if(rb<32)
-    {
-      do_cflag_bit(rc&(1<<(32-rb)));
-      rc<<=rb;
-    }
-    else if(rb==32)
-    {
-      do_cflag_bit(rc&1);
-      rc=0;
-    }
-    else
-    {
-      do_cflag_bit(0);
-      rc=0;
-    }
-    write_register(rd,rc);
-    do_nflag(rc);
-    do_zflag(rc);
-    return(0);
+    d.op=Op_lsl2;
+    d.rd=(inst>>0)&0x07;
+    d.rn=(inst>>3)&0x07;
+    return;
   }
 
   //LSR(1) two register immediate
   if((inst&0xF800)==0x0800)
   {
-    rd=(inst>>0)&0x07;
-    rm=(inst>>3)&0x07;
-    rb=(inst>>6)&0x1F;
-    DO_DISS(statusMsg << "lsrs r" << dec << rd << ",r" << dec << rm << ",#0x" << Base::HEX2 << rb << endl);
-    rc=read_register(rm);
-    if(rb==0)
-    {
-      do_cflag_bit(rc&0x80000000);
-      rc=0;
-    }
-    else
-    {
-      do_cflag_bit(rc&(1<<(rb-1)));
-      rc>>=rb;
-    }
-    write_register(rd,rc);
-    do_nflag(rc);
-    do_zflag(rc);
-    return(0);
+    d.op=Op_lsr1;
+    d.rd=(inst>>0)&0x07;
+    d.rm=(inst>>3)&0x07;
+    d.imm=(inst>>6)&0x1F;
+    return;
   }
 
   //LSR(2) two register
   if((inst&0xFFC0)==0x40C0)
   {
-    rd=(inst>>0)&0x07;
-    rs=(inst>>3)&0x07;
-    DO_DISS(statusMsg << "lsrs r" << dec << rd << ",r" << dec << rs << endl);
-    rc=read_register(rd);
-    rb=read_register(rs);
-    rb&=0xFF;
-    if(rb==0)
-    {
-    }
-    else if(rb<32)
-    {
-      do_cflag_bit(rc&(1<<(32-rb)));
-      rc>>=rb;
-    }
-    else if(rb==32)
-    {
-      do_cflag_bit(rc&0x80000000);
-      rc=0;
-    }
-    else
-    {
-      do_cflag_bit(0);
-      rc=0;
-    }
-    write_register(rd,rc);
-    do_nflag(rc);
-    do_zflag(rc);
-    return(0);
+    d.op=Op_lsr2;
+    d.rd=(inst>>0)&0x07;
+    d.rn=(inst>>3)&0x07;
+    return;
   }
 
   //MOV(1) immediate
   if((inst&0xF800)==0x2000)
   {
-    rb=(inst>>0)&0xFF;
-    rd=(inst>>8)&0x07;
-    DO_DISS(statusMsg << "movs r" << dec << rd << ",#0x" << Base::HEX2 << rb << endl);
-    write_register(rd,rb);
-    do_nflag(rb);
-    do_zflag(rb);
-    return(0);
+    d.op=Op_mov1;
+    d.imm=(inst>>0)&0xFF;
+    d.rd=(inst>>8)&0x07;
+    return;
   }
 
   //MOV(2) two low registers
   if((inst&0xFFC0)==0x1C00)
   {
-    rd=(inst>>0)&7;
-    rn=(inst>>3)&7;
-    DO_DISS(statusMsg << "movs r" << dec << rd << ",r" << dec << rn << endl);
-    rc=read_register(rn);
-    //fprintf(stderr,"0x%08X\n",rc);
-    write_register(rd,rc);
-    do_nflag(rc);
-    do_zflag(rc);
-    do_cflag_bit(0);
-    do_vflag_bit(0);
-    return(0);
+    d.op=Op_mov2;
+    d.rd=(inst>>0)&7;
+    d.rn=(inst>>3)&7;
+    return;
   }
 
   //MOV(3)
   if((inst&0xFF00)==0x4600)
   {
-    rd=(inst>>0)&0x7;
-    rd|=(inst>>4)&0x8;
-    rm=(inst>>3)&0xF;
-    DO_DISS(statusMsg << "mov r" << dec << rd << ",r" << dec << rm << endl);
-    rc=read_register(rm);
-    if (rd==15) rc+=2; // fxq fix for MOV R15
-    write_register(rd,rc);
-    return(0);
+    d.op=Op_mov3;
+    d.rd=(inst>>0)&0x7;
+    d.rd|=(inst>>4)&0x8;
+    d.rm=(inst>>3)&0xF;
+    return;
   }
 
   //MUL
   if((inst&0xFFC0)==0x4340)
   {
-    rd=(inst>>0)&0x7;
-    rm=(inst>>3)&0x7;
-    DO_DISS(statusMsg << "muls r" << dec << rd << ",r" << dec << rm << endl);
-    ra=read_register(rd);
-    rb=read_register(rm);
-    rc=ra*rb;
-    write_register(rd,rc);
-    do_nflag(rc);
-    do_zflag(rc);
-    return(0);
+    d.op=Op_mul;
+    d.rd=(inst>>0)&0x7;
+    d.rm=(inst>>3)&0x7;
+    return;
   }
 
   //MVN
   if((inst&0xFFC0)==0x43C0)
   {
-    rd=(inst>>0)&0x7;
-    rm=(inst>>3)&0x7;
-    DO_DISS(statusMsg << "mvns r" << dec << rd << ",r" << dec << rm << endl);
-    ra=read_register(rm);
-    rc=(~ra);
-    write_register(rd,rc);
-    do_nflag(rc);
-    do_zflag(rc);
-    return(0);
+    d.op=Op_mvn;
+    d.rd=(inst>>0)&0x7;
+    d.rm=(inst>>3)&0x7;
+    return;
   }
 
   //NEG
   if((inst&0xFFC0)==0x4240)
   {
-    rd=(inst>>0)&0x7;
-    rm=(inst>>3)&0x7;
-    DO_DISS(statusMsg << "negs r" << dec << rd << ",r" << dec << rm << endl);
-    ra=read_register(rm);
-    rc=0-ra;
-    write_register(rd,rc);
-    do_nflag(rc);
-    do_zflag(rc);
-    do_cflag(0,~ra,1);
-    do_sub_vflag(0,ra,rc);
-    return(0);
+    d.op=Op_neg;
+    d.rd=(inst>>0)&0x7;
+    d.rm=(inst>>3)&0x7;
+    return;
   }
 
   //ORR
   if((inst&0xFFC0)==0x4300)
   {
-    rd=(inst>>0)&0x7;
-    rm=(inst>>3)&0x7;
-    DO_DISS(statusMsg << "orrs r" << dec << rd << ",r" << dec << rm << endl);
-    ra=read_register(rd);
-    rb=read_register(rm);
-    rc=ra|rb;
-    write_register(rd,rc);
-    do_nflag(rc);
-    do_zflag(rc);
-    return(0);
+    d.op=Op_orr;
+    d.rd=(inst>>0)&0x7;
+    d.rm=(inst>>3)&0x7;
+    return;
   }
 
   //POP
   if((inst&0xFE00)==0xBC00)
   {
-  #if defined(THUMB_DISS)
-    statusMsg << "pop {";
-    for(ra=0,rb=0x01,rc=0;rb;rb=(rb<<1)&0xFF,ra++)
-    {
-      if(inst&rb)
-      {
-        if(rc) statusMsg << ",";
-        statusMsg << "r" << dec << ra;
-        rc++;
-      }
-    }
-    if(inst&0x100)
-    {
-      if(rc) statusMsg << ",";
-      statusMsg << "pc";
-    }
-    statusMsg << "}" << endl;
-  #endif
-
-    sp=read_register(13);
-    for(ra=0,rb=0x01;rb;rb=(rb<<1)&0xFF,ra++)
-    {
-      if(inst&rb)
-      {
-        write_register(ra,read32(sp));
-        sp+=4;
-      }
-    }
-    if(inst&0x100)
-    {
-      rc=read32(sp);
-      rc+=2;
-      write_register(15,rc);
-      sp+=4;
-    }
-    write_register(13,sp);
-    return(0);
-  }
+    d.op=Op_pop;
+    d.imm=inst&0x1FF;
+    return;
+  }
 
   //PUSH
   if((inst&0xFE00)==0xB400)
   {
-  #if defined(THUMB_DISS)
-    statusMsg << "push {";
-    for(ra=0,rb=0x01,rc=0;rb;rb=(rb<<1)&0xFF,ra++)
-    {
-      if(inst&rb)
-      {
-        if(rc) statusMsg << ",";
-        statusMsg << "r" << dec << ra;
-        rc++;
-      }
-    }
-    if(inst&0x100)
-    {
-      if(rc) statusMsg << ",";
-      statusMsg << "lr";
-    }
-    statusMsg << "}" << endl;
-  #endif
-
-    sp=read_register(13);
-    //fprintf(stderr,"sp 0x%08X\n",sp);
-    for(ra=0,rb=0x01,rc=0;rb;rb=(rb<<1)&0xFF,ra++)
-    {
-      if(inst&rb)
-      {
-        rc++;
-      }
-    }
-    if(inst&0x100) rc++;
-    rc<<=2;
-    sp-=rc;
-    rd=sp;
-    for(ra=0,rb=0x01;rb;rb=(rb<<1)&0xFF,ra++)
-    {
-      if(inst&rb)
-      {
-        write32(rd,read_register(ra));
-        rd+=4;
-      }
-    }
-    if(inst&0x100)
-    {
-      write32(rd,read_register(14));
-    }
-    write_register(13,sp);
-    return(0);
+    d.op=Op_push;
+    d.imm=inst&0x1FF;
+    return;
   }
 
   //REV
   if((inst&0xFFC0)==0xBA00)
   {
-    rd=(inst>>0)&0x7;
-    rn=(inst>>3)&0x7;
-    DO_DISS(statusMsg << "rev r" << dec << rd << ",r" << dec << rn << endl);
-    ra=read_register(rn);
-    rc =((ra>> 0)&0xFF)<<24;
-    rc|=((ra>> 8)&0xFF)<<16;
-    rc|=((ra>>16)&0xFF)<< 8;
-    rc|=((ra>>24)&0xFF)<< 0;
-    write_register(rd,rc);
-    return(0);
+    d.op=Op_rev;
+    d.rd=(inst>>0)&0x7;
+    d.rn=(inst>>3)&0x7;
+    return;
   }
 
   //REV16
   if((inst&0xFFC0)==0xBA40)
   {
-    rd=(inst>>0)&0x7;
-    rn=(inst>>3)&0x7;
-    DO_DISS(statusMsg << "rev16 r" << dec << rd << ",r" << dec << rn << endl);
-    ra=read_register(rn);
-    rc =((ra>> 0)&0xFF)<< 8;
-    rc|=((ra>> 8)&0xFF)<< 0;
-    rc|=((ra>>16)&0xFF)<<24;
-    rc|=((ra>>24)&0xFF)<<16;
-    write_register(rd,rc);
-    return(0);
+    d.op=Op_rev16;
+    d.rd=(inst>>0)&0x7;
+    d.rn=(inst>>3)&0x7;
+    return;
   }
 
   //REVSH
   if((inst&0xFFC0)==0xBAC0)
   {
-    rd=(inst>>0)&0x7;
-    rn=(inst>>3)&0x7;
-    DO_DISS(statusMsg << "revsh r" << dec << rd << ",r" << dec << rn << endl);
-    ra=read_register(rn);
-    rc =((ra>> 0)&0xFF)<< 8;
-    rc|=((ra>> 8)&0xFF)<< 0;
-    if(rc&0x8000) rc|=0xFFFF0000;
-    else          rc&=0x0000FFFF;
-    write_register(rd,rc);
-    return(0);
+    d.op=Op_revsh;
+    d.rd=(inst>>0)&0x7;
+    d.rn=(inst>>3)&0x7;
+    return;
   }
 
   //ROR
   if((inst&0xFFC0)==0x41C0)
   {
-    rd=(inst>>0)&0x7;
-    rs=(inst>>3)&0x7;
-    DO_DISS(statusMsg << "rors r" << dec << rd << ",r" << dec << rs << endl);
-    rc=read_register(rd);
-    ra=read_register(rs);
-    ra&=0xFF;
-    if(ra==0)
-    {
-    }
-    else
-    {
-      ra&=0x1F;
-      if(ra==0)
-      {
-        do_cflag_bit(rc&0x80000000);
-      }
-      else
-      {
-        do_cflag_bit(rc&(1<<(ra-1)));
-        rb=rc<<(32-ra);
-        rc>>=ra;
-        rc|=rb;
-      }
-    }
-    write_register(rd,rc);
-    do_nflag(rc);
-    do_zflag(rc);
-    return(0);
+    d.op=Op_ror;
+    d.rd=(inst>>0)&0x7;
+    d.rn=(inst>>3)&0x7;
+    return;
   }
 
   //SBC
   if((inst&0xFFC0)==0x4180)
   {
-    rd=(inst>>0)&0x7;
-    rm=(inst>>3)&0x7;
-    DO_DISS(statusMsg << "sbc r" << dec << rd << ",r" << dec << rm << endl);
-    ra=read_register(rd);
-    rb=read_register(rm);
-    rc=ra-rb;
-    if(!(cpsr&CPSR_C)) rc--;
-    write_register(rd,rc);
-    do_nflag(rc);
-    do_zflag(rc);
-    do_cflag(ra,rb,0);
-    do_sub_vflag(ra,rb,rc);
-    return(0);
+    d.op=Op_sbc;
+    d.rd=(inst>>0)&0x7;
+    d.rm=(inst>>3)&0x7;
+    return;
   }
 
   //SETEND
   if((inst&0xFFF7)==0xB650)
   {
-    statusMsg << "setend not implemented" << endl;
-    return(1);
+    d.op=Op_setend;
+    return;
   }
 
   //STMIA
   if((inst&0xF800)==0xC000)
   {
-    rn=(inst>>8)&0x7;
-  #if defined(THUMB_DISS)
-    statusMsg << "stmia r" << dec << rn << "!,{";
-    for(ra=0,rb=0x01,rc=0;rb;rb=(rb<<1)&0xFF,ra++)
-    {
-      if(inst&rb)
-      {
-        if(rc) statusMsg << ",";
-        statusMsg << "r" << dec << ra;
-        rc++;
-      }
-    }
-    statusMsg << "}" << endl;
-  #endif
-
-    sp=read_register(rn);
-    for(ra=0,rb=0x01;rb;rb=(rb<<1)&0xFF,ra++)
-    {
-      if(inst&rb)
-      {
-        write32(sp,read_register(ra));
-        sp+=4;
-      }
-    }
-    write_register(rn,sp);
-    return(0);
+    d.op=Op_stmia;
+    d.rn=(inst>>8)&0x7;
+    d.imm=inst&0xFF;
+    return;
   }
 
   //STR(1)
   if((inst&0xF800)==0x6000)
   {
-    rd=(inst>>0)&0x07;
-    rn=(inst>>3)&0x07;
-    rb=(inst>>6)&0x1F;
-    rb<<=2;
-    DO_DISS(statusMsg << "str r" << dec << rd << ",[r" << dec << rn << ",#0x" << Base::HEX2 << rb << "]" << endl);
-    rb=read_register(rn)+rb;
-    rc=read_register(rd);
-    write32(rb,rc);
-    return(0);
+    d.op=Op_str1;
+    d.rd=(inst>>0)&0x07;
+    d.rn=(inst>>3)&0x07;
+    d.imm=((inst>>6)&0x1F)<<2;
+    return;
   }
 
   //STR(2)
   if((inst&0xFE00)==0x5000)
   {
-    rd=(inst>>0)&0x7;
-    rn=(inst>>3)&0x7;
-    rm=(inst>>6)&0x7;
-    DO_DISS(statusMsg << "str r" << dec << rd << ",[r" << dec << rn << ",r" << dec << rm << "]" << endl);
-    rb=read_register(rn)+read_register(rm);
-    rc=read_register(rd);
-    write32(rb,rc);
-    return(0);
+    d.op=Op_str2;
+    d.rd=(inst>>0)&0x7;
+    d.rn=(inst>>3)&0x7;
+    d.rm=(inst>>6)&0x7;
+    return;
   }
 
   //STR(3)
   if((inst&0xF800)==0x9000)
   {
-    rb=(inst>>0)&0xFF;
-    rd=(inst>>8)&0x07;
-    rb<<=2;
-    DO_DISS(statusMsg << "str r" << dec << rd << ",[SP,#0x" << Base::HEX2 << rb << "]" << endl);
-    rb=read_register(13)+rb;
-    //fprintf(stderr,"0x%08X\n",rb);
-    rc=read_register(rd);
-    write32(rb,rc);
-    return(0);
+    d.op=Op_str3;
+    d.imm=((inst>>0)&0xFF)<<2;
+    d.rd=(inst>>8)&0x07;
+    return;
   }
 
   //STRB(1)
   if((inst&0xF800)==0x7000)
   {
-    rd=(inst>>0)&0x07;
-    rn=(inst>>3)&0x07;
-    rb=(inst>>6)&0x1F;
-    DO_DISS(statusMsg << "strb r" << dec << rd << ",[r" << dec << rn << ",#0x" << Base::HEX8 << rb << "]" << endl);
-    rb=read_register(rn)+rb;
-    rc=read_register(rd);
-    ra=read16(rb&(~1));
-    if(rb&1)
-    {
-      ra&=0x00FF;
-      ra|=rc<<8;
-    }
-    else
-    {
-      ra&=0xFF00;
-      ra|=rc&0x00FF;
-    }
-    write16(rb&(~1),ra&0xFFFF);
-    return(0);
+    d.op=Op_strb1;
+    d.rd=(inst>>0)&0x07;
+    d.rn=(inst>>3)&0x07;
+    d.imm=(inst>>6)&0x1F;
+    return;
   }
 
   //STRB(2)
   if((inst&0xFE00)==0x5400)
   {
-    rd=(inst>>0)&0x7;
-    rn=(inst>>3)&0x7;
-    rm=(inst>>6)&0x7;
-    DO_DISS(statusMsg << "strb r" << dec << rd << ",[r" << dec << rn << ",r" << rm << "]" << endl);
-    rb=read_register(rn)+read_register(rm);
-    rc=read_register(rd);
-    ra=read16(rb&(~1));
-    if(rb&1)
-    {
-      ra&=0x00FF;
-      ra|=rc<<8;
-    }
-    else
-    {
-      ra&=0xFF00;
-      ra|=rc&0x00FF;
-    }
-    write16(rb&(~1),ra&0xFFFF);
-    return(0);
+    d.op=Op_strb2;
+    d.rd=(inst>>0)&0x7;
+    d.rn=(inst>>3)&0x7;
+    d.rm=(inst>>6)&0x7;
+    return;
   }
 
   //STRH(1)
   if((inst&0xF800)==0x8000)
   {
-    rd=(inst>>0)&0x07;
-    rn=(inst>>3)&0x07;
-    rb=(inst>>6)&0x1F;
-    rb<<=1;
-    DO_DISS(statusMsg << "strh r" << dec << rd << ",[r" << dec << rn << ",#0x" << Base::HEX2 << rb << "]" << endl);
-    rb=read_register(rn)+rb;
-    rc=read_register(rd);
-    write16(rb,rc&0xFFFF);
-    return(0);
+    d.op=Op_strh1;
+    d.rd=(inst>>0)&0x07;
+    d.rn=(inst>>3)&0x07;
+    d.imm=((inst>>6)&0x1F)<<1;
+    return;
   }
 
   //STRH(2)
   if((inst&0xFE00)==0x5200)
   {
-    rd=(inst>>0)&0x7;
-    rn=(inst>>3)&0x7;
-    rm=(inst>>6)&0x7;
-    DO_DISS(statusMsg << "strh r" << dec << rd << ",[r" << dec << rn << ",r" << dec << rm << "]" << endl);
-    rb=read_register(rn)+read_register(rm);
-    rc=read_register(rd);
-    write16(rb,rc&0xFFFF);
-    return(0);
+    d.op=Op_strh2;
+    d.rd=(inst>>0)&0x7;
+    d.rn=(inst>>3)&0x7;
+    d.rm=(inst>>6)&0x7;
+    return;
   }
 
   //SUB(1)
   if((inst&0xFE00)==0x1E00)
   {
-    rd=(inst>>0)&7;
-    rn=(inst>>3)&7;
-    rb=(inst>>6)&7;
-    DO_DISS(statusMsg << "subs r" << dec << rd << ",r" << dec << rn << ",#0x" << Base::HEX2 << rb << endl);
-    ra=read_register(rn);
-    rc=ra-rb;
-    write_register(rd,rc);
-    do_nflag(rc);
-    do_zflag(rc);
-    do_cflag(ra,~rb,1);
-    do_sub_vflag(ra,rb,rc);
-    return(0);
+    d.op=Op_sub1;
+    d.rd=(inst>>0)&7;
+    d.rn=(inst>>3)&7;
+    d.imm=(inst>>6)&7;
+    return;
   }
 
   //SUB(2)
   if((inst&0xF800)==0x3800)
   {
-    rb=(inst>>0)&0xFF;
-    rd=(inst>>8)&0x07;
-    DO_DISS(statusMsg << "subs r" << dec << rd << ",#0x" << Base::HEX2 << rb << endl);
-    ra=read_register(rd);
-    rc=ra-rb;
-    write_register(rd,rc);
-    do_nflag(rc);
-    do_zflag(rc);
-    do_cflag(ra,~rb,1);
-    do_sub_vflag(ra,rb,rc);
-    return(0);
+    d.op=Op_sub2;
+    d.imm=(inst>>0)&0xFF;
+    d.rd=(inst>>8)&0x07;
+    return;
   }
 
   //SUB(3)
   if((inst&0xFE00)==0x1A00)
   {
-    rd=(inst>>0)&0x7;
-    rn=(inst>>3)&0x7;
-    rm=(inst>>6)&0x7;
-    DO_DISS(statusMsg << "subs r" << dec << rd << ",r" << dec << rn << ",r" << dec << rm << endl);
-    ra=read_register(rn);
-    rb=read_register(rm);
-    rc=ra-rb;
-    write_register(rd,rc);
-    do_nflag(rc);
-    do_zflag(rc);
-    do_cflag(ra,~rb,1);
-    do_sub_vflag(ra,rb,rc);
-    return(0);
+    d.op=Op_sub3;
+    d.rd=(inst>>0)&0x7;
+    d.rn=(inst>>3)&0x7;
+    d.rm=(inst>>6)&0x7;
+    return;
   }
 
   //SUB(4)
   if((inst&0xFF80)==0xB080)
   {
-    rb=inst&0x7F;
-    rb<<=2;
-    DO_DISS(statusMsg << "sub SP,#0x" << Base::HEX2 << rb << endl);
-    ra=read_register(13);
-    ra-=rb;
-    write_register(13,ra);
-    return(0);
+    d.op=Op_sub4;
+    d.imm=(inst&0x7F)<<2;
+    return;
   }
 
   //SWI
   if((inst&0xFF00)==0xDF00)
   {
-    rb=inst&0xFF;
-    DO_DISS(statusMsg << "swi 0x" << Base::HEX2 << rb << endl);
-    statusMsg << endl << endl << "swi 0x" << Base::HEX2 << rb << endl;
-    return(1);
+    d.op=Op_swi;
+    d.imm=inst&0xFF;
+    return;
   }
 
   //SXTB
   if((inst&0xFFC0)==0xB240)
   {
-    rd=(inst>>0)&0x7;
-    rm=(inst>>3)&0x7;
-    DO_DISS(statusMsg << "sxtb r" << dec << rd << ",r" << dec << rm << endl);
-    ra=read_register(rm);
-    rc=ra&0xFF;
-    if(rc&0x80) rc|=(~0)<<8;
-    write_register(rd,rc);
-    return(0);
+    d.op=Op_sxtb;
+    d.rd=(inst>>0)&0x7;
+    d.rm=(inst>>3)&0x7;
+    return;
   }
 
   //SXTH
   if((inst&0xFFC0)==0xB200)
   {
-    rd=(inst>>0)&0x7;
-    rm=(inst>>3)&0x7;
-    DO_DISS(statusMsg << "sxth r" << dec << rd << ",r" << dec << rm << endl);
-    ra=read_register(rm);
-    rc=ra&0xFFFF;
-    if(rc&0x8000) rc|=(~0)<<16;
-    write_register(rd,rc);
-    return(0);
+    d.op=Op_sxth;
+    d.rd=(inst>>0)&0x7;
+    d.rm=(inst>>3)&0x7;
+    return;
   }
 
   //TST
   if((inst&0xFFC0)==0x4200)
   {
-    rn=(inst>>0)&0x7;
-    rm=(inst>>3)&0x7;
-    DO_DISS(statusMsg << "tst r" << dec << rn << ",r" << dec << rm << endl);
-    ra=read_register(rn);
-    rb=read_register(rm);
-    rc=ra&rb;
-    do_nflag(rc);
-    do_zflag(rc);
-    return(0);
+    d.op=Op_tst;
+    d.rn=(inst>>0)&0x7;
+    d.rm=(inst>>3)&0x7;
+    return;
   }
 
   //UXTB
   if((inst&0xFFC0)==0xB2C0)
   {
-    rd=(inst>>0)&0x7;
-    rm=(inst>>3)&0x7;
-    DO_DISS(statusMsg << "uxtb r" << dec << rd << ",r" << dec << rm << endl);
-    ra=read_register(rm);
-    rc=ra&0xFF;
-    write_register(rd,rc);
-    return(0);
+    d.op=Op_uxtb;
+    d.rd=(inst>>0)&0x7;
+    d.rm=(inst>>3)&0x7;
+    return;
   }
 
   //UXTH
   if((inst&0xFFC0)==0xB280)
   {
-    rd=(inst>>0)&0x7;
-    rm=(inst>>3)&0x7;
-    DO_DISS(statusMsg << "uxth r" << dec << rd << ",r" << dec << rm << endl);
-    ra=read_register(rm);
-    rc=ra&0xFFFF;
-    write_register(rd,rc);
-    return(0);
+    d.op=Op_uxth;
+    d.rd=(inst>>0)&0x7;
+    d.rm=(inst>>3)&0x7;
+    return;
+  }
+
+  d.op=Op_invalid;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Thumbulator::decode_timing ( Decoded& d )
+{
+  // Every instruction takes one cycle for its own fetch and one for each
+  // data access, and loads need an extra internal cycle; refilling the
+  // pipeline after a branch is counted in execute_trace()
+  uInt32 list;
+  d.reads=d.writes=0;
+  d.cycles=1;
+  switch(d.op)
+  {
+    case Op_ldr1:  case Op_ldr2:  case Op_ldr3:  case Op_ldr4:
+    case Op_ldrb1: case Op_ldrb2: case Op_ldrh1: case Op_ldrh2:
+    case Op_ldrsb: case Op_ldrsh:
+      d.reads=1;
+      d.cycles+=1;
+      break;
+
+    case Op_ldmia:
+    case Op_pop:
+      for(list=d.imm;list;list&=list-1)
+        d.reads++;
+      d.cycles+=1;
+      break;
+
+    case Op_str1:  case Op_str2:  case Op_str3:  case Op_strb1:
+    case Op_strb2: case Op_strh1: case Op_strh2:
+      d.writes=1;
+      break;
+
+    case Op_stmia:
+    case Op_push:
+      for(list=d.imm;list;list&=list-1)
+        d.writes++;
+      break;
+
+    case Op_mul:
+      // Up to 4 internal cycles depending on the multiplier; assume the worst
+      d.cycles+=4;
+      break;
+
+    default:
+      break;
+  }
+  d.cycles+=d.reads+d.writes;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+inline bool Thumbulator::ends_trace ( const Decoded& d )
+{
+  switch(d.op)
+  {
+    // Branches, and anything which stops execution
+    case Op_b1:    case Op_b2:    case Op_bl:    case Op_blx1:
+    case Op_blx2:  case Op_bx:    case Op_bkpt:  case Op_cps:
+    case Op_setend: case Op_swi:  case Op_invalid:
+      return true;
+
+    // Instructions which may write the PC
+    case Op_add4:
+    case Op_mov3:
+      return d.rd==15;
+    case Op_pop:
+      return (d.imm&0x100)!=0;
+
+    default:
+      return false;
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Thumbulator::translate ( uInt32 index )
+{
+  // Decode forward to the end of this straight-line run of code, or until
+  // it joins a run which has already been translated
+  uInt32 last=index;
+  for(;;)
+  {
+    Decoded& d=decodeCache[last];
+    if(d.count)
+      break;
+
+    decode(GET16(rom,last),d);
+    decode_timing(d);
+    if(ends_trace(d) || last==ROMSIZE/2-1)
+    {
+      d.count=1;
+      break;
+    }
+    ++last;
+  }
+
+  // Each entry records how many instructions are left in its run
+  while(last-- > index)
+    decodeCache[last].count=decodeCache[last+1].count+1;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+int Thumbulator::execute_trace ( void )
+{
+  uInt32 pc=read_register(15);
+  uInt32 addr=pc-2;
+
+  // ROM can't change, so straight-line runs of code fetched from it are
+  // decoded once and then executed back-to-back from the cache
+  if(((addr&0xF0000000)==0x00000000) && ((addr&ROMADDMASK)>=0x50))
+  {
+    const Decoded* d=&decodeCache[(addr&ROMADDMASK)>>1];
+    if(d->count==0)
+    {
+      translate((addr&ROMADDMASK)>>1);
+      d=&decodeCache[(addr&ROMADDMASK)>>1];
+    }
+
+    // Never run past the instruction limit checked in run()
+    uInt32 count=d->count;
+    if(instructions+count > 500001)
+      count=500001-instructions;
+
+    pc+=count*2;
+    for(; count; --count, ++d)
+    {
+      DO_STAT(fetches++);
+      if(execute(d))
+        return(1);
+    }
+  }
+  else
+  {
+    // Code in RAM is decoded every time
+    Decoded decoded;
+    decode(fetch16(addr),decoded);
+    decode_timing(decoded);
+    pc+=2;
+    if(execute(&decoded))
+      return(1);
+  }
+
+  // Only the last instruction of a trace can branch, and when it does
+  // the pipeline is refilled (two more fetches)
+  if(read_register(15)!=pc)
+    armcycles+=2;
+
+  return(0);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+int Thumbulator::execute ( const Decoded* d )
+{
+  uInt32 pc, sp,
+         ra,rb,rc,
+         rm,rd,rn,rs;
+
+  pc=read_register(15);
+  pc+=2;
+  write_register(15,pc);
+  DO_DISS(statusMsg << Base::HEX8 << (pc-5) << ": " << Base::HEX4 << d->inst << " ");
+
+  instructions++;
+  armreads+=d->reads;
+  armwrites+=d->writes;
+  armcycles+=d->cycles;
+
+  switch(d->op)
+  {
+    //ADC
+    case Op_adc:
+      rd=d->rd;
+      rm=d->rm;
+      DO_DISS(statusMsg << "adc r" << dec << rd << ",r" << dec << rm << endl);
+      ra=read_register(rd);
+      rb=read_register(rm);
+      rs=flagC();
+      rc=ra+rb+rs;
+      write_register(rd,rc);
+      do_nzflag(rc);
+      do_cflag(ra,rb,rs);
+      do_add_vflag(ra,rb,rc);
+      return(0);
+
+    //ADD(1) small immediate two registers
+    case Op_add1:
+      rd=d->rd;
+      rn=d->rn;
+      rb=d->imm;
+      DO_DISS(statusMsg << "adds r" << dec << rd << ",r" << dec << rn << ","
+                        << "#0x" << Base::HEX2 << rb << endl);
+      ra=read_register(rn);
+      rc=ra+rb;
+      write_register(rd,rc);
+      do_nzflag(rc);
+      do_cflag(ra,rb,0);
+      do_add_vflag(ra,rb,rc);
+      return(0);
+
+    //ADD(2) big immediate one register
+    case Op_add2:
+      rb=d->imm;
+      rd=d->rd;
+      DO_DISS(statusMsg << "adds r" << dec << rd << ",#0x" << Base::HEX2 << rb << endl);
+      ra=read_register(rd);
+      rc=ra+rb;
+      write_register(rd,rc);
+      do_nzflag(rc);
+      do_cflag(ra,rb,0);
+      do_add_vflag(ra,-rb,rc);
+      return(0);
+
+    //ADD(3) three registers
+    case Op_add3:
+      rd=d->rd;
+      rn=d->rn;
+      rm=d->rm;
+      DO_DISS(statusMsg << "adds r" << dec << rd << ",r" << dec << rn << ",r" << rm << endl);
+      ra=read_register(rn);
+      rb=read_register(rm);
+      rc=ra+rb;
+      write_register(rd,rc);
+      do_nzflag(rc);
+      do_cflag(ra,rb,0);
+      do_add_vflag(ra,rb,rc);
+      return(0);
+
+    //ADD(4) two registers one or both high no flags
+    case Op_add4:
+      rd=d->rd;
+      rm=d->rm;
+      DO_DISS(statusMsg << "add r" << dec << rd << ",r" << dec << rm << endl);
+      ra=read_register(rd);
+      rb=read_register(rm);
+      rc=ra+rb;
+      write_register(rd,rc);
+      return(0);
+
+    //ADD(5) rd = pc plus immediate
+    case Op_add5:
+      rb=d->imm;
+      rd=d->rd;
+      DO_DISS(statusMsg << "add r" << dec << rd << ",PC,#0x" << Base::HEX2 << rb << endl);
+      ra=read_register(15);
+      rc=(ra&(~3))+rb;
+      write_register(rd,rc);
+      return(0);
+
+    //ADD(6) rd = sp plus immediate
+    case Op_add6:
+      rb=d->imm;
+      rd=d->rd;
+      DO_DISS(statusMsg << "add r" << dec << rd << ",SP,#0x" << Base::HEX2 << rb << endl);
+      ra=read_register(13);
+      rc=ra+rb;
+      write_register(rd,rc);
+      return(0);
+
+    //ADD(7) sp plus immediate
+    case Op_add7:
+      rb=d->imm;
+      DO_DISS(statusMsg << "add SP,#0x" << Base::HEX2 << rb << endl);
+      ra=read_register(13);
+      rc=ra+rb;
+      write_register(13,rc);
+      return(0);
+
+    //AND
+    case Op_and:
+      rd=d->rd;
+      rm=d->rm;
+      DO_DISS(statusMsg << "ands r" << dec << rd << ",r" << dec << rm << endl);
+      ra=read_register(rd);
+      rb=read_register(rm);
+      rc=ra&rb;
+      write_register(rd,rc);
+      do_nzflag(rc);
+      return(0);
+
+    //ASR(1) two register immediate
+    case Op_asr1:
+      rd=d->rd;
+      rm=d->rm;
+      rb=d->imm;
+      DO_DISS(statusMsg << "asrs r" << dec << rd << ",r" << dec << rm << ",#0x" << Base::HEX2 << rb << endl);
+      rc=read_register(rm);
+      if(rb==0)
+      {
+        if(rc&0x80000000)
+        {
+          do_cflag_bit(1);
+          rc=~0;
+        }
+        else
+        {
+          do_cflag_bit(0);
+          rc=0;
+        }
+      }
+      else
+      {
+        do_cflag_bit(rc&(1<<(rb-1)));
+        ra=rc&0x80000000;
+        rc>>=rb;
+        if(ra) //asr, sign is shifted in
+        {
+          rc|=(~0)<<(32-rb);
+        }
+      }
+      write_register(rd,rc);
+      do_nzflag(rc);
+      return(0);
+
+    //ASR(2) two register
+    case Op_asr2:
+      rd=d->rd;
+      rs=d->rn;
+      DO_DISS(statusMsg << "asrs r" << dec << rd << ",r" << dec << rs << endl);
+      rc=read_register(rd);
+      rb=read_register(rs);
+      rb&=0xFF;
+      if(rb==0)
+      {
+      }
+      else if(rb<32)
+      {
+        do_cflag_bit(rc&(1<<(rb-1)));
+        ra=rc&0x80000000;
+        rc>>=rb;
+        if(ra) //asr, sign is shifted in
+        {
+          rc|=(~0)<<(32-rb);
+        }
+      }
+      else
+      {
+        if(rc&0x80000000)
+        {
+          do_cflag_bit(1);
+          rc=(~0);
+        }
+        else
+        {
+          do_cflag_bit(0);
+          rc=0;
+        }
+      }
+      write_register(rd,rc);
+      do_nzflag(rc);
+      return(0);
+
+    //B(1) conditional branch
+    case Op_b1:
+      rb=d->imm+pc;
+      switch(d->rd)
+      {
+        case 0x0: //b eq  z set
+          DO_DISS(statusMsg << "beq 0x" << Base::HEX8 << (rb-3) << endl);
+          if(flagZ())
+          {
+            write_register(15,rb);
+          }
+          return(0);
+
+        case 0x1: //b ne  z clear
+          DO_DISS(statusMsg << "bne 0x" << Base::HEX8 << (rb-3) << endl);
+          if(!flagZ())
+          {
+            write_register(15,rb);
+          }
+          return(0);
+
+        case 0x2: //b cs c set
+          DO_DISS(statusMsg << "bcs 0x" << Base::HEX8 << (rb-3) << endl);
+          if(flagC())
+          {
+            write_register(15,rb);
+          }
+          return(0);
+
+        case 0x3: //b cc c clear
+          DO_DISS(statusMsg << "bcc 0x" << Base::HEX8 << (rb-3) << endl);
+          if(!flagC())
+          {
+            write_register(15,rb);
+          }
+          return(0);
+
+        case 0x4: //b mi n set
+          DO_DISS(statusMsg << "bmi 0x" << Base::HEX8 << (rb-3) << endl);
+          if(flagN())
+          {
+            write_register(15,rb);
+          }
+          return(0);
+
+        case 0x5: //b pl n clear
+          DO_DISS(statusMsg << "bpl 0x" << Base::HEX8 << (rb-3) << endl);
+          if(!flagN())
+          {
+            write_register(15,rb);
+          }
+          return(0);
+
+        case 0x6: //b vs v set
+          DO_DISS(statusMsg << "bvs 0x" << Base::HEX8 << (rb-3) << endl);
+          if(flagV())
+          {
+            write_register(15,rb);
+          }
+          return(0);
+
+        case 0x7: //b vc v clear
+          DO_DISS(statusMsg << "bvc 0x" << Base::HEX8 << (rb-3) << endl);
+          if(!flagV())
+          {
+            write_register(15,rb);
+          }
+          return(0);
+
+        case 0x8: //b hi c set z clear
+          DO_DISS(statusMsg << "bhi 0x" << Base::HEX8 << (rb-3) << endl);
+          if(flagC()&&!flagZ())
+          {
+            write_register(15,rb);
+          }
+          return(0);
+
+        case 0x9: //b ls c clear or z set
+          DO_DISS(statusMsg << "bls 0x" << Base::HEX8 << (rb-3) << endl);
+          if(flagZ()||!flagC())
+          {
+            write_register(15,rb);
+          }
+          return(0);
+
+        case 0xA: //b ge N == V
+          DO_DISS(statusMsg << "bge 0x" << Base::HEX8 << (rb-3) << endl);
+          if(flagN()==flagV())
+          {
+            write_register(15,rb);
+          }
+          return(0);
+
+        case 0xB: //b lt N != V
+          DO_DISS(statusMsg << "blt 0x" << Base::HEX8 << (rb-3) << endl);
+          if(flagN()!=flagV())
+          {
+            write_register(15,rb);
+          }
+          return(0);
+
+        case 0xC: //b gt Z==0 and N == V
+          DO_DISS(statusMsg << "bgt 0x" << Base::HEX8 << (rb-3) << endl);
+          if(!flagZ()&&(flagN()==flagV()))
+          {
+            write_register(15,rb);
+          }
+          return(0);
+
+        case 0xD: //b le Z==1 or N != V
+          DO_DISS(statusMsg << "ble 0x" << Base::HEX8 << (rb-3) << endl);
+          if(flagZ()||(flagN()!=flagV()))
+          {
+            write_register(15,rb);
+          }
+          return(0);
+      }
+      return(0);
+
+    //B(2) unconditional branch
+    case Op_b2:
+      rb=d->imm+pc;
+      DO_DISS(statusMsg << "B 0x" << Base::HEX8 << (rb-3) << endl);
+      write_register(15,rb);
+      return(0);
+
+    //BIC
+    case Op_bic:
+      rd=d->rd;
+      rm=d->rm;
+      DO_DISS(statusMsg << "bics r" << dec << rd << ",r" << dec << rm << endl);
+      ra=read_register(rd);
+      rb=read_register(rm);
+      rc=ra&(~rb);
+      write_register(rd,rc);
+      do_nzflag(rc);
+      return(0);
+
+    //BKPT
+    case Op_bkpt:
+      rb=d->imm;
+      statusMsg << "bkpt 0x" << Base::HEX2 << rb << endl;
+      return(1);
+
+    //BL/BLX(1) H=b10
+    case Op_bl_prefix:
+      DO_DISS(statusMsg << endl);
+      halfadd=d->inst;
+      return(0);
+
+    //BL/BLX(1) H=b11
+    case Op_bl:
+      //branch to thumb
+      rb=halfadd&((1<<11)-1);
+      if(rb&1<<10)
+        rb|=(~((1<<11)-1)); //sign extend
+      rb<<=11;
+      rb|=d->imm;
+      rb<<=1;
+      rb+=pc;
+      DO_DISS(statusMsg << "bl 0x" << Base::HEX8 << (rb-3) << endl);
+      write_register(14,pc-2);
+      write_register(15,rb);
+      return(0);
+
+    //BL/BLX(1) H=b01
+    case Op_blx1:
+      // fxq: this should exit the code without having to detect it
+      return(1);
+
+    //BLX(2)
+    case Op_blx2:
+      rm=d->rm;
+      DO_DISS(statusMsg << "blx r" << dec << rm << endl);
+      rc=read_register(rm);
+      rc+=2;
+      if(rc&1)
+      {
+        write_register(14,pc-2);
+        write_register(15,rc);
+        return(0);
+      }
+      else
+      {
+        // fxq: this could serve as exit code
+        return(1);
+      }
+
+    //BX
+    case Op_bx:
+      rm=d->rm;
+      DO_DISS(statusMsg << "bx r" << dec << rm << endl);
+      rc=read_register(rm);
+      rc+=2;
+      if(rc&1)
+      {
+        write_register(15,rc);
+        return(0);
+      }
+      else
+      {
+        // fxq: or maybe this one??
+        return(1);
+      }
+
+    //CMN
+    case Op_cmn:
+      rn=d->rn;
+      rm=d->rm;
+      DO_DISS(statusMsg << "cmns r" << dec << rn << ",r" << dec << rm << endl);
+      ra=read_register(rn);
+      rb=read_register(rm);
+      rc=ra+rb;
+      do_nzflag(rc);
+      do_cflag(ra,rb,0);
+      do_add_vflag(ra,rb,rc);
+      return(0);
+
+    //CMP(1) compare immediate
+    case Op_cmp1:
+      rb=d->imm;
+      rn=d->rn;
+      DO_DISS(statusMsg << "cmp r" << dec << rn << ",#0x" << Base::HEX2 << rb << endl);
+      ra=read_register(rn);
+      rc=ra-rb;
+      do_nzflag(rc);
+      do_cflag(ra,~rb,1);
+      do_sub_vflag(ra,rb,rc);
+      return(0);
+
+    //CMP(2) compare register
+    case Op_cmp2:
+    //CMP(3) compare high register
+    case Op_cmp3:
+      rn=d->rn;
+      rm=d->rm;
+      DO_DISS(statusMsg << "cmps r" << dec << rn << ",r" << dec << rm << endl);
+      ra=read_register(rn);
+      rb=read_register(rm);
+      rc=ra-rb;
+      do_nzflag(rc);
+      do_cflag(ra,~rb,1);
+      do_sub_vflag(ra,rb,rc);
+      return(0);
+
+    //CPS
+    case Op_cps:
+      DO_DISS(statusMsg << "cps TODO" << endl);
+      return(1);
+
+    //CPY copy high register
+    case Op_cpy:
+      rd=d->rd;
+      rm=d->rm;
+      DO_DISS(statusMsg << "cpy r" << dec << rd << ",r" << dec << rm << endl);
+      rc=read_register(rm);
+      write_register(rd,rc);
+      return(0);
+
+    //EOR
+    case Op_eor:
+      rd=d->rd;
+      rm=d->rm;
+      DO_DISS(statusMsg << "eors r" << dec << rd << ",r" << dec << rm << endl);
+      ra=read_register(rd);
+      rb=read_register(rm);
+      rc=ra^rb;
+      write_register(rd,rc);
+      do_nzflag(rc);
+      return(0);
+
+    //LDMIA
+    case Op_ldmia:
+      rn=d->rn;
+    #if defined(THUMB_DISS)
+      statusMsg << "ldmia r" << dec << rn << "!,{";
+      for(ra=0,rb=0x01,rc=0;rb;rb=(rb<<1)&0xFF,ra++)
+      {
+        if(d->imm&rb)
+        {
+          if(rc) statusMsg << ",";
+          statusMsg << "r" << dec << ra;
+          rc++;
+        }
+      }
+      statusMsg << "}" << endl;
+    #endif
+      sp=read_register(rn);
+      for(ra=0,rb=0x01;rb;rb=(rb<<1)&0xFF,ra++)
+      {
+        if(d->imm&rb)
+        {
+          write_register(ra,read32(sp));
+          sp+=4;
+        }
+      }
+      write_register(rn,sp);
+      return(0);
+
+    //LDR(1) two register immediate
+    case Op_ldr1:
+      rd=d->rd;
+      rn=d->rn;
+      rb=d->imm;
+      DO_DISS(statusMsg << "ldr r" << dec << rd << ",[r" << dec << rn << ",#0x" << Base::HEX2 << rb << "]" << endl);
+      rb=read_register(rn)+rb;
+      rc=read32(rb);
+      write_register(rd,rc);
+      return(0);
+
+    //LDR(2) three register
+    case Op_ldr2:
+      rd=d->rd;
+      rn=d->rn;
+      rm=d->rm;
+      DO_DISS(statusMsg << "ldr r" << dec << rd << ",[r" << dec << rn << ",r" << dec << "]" << endl);
+      rb=read_register(rn)+read_register(rm);
+      rc=read32(rb);
+      write_register(rd,rc);
+      return(0);
+
+    //LDR(3)
+    case Op_ldr3:
+      rb=d->imm;
+      rd=d->rd;
+      DO_DISS(statusMsg << "ldr r" << dec << rd << ",[PC+#0x" << Base::HEX2 << rb << "] ");
+      ra=read_register(15);
+      ra&=~3;
+      rb+=ra;
+      DO_DISS(statusMsg << ";@ 0x" << Base::HEX2 << rb << endl);
+      rc=read32(rb);
+      write_register(rd,rc);
+      return(0);
+
+    //LDR(4)
+    case Op_ldr4:
+      rb=d->imm;
+      rd=d->rd;
+      DO_DISS(statusMsg << "ldr r" << dec << rd << ",[SP+#0x" << Base::HEX2 << rb << "]" << endl);
+      ra=read_register(13);
+      rb+=ra;
+      rc=read32(rb);
+      write_register(rd,rc);
+      return(0);
+
+    //LDRB(1)
+    case Op_ldrb1:
+      rd=d->rd;
+      rn=d->rn;
+      rb=d->imm;
+      DO_DISS(statusMsg << "ldrb r" << dec << rd << ",[r" << dec << rn << ",#0x" << Base::HEX2 << rb << "]" << endl);
+      rb=read_register(rn)+rb;
+      rc=read16(rb&(~1));
+      if(rb&1)
+      {
+        rc>>=8;
+      }
+      write_register(rd,rc&0xFF);
+      return(0);
+
+    //LDRB(2)
+    case Op_ldrb2:
+      rd=d->rd;
+      rn=d->rn;
+      rm=d->rm;
+      DO_DISS(statusMsg << "ldrb r" << dec << rd << ",[r" << dec << rn << ",r" << dec << rm << "]" << endl);
+      rb=read_register(rn)+read_register(rm);
+      rc=read16(rb&(~1));
+      if(rb&1)
+      {
+        rc>>=8;
+      }
+      write_register(rd,rc&0xFF);
+      return(0);
+
+    //LDRH(1)
+    case Op_ldrh1:
+      rd=d->rd;
+      rn=d->rn;
+      rb=d->imm;
+      DO_DISS(statusMsg << "ldrh r" << dec << rd << ",[r" << dec << rn << ",#0x" << Base::HEX2 << rb << "]" << endl);
+      rb=read_register(rn)+rb;
+      rc=read16(rb);
+      write_register(rd,rc&0xFFFF);
+      return(0);
+
+    //LDRH(2)
+    case Op_ldrh2:
+      rd=d->rd;
+      rn=d->rn;
+      rm=d->rm;
+      DO_DISS(statusMsg << "ldrh r" << dec << rd << ",[r" << dec << rn << ",r" << dec << rm << "]" << endl);
+      rb=read_register(rn)+read_register(rm);
+      rc=read16(rb);
+      write_register(rd,rc&0xFFFF);
+      return(0);
+
+    //LDRSB
+    case Op_ldrsb:
+      rd=d->rd;
+      rn=d->rn;
+      rm=d->rm;
+      DO_DISS(statusMsg << "ldrsb r" << dec << rd << ",[r" << dec << rn << ",r" << dec << rm << "]" << endl);
+      rb=read_register(rn)+read_register(rm);
+      rc=read16(rb&(~1));
+      if(rb&1)
+      {
+        rc>>=8;
+      }
+      rc&=0xFF;
+      if(rc&0x80) rc|=((~0)<<8);
+      write_register(rd,rc);
+      return(0);
+
+    //LDRSH
+    case Op_ldrsh:
+      rd=d->rd;
+      rn=d->rn;
+      rm=d->rm;
+      DO_DISS(statusMsg << "ldrsh r" << dec << rd << ",[r" << dec << rn << ",r" << dec << rm << "]" << endl);
+      rb=read_register(rn)+read_register(rm);
+      rc=read16(rb);
+      rc&=0xFFFF;
+      if(rc&0x8000) rc|=((~0)<<16);
+      write_register(rd,rc);
+      return(0);
+
+    //LSL(1)
+    case Op_lsl1:
+      rd=d->rd;
+      rm=d->rm;
+      rb=d->imm;
+      DO_DISS(statusMsg << "lsls r" << dec << rd << ",r" << dec << rm << ",#0x" << Base::HEX2 << rb << endl);
+      rc=read_register(rm);
+      if(rb==0)
+      {
+        //if immed_5 == 0
+        //C unnaffected
+        //result not shifted
+      }
+      else
+      {
+        //else immed_5 > 0
+        do_cflag_bit(rc&(1<<(32-rb)));
+        rc<<=rb;
+      }
+      write_register(rd,rc);
+      do_nzflag(rc);
+      return(0);
+
+    //LSL(2) two register
+    case Op_lsl2:
+      rd=d->rd;
+      rs=d->rn;
+      DO_DISS(statusMsg << "lsls r" << dec << rd << ",r" << dec << rs << endl);
+      rc=read_register(rd);
+      rb=read_register(rs);
+      rb&=0xFF;
+      if(rb==0)
+      {
+      }
+      else if(rb<32)
+      {
+        do_cflag_bit(rc&(1<<(32-rb)));
+        rc<<=rb;
+      }
+      else if(rb==32)
+      {
+        do_cflag_bit(rc&1);
+        rc=0;
+      }
+      else
+      {
+        do_cflag_bit(0);
+        rc=0;
+      }
+      write_register(rd,rc);
+      do_nzflag(rc);
+      return(0);
+
+    //LSR(1) two register immediate
+    case Op_lsr1:
+      rd=d->rd;
+      rm=d->rm;
+      rb=d->imm;
+      DO_DISS(statusMsg << "lsrs r" << dec << rd << ",r" << dec << rm << ",#0x" << Base::HEX2 << rb << endl);
+      rc=read_register(rm);
+      if(rb==0)
+      {
+        do_cflag_bit(rc&0x80000000);
+        rc=0;
+      }
+      else
+      {
+        do_cflag_bit(rc&(1<<(rb-1)));
+        rc>>=rb;
+      }
+      write_register(rd,rc);
+      do_nzflag(rc);
+      return(0);
+
+    //LSR(2) two register
+    case Op_lsr2:
+      rd=d->rd;
+      rs=d->rn;
+      DO_DISS(statusMsg << "lsrs r" << dec << rd << ",r" << dec << rs << endl);
+      rc=read_register(rd);
+      rb=read_register(rs);
+      rb&=0xFF;
+      if(rb==0)
+      {
+      }
+      else if(rb<32)
+      {
+        do_cflag_bit(rc&(1<<(32-rb)));
+        rc>>=rb;
+      }
+      else if(rb==32)
+      {
+        do_cflag_bit(rc&0x80000000);
+        rc=0;
+      }
+      else
+      {
+        do_cflag_bit(0);
+        rc=0;
+      }
+      write_register(rd,rc);
+      do_nzflag(rc);
+      return(0);
+
+    //MOV(1) immediate
+    case Op_mov1:
+      rb=d->imm;
+      rd=d->rd;
+      DO_DISS(statusMsg << "movs r" << dec << rd << ",#0x" << Base::HEX2 << rb << endl);
+      write_register(rd,rb);
+      do_nzflag(rb);
+      return(0);
+
+    //MOV(2) two low registers
+    case Op_mov2:
+      rd=d->rd;
+      rn=d->rn;
+      DO_DISS(statusMsg << "movs r" << dec << rd << ",r" << dec << rn << endl);
+      rc=read_register(rn);
+      write_register(rd,rc);
+      do_nzflag(rc);
+      do_cflag_bit(0);
+      do_vflag_bit(0);
+      return(0);
+
+    //MOV(3)
+    case Op_mov3:
+      rd=d->rd;
+      rm=d->rm;
+      DO_DISS(statusMsg << "mov r" << dec << rd << ",r" << dec << rm << endl);
+      rc=read_register(rm);
+      if (rd==15) rc+=2; // fxq fix for MOV R15
+      write_register(rd,rc);
+      return(0);
+
+    //MUL
+    case Op_mul:
+      rd=d->rd;
+      rm=d->rm;
+      DO_DISS(statusMsg << "muls r" << dec << rd << ",r" << dec << rm << endl);
+      ra=read_register(rd);
+      rb=read_register(rm);
+      rc=ra*rb;
+      write_register(rd,rc);
+      do_nzflag(rc);
+      return(0);
+
+    //MVN
+    case Op_mvn:
+      rd=d->rd;
+      rm=d->rm;
+      DO_DISS(statusMsg << "mvns r" << dec << rd << ",r" << dec << rm << endl);
+      ra=read_register(rm);
+      rc=(~ra);
+      write_register(rd,rc);
+      do_nzflag(rc);
+      return(0);
+
+    //NEG
+    case Op_neg:
+      rd=d->rd;
+      rm=d->rm;
+      DO_DISS(statusMsg << "negs r" << dec << rd << ",r" << dec << rm << endl);
+      ra=read_register(rm);
+      rc=0-ra;
+      write_register(rd,rc);
+      do_nzflag(rc);
+      do_cflag(0,~ra,1);
+      do_sub_vflag(0,ra,rc);
+      return(0);
+
+    //ORR
+    case Op_orr:
+      rd=d->rd;
+      rm=d->rm;
+      DO_DISS(statusMsg << "orrs r" << dec << rd << ",r" << dec << rm << endl);
+      ra=read_register(rd);
+      rb=read_register(rm);
+      rc=ra|rb;
+      write_register(rd,rc);
+      do_nzflag(rc);
+      return(0);
+
+    //POP
+    case Op_pop:
+    #if defined(THUMB_DISS)
+      statusMsg << "pop {";
+      for(ra=0,rb=0x01,rc=0;rb;rb=(rb<<1)&0xFF,ra++)
+      {
+        if(d->imm&rb)
+        {
+          if(rc) statusMsg << ",";
+          statusMsg << "r" << dec << ra;
+          rc++;
+        }
+      }
+      if(d->imm&0x100)
+      {
+        if(rc) statusMsg << ",";
+        statusMsg << "pc";
+      }
+      statusMsg << "}" << endl;
+    #endif
+
+      sp=read_register(13);
+      for(ra=0,rb=0x01;rb;rb=(rb<<1)&0xFF,ra++)
+      {
+        if(d->imm&rb)
+        {
+          write_register(ra,read32(sp));
+          sp+=4;
+        }
+      }
+      if(d->imm&0x100)
+      {
+        rc=read32(sp);
+        rc+=2;
+        write_register(15,rc);
+        sp+=4;
+      }
+      write_register(13,sp);
+      return(0);
+
+    //PUSH
+    case Op_push:
+    #if defined(THUMB_DISS)
+      statusMsg << "push {";
+      for(ra=0,rb=0x01,rc=0;rb;rb=(rb<<1)&0xFF,ra++)
+      {
+        if(d->imm&rb)
+        {
+          if(rc) statusMsg << ",";
+          statusMsg << "r" << dec << ra;
+          rc++;
+        }
+      }
+      if(d->imm&0x100)
+      {
+        if(rc) statusMsg << ",";
+        statusMsg << "lr";
+      }
+      statusMsg << "}" << endl;
+    #endif
+
+      sp=read_register(13);
+      for(ra=0,rb=0x01,rc=0;rb;rb=(rb<<1)&0xFF,ra++)
+      {
+        if(d->imm&rb)
+        {
+          rc++;
+        }
+      }
+      if(d->imm&0x100) rc++;
+      rc<<=2;
+      sp-=rc;
+      rd=sp;
+      for(ra=0,rb=0x01;rb;rb=(rb<<1)&0xFF,ra++)
+      {
+        if(d->imm&rb)
+        {
+          write32(rd,read_register(ra));
+          rd+=4;
+        }
+      }
+      if(d->imm&0x100)
+      {
+        write32(rd,read_register(14));
+      }
+      write_register(13,sp);
+      return(0);
+
+    //REV
+    case Op_rev:
+      rd=d->rd;
+      rn=d->rn;
+      DO_DISS(statusMsg << "rev r" << dec << rd << ",r" << dec << rn << endl);
+      ra=read_register(rn);
+      rc =((ra>> 0)&0xFF)<<24;
+      rc|=((ra>> 8)&0xFF)<<16;
+      rc|=((ra>>16)&0xFF)<< 8;
+      rc|=((ra>>24)&0xFF)<< 0;
+      write_register(rd,rc);
+      return(0);
+
+    //REV16
+    case Op_rev16:
+      rd=d->rd;
+      rn=d->rn;
+      DO_DISS(statusMsg << "rev16 r" << dec << rd << ",r" << dec << rn << endl);
+      ra=read_register(rn);
+      rc =((ra>> 0)&0xFF)<< 8;
+      rc|=((ra>> 8)&0xFF)<< 0;
+      rc|=((ra>>16)&0xFF)<<24;
+      rc|=((ra>>24)&0xFF)<<16;
+      write_register(rd,rc);
+      return(0);
+
+    //REVSH
+    case Op_revsh:
+      rd=d->rd;
+      rn=d->rn;
+      DO_DISS(statusMsg << "revsh r" << dec << rd << ",r" << dec << rn << endl);
+      ra=read_register(rn);
+      rc =((ra>> 0)&0xFF)<< 8;
+      rc|=((ra>> 8)&0xFF)<< 0;
+      if(rc&0x8000) rc|=0xFFFF0000;
+      else          rc&=0x0000FFFF;
+      write_register(rd,rc);
+      return(0);
+
+    //ROR
+    case Op_ror:
+      rd=d->rd;
+      rs=d->rn;
+      DO_DISS(statusMsg << "rors r" << dec << rd << ",r" << dec << rs << endl);
+      rc=read_register(rd);
+      ra=read_register(rs);
+      ra&=0xFF;
+      if(ra==0)
+      {
+      }
+      else
+      {
+        ra&=0x1F;
+        if(ra==0)
+        {
+          do_cflag_bit(rc&0x80000000);
+        }
+        else
+        {
+          do_cflag_bit(rc&(1<<(ra-1)));
+          rb=rc<<(32-ra);
+          rc>>=ra;
+          rc|=rb;
+        }
+      }
+      write_register(rd,rc);
+      do_nzflag(rc);
+      return(0);
+
+    //SBC
+    case Op_sbc:
+      rd=d->rd;
+      rm=d->rm;
+      DO_DISS(statusMsg << "sbc r" << dec << rd << ",r" << dec << rm << endl);
+      ra=read_register(rd);
+      rb=read_register(rm);
+      rc=ra-rb;
+      if(!flagC()) rc--;
+      write_register(rd,rc);
+      do_nzflag(rc);
+      do_cflag(ra,rb,0);
+      do_sub_vflag(ra,rb,rc);
+      return(0);
+
+    //SETEND
+    case Op_setend:
+      statusMsg << "setend not implemented" << endl;
+      return(1);
+
+    //STMIA
+    case Op_stmia:
+      rn=d->rn;
+    #if defined(THUMB_DISS)
+      statusMsg << "stmia r" << dec << rn << "!,{";
+      for(ra=0,rb=0x01,rc=0;rb;rb=(rb<<1)&0xFF,ra++)
+      {
+        if(d->imm&rb)
+        {
+          if(rc) statusMsg << ",";
+          statusMsg << "r" << dec << ra;
+          rc++;
+        }
+      }
+      statusMsg << "}" << endl;
+    #endif
+
+      sp=read_register(rn);
+      for(ra=0,rb=0x01;rb;rb=(rb<<1)&0xFF,ra++)
+      {
+        if(d->imm&rb)
+        {
+          write32(sp,read_register(ra));
+          sp+=4;
+        }
+      }
+      write_register(rn,sp);
+      return(0);
+
+    //STR(1)
+    case Op_str1:
+      rd=d->rd;
+      rn=d->rn;
+      rb=d->imm;
+      DO_DISS(statusMsg << "str r" << dec << rd << ",[r" << dec << rn << ",#0x" << Base::HEX2 << rb << "]" << endl);
+      rb=read_register(rn)+rb;
+      rc=read_register(rd);
+      write32(rb,rc);
+      return(0);
+
+    //STR(2)
+    case Op_str2:
+      rd=d->rd;
+      rn=d->rn;
+      rm=d->rm;
+      DO_DISS(statusMsg << "str r" << dec << rd << ",[r" << dec << rn << ",r" << dec << rm << "]" << endl);
+      rb=read_register(rn)+read_register(rm);
+      rc=read_register(rd);
+      write32(rb,rc);
+      return(0);
+
+    //STR(3)
+    case Op_str3:
+      rb=d->imm;
+      rd=d->rd;
+      DO_DISS(statusMsg << "str r" << dec << rd << ",[SP,#0x" << Base::HEX2 << rb << "]" << endl);
+      rb=read_register(13)+rb;
+      rc=read_register(rd);
+      write32(rb,rc);
+      return(0);
+
+    //STRB(1)
+    case Op_strb1:
+      rd=d->rd;
+      rn=d->rn;
+      rb=d->imm;
+      DO_DISS(statusMsg << "strb r" << dec << rd << ",[r" << dec << rn << ",#0x" << Base::HEX8 << rb << "]" << endl);
+      rb=read_register(rn)+rb;
+      rc=read_register(rd);
+      ra=read16(rb&(~1));
+      if(rb&1)
+      {
+        ra&=0x00FF;
+        ra|=rc<<8;
+      }
+      else
+      {
+        ra&=0xFF00;
+        ra|=rc&0x00FF;
+      }
+      write16(rb&(~1),ra&0xFFFF);
+      return(0);
+
+    //STRB(2)
+    case Op_strb2:
+      rd=d->rd;
+      rn=d->rn;
+      rm=d->rm;
+      DO_DISS(statusMsg << "strb r" << dec << rd << ",[r" << dec << rn << ",r" << rm << "]" << endl);
+      rb=read_register(rn)+read_register(rm);
+      rc=read_register(rd);
+      ra=read16(rb&(~1));
+      if(rb&1)
+      {
+        ra&=0x00FF;
+        ra|=rc<<8;
+      }
+      else
+      {
+        ra&=0xFF00;
+        ra|=rc&0x00FF;
+      }
+      write16(rb&(~1),ra&0xFFFF);
+      return(0);
+
+    //STRH(1)
+    case Op_strh1:
+      rd=d->rd;
+      rn=d->rn;
+      rb=d->imm;
+      DO_DISS(statusMsg << "strh r" << dec << rd << ",[r" << dec << rn << ",#0x" << Base::HEX2 << rb << "]" << endl);
+      rb=read_register(rn)+rb;
+      rc=read_register(rd);
+      write16(rb,rc&0xFFFF);
+      return(0);
+
+    //STRH(2)
+    case Op_strh2:
+      rd=d->rd;
+      rn=d->rn;
+      rm=d->rm;
+      DO_DISS(statusMsg << "strh r" << dec << rd << ",[r" << dec << rn << ",r" << dec << rm << "]" << endl);
+      rb=read_register(rn)+read_register(rm);
+      rc=read_register(rd);
+      write16(rb,rc&0xFFFF);
+      return(0);
+
+    //SUB(1)
+    case Op_sub1:
+      rd=d->rd;
+      rn=d->rn;
+      rb=d->imm;
+      DO_DISS(statusMsg << "subs r" << dec << rd << ",r" << dec << rn << ",#0x" << Base::HEX2 << rb << endl);
+      ra=read_register(rn);
+      rc=ra-rb;
+      write_register(rd,rc);
+      do_nzflag(rc);
+      do_cflag(ra,~rb,1);
+      do_sub_vflag(ra,rb,rc);
+      return(0);
+
+    //SUB(2)
+    case Op_sub2:
+      rb=d->imm;
+      rd=d->rd;
+      DO_DISS(statusMsg << "subs r" << dec << rd << ",#0x" << Base::HEX2 << rb << endl);
+      ra=read_register(rd);
+      rc=ra-rb;
+      write_register(rd,rc);
+      do_nzflag(rc);
+      do_cflag(ra,~rb,1);
+      do_sub_vflag(ra,rb,rc);
+      return(0);
+
+    //SUB(3)
+    case Op_sub3:
+      rd=d->rd;
+      rn=d->rn;
+      rm=d->rm;
+      DO_DISS(statusMsg << "subs r" << dec << rd << ",r" << dec << rn << ",r" << dec << rm << endl);
+      ra=read_register(rn);
+      rb=read_register(rm);
+      rc=ra-rb;
+      write_register(rd,rc);
+      do_nzflag(rc);
+      do_cflag(ra,~rb,1);
+      do_sub_vflag(ra,rb,rc);
+      return(0);
+
+    //SUB(4)
+    case Op_sub4:
+      rb=d->imm;
+      DO_DISS(statusMsg << "sub SP,#0x" << Base::HEX2 << rb << endl);
+      ra=read_register(13);
+      ra-=rb;
+      write_register(13,ra);
+      return(0);
+
+    //SWI
+    case Op_swi:
+      rb=d->imm;
+      DO_DISS(statusMsg << "swi 0x" << Base::HEX2 << rb << endl);
+      statusMsg << endl << endl << "swi 0x" << Base::HEX2 << rb << endl;
+      return(1);
+
+    //SXTB
+    case Op_sxtb:
+      rd=d->rd;
+      rm=d->rm;
+      DO_DISS(statusMsg << "sxtb r" << dec << rd << ",r" << dec << rm << endl);
+      ra=read_register(rm);
+      rc=ra&0xFF;
+      if(rc&0x80) rc|=(~0)<<8;
+      write_register(rd,rc);
+      return(0);
+
+    //SXTH
+    case Op_sxth:
+      rd=d->rd;
+      rm=d->rm;
+      DO_DISS(statusMsg << "sxth r" << dec << rd << ",r" << dec << rm << endl);
+      ra=read_register(rm);
+      rc=ra&0xFFFF;
+      if(rc&0x8000) rc|=(~0)<<16;
+      write_register(rd,rc);
+      return(0);
+
+    //TST
+    case Op_tst:
+      rn=d->rn;
+      rm=d->rm;
+      DO_DISS(statusMsg << "tst r" << dec << rn << ",r" << dec << rm << endl);
+      ra=read_register(rn);
+      rb=read_register(rm);
+      rc=ra&rb;
+      do_nzflag(rc);
+      return(0);
+
+    //UXTB
+    case Op_uxtb:
+      rd=d->rd;
+      rm=d->rm;
+      DO_DISS(statusMsg << "uxtb r" << dec << rd << ",r" << dec << rm << endl);
+      ra=read_register(rm);
+      rc=ra&0xFF;
+      write_register(rd,rc);
+      return(0);
+
+    //UXTH
+    case Op_uxth:
+      rd=d->rd;
+      rm=d->rm;
+      DO_DISS(statusMsg << "uxth r" << dec << rd << ",r" << dec << rm << endl);
+      ra=read_register(rm);
+      rc=ra&0xFFFF;
+      write_register(rd,rc);
+      return(0);
   }
 
-  statusMsg << "invalid instruction " << Base::HEX8 << pc << " " << Base::HEX4 << inst << endl;
+  statusMsg << "invalid instruction " << Base::HEX8 << pc << " " << Base::HEX4 << d->inst << endl;
   return(1);
 }
 
@@ -1956,11 +2605,14 @@ int Thumbulator::reset ( void )
 {
   //memset(ram,0xFF,sizeof(ram));
   cpsr=CPSR_T|CPSR_I|CPSR_F|MODE_SVC;
-
-  reg_svc[13]=0x40001fb4; //sp
-  reg_svc[14]=0x00000c00; //lr (duz this use odd addrs)
-	reg_sys[15]=0x00000c0b; // entry point of 0xc09+2
-  //  reg_sys[15]+=2;
+  do_nzflag(1);
+  do_cflag_bit(0);
+  do_vflag_bit(0);
+
+  reg_norm[13]=0x40001fb4; //sp
+  reg_norm[14]=0x00000c00; //lr (duz this use odd addrs)
+  reg_norm[15]=0x00000c0b; // entry point of 0xc09+2
+  //  reg_norm[15]+=2;
   mamcr = 0;
 
   // fxq: don't care about below so much (maybe to guess timing???)
@@ -1968,6 +2620,9 @@ int Thumbulator::reset ( void )
   fetches=0;
   reads=0;
   writes=0;
+  armreads=0;
+  armwrites=0;
+  armcycles=0;
 
   statusMsg.str("");
 
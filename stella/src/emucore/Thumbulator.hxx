@@ -89,6 +89,20 @@ class Thumbulator
     */
     static void trapFatalErrors(bool enable) { trapOnFatal = enable; }
 
+    /**
+      Statistics for the code executed by the last call to run().  The
+      cycle count uses the ARM7TDMI instruction timings, but leaves out
+      any flash or memory wait states.
+    */
+    struct Stats
+    {
+      uInt32 instructions;  // Thumb instructions executed
+      uInt32 reads;         // data reads (instruction fetches not included)
+      uInt32 writes;        // data writes
+      uInt32 cycles;        // ARM clock cycles
+    };
+    Stats stats() const;
+
   private:
     uInt32 read_register ( uInt32 reg );
     uInt32 write_register ( uInt32 reg, uInt32 data );
@@ -99,23 +113,60 @@ class Thumbulator
     void write16 ( uInt32 addr, uInt32 data );
     void write32 ( uInt32 addr, uInt32 data );
 
-    void do_zflag ( uInt32 x );
-    void do_nflag ( uInt32 x );
+    void do_nzflag ( uInt32 x );
     void do_cflag ( uInt32 a, uInt32 b, uInt32 c );
     void do_sub_vflag ( uInt32 a, uInt32 b, uInt32 c );
     void do_add_vflag ( uInt32 a, uInt32 b, uInt32 c );
     void do_cflag_bit ( uInt32 x );
     void do_vflag_bit ( uInt32 x );
 
+    bool flagN ( void ) const { return (nzValue&0x80000000)!=0; }
+    bool flagZ ( void ) const { return nzValue==0; }
+    bool flagC ( void ) const
+      { return (((uInt64)cflagA+cflagB+cflagIn)>>32)!=0; }
+    bool flagV ( void ) const
+      { return ((~(vflagA^vflagB))&(vflagB^vflagResult)&0x80000000)!=0; }
+    uInt32 read_cpsr ( void ) const;
+
     // Throw a string exception containing an error referencing the given
     // message and variables
     // Note that the return value is never used in these methods
     int fatalError(const char* opcode, uInt32 v1, const char* msg);
     int fatalError(const char* opcode, uInt32 v1, uInt32 v2, const char* msg);
 
+    // Instructions decoded into an opcode and their operand fields
+    enum Op {
+      Op_undecoded,
+      Op_adc, Op_add1, Op_add2, Op_add3, Op_add4, Op_add5, Op_add6, Op_add7,
+      Op_and, Op_asr1, Op_asr2, Op_b1, Op_b2, Op_bic, Op_bkpt,
+      Op_bl_prefix, Op_bl, Op_blx1, Op_blx2, Op_bx,
+      Op_cmn, Op_cmp1, Op_cmp2, Op_cmp3, Op_cps, Op_cpy, Op_eor,
+      Op_ldmia, Op_ldr1, Op_ldr2, Op_ldr3, Op_ldr4, Op_ldrb1, Op_ldrb2,
+      Op_ldrh1, Op_ldrh2, Op_ldrsb, Op_ldrsh, Op_lsl1, Op_lsl2, Op_lsr1, Op_lsr2,
+      Op_mov1, Op_mov2, Op_mov3, Op_mul, Op_mvn, Op_neg, Op_orr, Op_pop, Op_push,
+      Op_rev, Op_rev16, Op_revsh, Op_ror, Op_sbc, Op_setend, Op_stmia,
+      Op_str1, Op_str2, Op_str3, Op_strb1, Op_strb2, Op_strh1, Op_strh2,
+      Op_sub1, Op_sub2, Op_sub3, Op_sub4, Op_swi,
+      Op_sxtb, Op_sxth, Op_tst, Op_uxtb, Op_uxth, Op_invalid
+    };
+    struct Decoded
+    {
+      uInt8 op;
+      uInt8 rd, rn, rm;   // rn also holds rs, and rd the branch condition
+      uInt16 inst;
+      uInt16 count;       // instructions left in the straight-line run (ROM)
+      uInt32 imm;         // immediate, offset or register list
+      uInt8 reads, writes, cycles;  // see decode_timing()
+    };
+
+    void decode ( uInt32 inst, Decoded& d );
+    void decode_timing ( Decoded& d );
+    bool ends_trace ( const Decoded& d );
+    void translate ( uInt32 index );
     void dump_counters ( void );
     void dump_regs( void );
-    int execute ( void );
+    int execute_trace ( void );
+    int execute ( const Decoded* d );
     int reset ( void );
 
   private:
@@ -125,20 +176,32 @@ class Thumbulator
 
     uInt32 halfadd;
     uInt32 cpsr;
-    //uInt32 reg_usr[16]; //User mode
-    uInt32 reg_sys[16]; //System mode
-    uInt32 reg_svc[16]; //Supervisor mode
-    //uInt32 reg_abt[16]; //Abort mode
-    //uInt32 reg_und[16]; //Undefined mode
-    //uInt32 reg_irq[16]; //Interrupt mode
-    //uInt32 reg_fiq[16]; //Fast Interrupt mode
+    // The NZCV bits of cpsr aren't used; instead the values each flag
+    // was last computed from are kept, see read_cpsr()
+    uInt32 nzValue;
+    uInt32 cflagA, cflagB, cflagIn;
+    uInt32 vflagA, vflagB, vflagResult;
+    // The code only ever runs in supervisor mode, which shares R0-R12 and
+    // the PC with the other modes, so no banked copies are kept
+    uInt32 reg_norm[16];
     uInt32 mamcr;
 
+    // Memory traffic is only counted in instrumented builds
     uInt64 instructions;
     uInt64 fetches;
     uInt64 reads;
     uInt64 writes;
 
+    // The traffic and time the instructions take on real hardware, which
+    // are always counted (see stats())
+    uInt32 armreads;
+    uInt32 armwrites;
+    uInt32 armcycles;
+
+    // Decoded instructions for each halfword of ROM, filled in on first use;
+    // consecutive entries form the traces run by execute_trace()
+    Decoded* decodeCache;
+
     ostringstream statusMsg;
 
     static bool trapOnFatal;
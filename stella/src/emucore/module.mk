@@ -2,6 +2,7 @@ MODULE := src/emucore
 
 MODULE_OBJS := \
 	src/emucore/AtariVox.o \
+	src/emucore/BlepSynth.o \
 	src/emucore/Booster.o \
 	src/emucore/Cart.o \
 	src/emucore/Cart0840.o \
@@ -15,6 +16,7 @@ MODULE_OBJS := \
 	src/emucore/CartCM.o \
 	src/emucore/CartCTY.o \
 	src/emucore/CartCV.o \
+	src/emucore/CartDetector.o \
 	src/emucore/CartDPC.o \
 	src/emucore/CartDPCPlus.o \
 	src/emucore/CartE0.o \
@@ -58,9 +60,11 @@ MODULE_OBJS := \
 	src/emucore/MD5.o \
 	src/emucore/OSystem.o \
 	src/emucore/Paddles.o \
+	src/emucore/Profiler.o \
 	src/emucore/Props.o \
 	src/emucore/PropsSet.o \
 	src/emucore/Random.o \
+	src/emucore/RomCache.o \
 	src/emucore/SaveKey.o \
 	src/emucore/Serializer.o \
 	src/emucore/Settings.o \
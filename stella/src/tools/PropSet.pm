@@ -143,21 +143,18 @@ sub num_prop_types {
   return keys( %prop_type );
 }
 
-# Convert a properties set into a C++ compatible string
-sub build_prop_string {
+# Blank out the properties which have their default value, since these
+# don't need to be stored in the C++ database
+sub strip_prop_defaults {
   my @array = @_;
-  my $result = "  { ";
   my @items = ();
   for (my $i = 0; $i < @array; $i++) {
     if($prop_defaults[$i] ne $array[$i]) {
-      push(@items, "\"$array[$i]\"");
+      push(@items, $array[$i]);
     } else {
-      push(@items, "\"\"");
+      push(@items, "");
     }
   }
 
-  $result .= join(", ", @items);
-  $result .= " }";
-
-  return $result;
+  return @items;
 }
@@ -60,30 +60,184 @@ print OUTFILE "  located in the src/tools directory.  All properties changes\n";
 print OUTFILE "  should be made in stella.pro, and then this file should be\n";
 print OUTFILE "  regenerated and the application recompiled.\n";
 print OUTFILE "*/\n";
-print OUTFILE "\n#define DEF_PROPS_SIZE " . $setsize;
-print OUTFILE "\n\n";
-print OUTFILE "static const char* DefProps[DEF_PROPS_SIZE][" . $typesize . "] = {\n";
+my @md5s = sort keys %propset;
 
-# Walk the hash map and print each item in order of md5sum
-my $idx = 0;
-for my $key ( sort keys %propset )
+# All property values are stored in one block of NUL-terminated strings,
+# with every distinct value present only once, and referred to by offset.
+# The MD5 is only stored in binary form, and the free-text properties
+# (Cartridge.Manufacturer to Cartridge.Note) are stored as offsets.  All
+# remaining properties only ever take a few distinct values, so they're
+# stored as one-byte codes into a table of those values' offsets.
+my $textsize  = 4;
+my $codedsize = $typesize - 1 - $textsize;
+
+my $blob = "";
+my %offset = ();
+sub intern {
+  my $value = $_[0];
+  if (!defined($offset{$value})) {
+    $offset{$value} = length($blob);
+    $blob .= $value . "\0";
+  }
+  return $offset{$value};
+}
+intern("");
+
+my @codes = ( 0 );
+my %code = ( "" => 0 );
+my @text_entries = ();
+my @coded_entries = ();
+for my $key ( @md5s )
 {
-  print OUTFILE PropSet::build_prop_string(@{ $propset{$key} });
+  my @values = PropSet::strip_prop_defaults(@{ $propset{$key} });
+  push(@text_entries, [ map { intern($_) } @values[1 .. $textsize] ]);
 
-  if ($idx+1 < $setsize) {
-    print OUTFILE ", ";
+  my @entry = ();
+  for my $value ( @values[$textsize+1 .. $typesize-1] )
+  {
+    if (!defined($code{$value})) {
+      $code{$value} = @codes;
+      push(@codes, intern($value));
+    }
+    push(@entry, $code{$value});
   }
+  push(@coded_entries, [ @entry ]);
+}
+die "Too many distinct coded property values\n" if (@codes > 256);
+
+# Build a perfect hash over the binary MD5s, using 'hash and displace':
+# the first word of an MD5 selects a bucket, and the bucket's displacement
+# d places each of its keys at slot (word1 + d * (word2 | 1)) % slots,
+# chosen so that no two keys ever share a slot.  Since MD5s are already
+# uniformly distributed, their words can be used directly as hashes.
+my $slots = 1;
+$slots *= 2 while ($slots * 4 < $setsize * 5);  # load factor <= 0.8
+my $buckets = $slots / 4;
+
+my @bucket_keys = ();
+for (my $i = 0; $i < $setsize; $i++)
+{
+  my ($w0, $w1, $w2) = unpack("N3", pack("H32", $md5s[$i]));
+  push(@{ $bucket_keys[$w0 % $buckets] }, [ $i, $w1, $w2 | 1 ]);
+}
+
+my @displacement = (0) x $buckets;
+my @slot = (65535) x $slots;
+my @order = sort { @{ $bucket_keys[$b] || [] } <=> @{ $bucket_keys[$a] || [] } || $a <=> $b }
+            (0 .. $buckets - 1);
+for my $bucket ( @order )
+{
+  my @keys = @{ $bucket_keys[$bucket] || [] };
+  last if (@keys == 0);
+
+  my $d;
+  for ($d = 0; $d < 65536; $d++)
+  {
+    my %used = ();
+    my $ok = 1;
+    for my $k ( @keys )
+    {
+      my $s = ($k->[1] + $d * $k->[2]) % $slots;
+      if ($slot[$s] != 65535 || defined($used{$s})) { $ok = 0; last; }
+      $used{$s} = 1;
+    }
+    last if ($ok);
+  }
+  die "Couldn't build perfect hash for bucket $bucket\n" if ($d == 65536);
+
+  $displacement[$bucket] = $d;
+  for my $k ( @keys )
+  {
+    $slot[($k->[1] + $d * $k->[2]) % $slots] = $k->[0];
+  }
+}
+
+print OUTFILE "\n#define DEF_PROPS_SIZE " . $setsize . "\n";
+print OUTFILE "#define DEF_PROPS_TEXT " . $textsize . "\n";
+print OUTFILE "#define DEF_PROPS_CODED " . $codedsize . "\n";
+print OUTFILE "#define DEF_PROPS_CODES " . @codes . "\n";
+print OUTFILE "#define DEF_PROPS_HASH_BUCKETS " . $buckets . "\n";
+print OUTFILE "#define DEF_PROPS_HASH_SLOTS " . $slots . "\n";
+print OUTFILE "\n";
+
+print OUTFILE "// The MD5 of each entry, in binary form\n";
+print OUTFILE "static const uInt8 DefPropsMD5[DEF_PROPS_SIZE][16] = {\n";
+for (my $i = 0; $i < $setsize; $i++)
+{
+  my @bytes = map { sprintf("0x%02x", $_) } unpack("C16", pack("H32", $md5s[$i]));
+  print OUTFILE "  { " . join(", ", @bytes) . " }";
+  print OUTFILE "," if ($i+1 < $setsize);
+  print OUTFILE "\n";
+}
+print OUTFILE "};\n\n";
+
+print OUTFILE "// The displacement for each bucket of the perfect hash\n";
+print OUTFILE "static const uInt16 DefPropsHashBucket[DEF_PROPS_HASH_BUCKETS] = {\n";
+print_numbers(@displacement);
+print OUTFILE "};\n\n";
+
+print OUTFILE "// The entry in each slot of the perfect hash (65535 if empty)\n";
+print OUTFILE "static const uInt16 DefPropsHashSlot[DEF_PROPS_HASH_SLOTS] = {\n";
+print_numbers(@slot);
+print OUTFILE "};\n\n";
+
+print OUTFILE "// Offsets of the free-text properties of each entry in DefPropsStrings,\n";
+print OUTFILE "// starting with Cartridge_Manufacturer\n";
+print OUTFILE "static const uInt32 DefPropsText[DEF_PROPS_SIZE][DEF_PROPS_TEXT] = {\n";
+for (my $i = 0; $i < $setsize; $i++)
+{
+  print OUTFILE "  { " . join(", ", @{ $text_entries[$i] }) . " }";
+  print OUTFILE "," if ($i+1 < $setsize);
+  print OUTFILE "\n";
+}
+print OUTFILE "};\n\n";
+
+print OUTFILE "// Codes of the remaining properties of each entry, starting with\n";
+print OUTFILE "// Cartridge_Rarity\n";
+print OUTFILE "static const uInt8 DefPropsCoded[DEF_PROPS_SIZE][DEF_PROPS_CODED] = {\n";
+for (my $i = 0; $i < $setsize; $i++)
+{
+  print OUTFILE "  { " . join(", ", @{ $coded_entries[$i] }) . " }";
+  print OUTFILE "," if ($i+1 < $setsize);
   print OUTFILE "\n";
-  $idx++;
 }
+print OUTFILE "};\n\n";
+
+print OUTFILE "// Offset of the value for each code in DefPropsStrings\n";
+print OUTFILE "static const uInt32 DefPropsCodes[DEF_PROPS_CODES] = {\n";
+print_numbers(@codes);
+print OUTFILE "};\n\n";
 
-print OUTFILE "};\n";
+print OUTFILE "// Every distinct property value, each terminated by a NUL\n";
+print OUTFILE "static const char DefPropsStrings[] =\n";
+my @values = split(/\0/, $blob, -1);
+pop(@values);  # the blob ends with a NUL
+for (my $i = 0; $i < @values; $i++)
+{
+  my $value = $values[$i];
+  $value =~ s/\\/\\\\/g;
+  $value =~ s/"/\\"/g;
+  print OUTFILE "  \"$value\\0\"";
+  print OUTFILE ";" if ($i+1 == @values);
+  print OUTFILE "\n";
+}
 print OUTFILE "\n";
 print OUTFILE "#endif\n";
 
 close(OUTFILE);
 
 
+sub print_numbers {
+  my @numbers = @_;
+  for (my $i = 0; $i < @numbers; $i += 16)
+  {
+    my $last = $i + 15 < $#numbers ? $i + 15 : $#numbers;
+    print OUTFILE "  " . join(", ", @numbers[$i .. $last]);
+    print OUTFILE "," if ($last < $#numbers);
+    print OUTFILE "\n";
+  }
+}
+
 sub usage {
   print "create_props.pl <INPUT properties file> <OUTPUT C++ header>\n";
   print "\n";
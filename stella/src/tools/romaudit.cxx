@@ -0,0 +1,362 @@
+//============================================================================
+//
+//   SSSS    tt          lll  lll
+//  SS  SS   tt           ll   ll
+//  SS     tttttt  eeee   ll   ll   aaaa
+//   SSSS    tt   ee  ee  ll   ll      aa
+//      SS   tt   eeeeee  ll   ll   aaaaa  --  "An Atari 2600 VCS Emulator"
+//  SS  SS   tt   ee      ll   ll  aa  aa
+//   SSSS     ttt  eeeee llll llll  aaaaa
+//
+// Copyright (c) 1995-2014 by Bradford W. Mott, Stephen Anthony
+// and the Stella Team
+//
+// See the file "License.txt" for information on usage and redistribution of
+// this file, and for a DISCLAIMER OF ALL WARRANTIES.
+//
+// $Id$
+//============================================================================
+
+/**
+  Command-line tool which audits a ROM library: every ROM found in the
+  given directories (recursively, and including the ROMs inside ZIP
+  archives) is hashed, looked up in the built-in properties database and
+  classified by the bankswitch autodetection.  The work is spread over
+  a pool of worker threads, and the results are written to a compact
+  binary index.
+
+  Build it with 'make romaudit' from the top-level directory.
+
+  Index format (as written by the Serializer):
+    string  "StellaRomIndex"
+    int     version (currently 1)
+    int     number of entries, followed by this for each entry:
+      string  path of the ROM; a ROM inside an archive is given as
+              '<archive>/<name in archive>'
+      int     size of the ROM image
+      byte    the 16 bytes of the MD5, in order
+      string  type in the properties database ('AUTO' if unknown)
+      string  autodetected type
+      string  name in the properties database (empty if not found)
+
+  @author  Stella Team
+  @version $Id$
+*/
+
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "bspf.hxx"
+#include "CartDetector.hxx"
+#include "MD5.hxx"
+#include "Props.hxx"
+#include "PropsSet.hxx"
+#include "Serializer.hxx"
+#include "ZipHandler.hxx"
+
+// Anything larger than this can't be a 2600 ROM
+static const uInt32 kMaxRomSize = 512 * 1024;
+
+struct RomEntry
+{
+  string path;
+  uInt32 size;
+  string md5;
+  string type;
+  string detected;
+  string name;
+};
+typedef vector<RomEntry> RomEntryList;
+
+// Each file to be processed is a job; since a job for an archive can
+// yield any number of ROMs, each one has its own list of results
+struct Job
+{
+  string path;
+  bool archive;
+  RomEntryList results;
+};
+
+struct Audit
+{
+  vector<Job> jobs;
+  uInt32 nextJob;
+  pthread_mutex_t mutex;
+  PropertiesSet* propset;
+};
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+static bool isRomName(const string& name)
+{
+  return BSPF_endsWithIgnoreCase(name, ".a26") ||
+         BSPF_endsWithIgnoreCase(name, ".bin") ||
+         BSPF_endsWithIgnoreCase(name, ".rom");
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+static void findRoms(const string& dir, vector<Job>& jobs)
+{
+  DIR* dirp = opendir(dir.c_str());
+  if(dirp == NULL)
+  {
+    cerr << "WARNING: can't read directory '" << dir << "'" << endl;
+    return;
+  }
+
+  struct dirent* dp;
+  while((dp = readdir(dirp)) != NULL)
+  {
+    const string name = dp->d_name;
+    if(name == "." || name == "..")
+      continue;
+
+    const string path = dir + BSPF_PATH_SEPARATOR + name;
+    struct stat st;
+    if(stat(path.c_str(), &st) != 0)
+      continue;
+
+    if(S_ISDIR(st.st_mode))
+      findRoms(path, jobs);
+    else if(S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+      Job job;
+      job.archive = BSPF_endsWithIgnoreCase(name, ".zip");
+      if(job.archive || (isRomName(name) && st.st_size <= kMaxRomSize))
+      {
+        job.path = path;
+        jobs.push_back(job);
+      }
+    }
+  }
+  closedir(dirp);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+static void classify(const string& path, const uInt8* image, uInt32 size,
+                     const PropertiesSet& propset, RomEntryList& results)
+{
+  RomEntry entry;
+  entry.path = path;
+  entry.size = size;
+  entry.md5  = MD5(image, size);
+  entry.detected = CartDetector::autodetectType(image, size);
+
+  Properties props;
+  if(propset.getMD5(entry.md5, props))
+    entry.name = props.get(Cartridge_Name);
+  entry.type = props.get(Cartridge_Type);
+
+  results.push_back(entry);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+static void processFile(Job& job, const PropertiesSet& propset)
+{
+  ifstream in(job.path.c_str(), ios::binary);
+  if(!in)
+    return;
+
+  in.seekg(0, ios::end);
+  uInt32 size = (uInt32)in.tellg();
+  in.seekg(0, ios::beg);
+
+  uInt8* image = new uInt8[size];
+  in.read((char*)image, size);
+  if(in)
+    classify(job.path, image, size, propset, job.results);
+  delete[] image;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+static void processArchive(Job& job, ZipHandler& zip,
+                           const PropertiesSet& propset)
+{
+  zip.open(job.path);
+  while(zip.hasNext())
+  {
+    const string& name = zip.next();
+    if(!isRomName(name))
+      continue;
+
+    uInt8* image = 0;
+    try
+    {
+      uInt32 size = zip.decompress(image);
+      if(size > 0 && size <= kMaxRomSize)
+        classify(job.path + BSPF_PATH_SEPARATOR + name, image, size,
+                 propset, job.results);
+    }
+    catch(const char* msg)
+    {
+      cerr << "WARNING: " << job.path << ": " << name << ": " << msg << endl;
+    }
+    delete[] image;
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+static void* worker(void* arg)
+{
+  Audit& audit = *(Audit*)arg;
+
+  // ZIP handlers keep a cache of open archives, so each thread needs its own
+  ZipHandler zip;
+
+  for(;;)
+  {
+    pthread_mutex_lock(&audit.mutex);
+    uInt32 next = audit.nextJob++;
+    pthread_mutex_unlock(&audit.mutex);
+
+    if(next >= audit.jobs.size())
+      break;
+
+    Job& job = audit.jobs[next];
+    if(job.archive)
+      processArchive(job, zip, *audit.propset);
+    else
+      processFile(job, *audit.propset);
+  }
+
+  return NULL;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+static bool saveIndex(const string& filename, const vector<Job>& jobs,
+                      uInt32 count)
+{
+  Serializer out(filename, false, true);
+  if(!out.isValid())
+    return false;
+
+  try
+  {
+    out.putString("StellaRomIndex");
+    out.putInt(1);
+    out.putInt(count);
+
+    for(uInt32 j = 0; j < jobs.size(); ++j)
+    {
+      for(uInt32 i = 0; i < jobs[j].results.size(); ++i)
+      {
+        const RomEntry& entry = jobs[j].results[i];
+        out.putString(entry.path);
+        out.putInt(entry.size);
+        for(uInt32 b = 0; b < 16; ++b)
+          out.putByte((char)strtol(entry.md5.substr(b*2, 2).c_str(), 0, 16));
+        out.putString(entry.type);
+        out.putString(entry.detected);
+        out.putString(entry.name);
+      }
+    }
+  }
+  catch(...)
+  {
+    return false;
+  }
+
+  return true;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+static void usage(const char* prog)
+{
+  cout << "usage: " << prog << " [-j threads] [-o index] <directory> ..." << endl
+       << endl
+       << "  Hash and classify every ROM in the given directories (and the" << endl
+       << "  ZIP archives within them), writing the results to a binary" << endl
+       << "  index (default 'stella.romindex')." << endl;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+int main(int ac, char* av[])
+{
+  long numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+  string indexFile = "stella.romindex";
+  vector<string> dirs;
+
+  for(int i = 1; i < ac; ++i)
+  {
+    const string arg = av[i];
+    if(arg == "-j" && i + 1 < ac)
+      numThreads = atoi(av[++i]);
+    else if(arg == "-o" && i + 1 < ac)
+      indexFile = av[++i];
+    else if(arg[0] == '-')
+    {
+      usage(av[0]);
+      return 1;
+    }
+    else
+      dirs.push_back(arg);
+  }
+  if(dirs.empty())
+  {
+    usage(av[0]);
+    return 1;
+  }
+  if(numThreads < 1)
+    numThreads = 1;
+
+  struct timeval start, end;
+  gettimeofday(&start, NULL);
+
+  Audit audit;
+  for(uInt32 i = 0; i < dirs.size(); ++i)
+    findRoms(dirs[i], audit.jobs);
+  audit.nextJob = 0;
+  pthread_mutex_init(&audit.mutex, NULL);
+
+  // The properties set is only ever read, so it can be shared by all threads
+  PropertiesSet propset(NULL);
+  audit.propset = &propset;
+
+  if((uInt32)numThreads > audit.jobs.size())
+    numThreads = BSPF_max(audit.jobs.size(), (size_t)1);
+  vector<pthread_t> threads(numThreads);
+  for(long t = 0; t < numThreads; ++t)
+    pthread_create(&threads[t], NULL, worker, &audit);
+  for(long t = 0; t < numThreads; ++t)
+    pthread_join(threads[t], NULL);
+  pthread_mutex_destroy(&audit.mutex);
+
+  // Results are reported in the order the files were found, regardless
+  // of which thread got to them first
+  uInt32 count = 0, known = 0, mismatched = 0;
+  for(uInt32 j = 0; j < audit.jobs.size(); ++j)
+  {
+    const RomEntryList& results = audit.jobs[j].results;
+    for(uInt32 i = 0; i < results.size(); ++i)
+    {
+      ++count;
+      if(results[i].name != "")
+        ++known;
+      if(results[i].type != "AUTO" && results[i].type != results[i].detected)
+        ++mismatched;
+    }
+  }
+
+  if(!saveIndex(indexFile, audit.jobs, count))
+  {
+    cerr << "ERROR: couldn't write index '" << indexFile << "'" << endl;
+    return 1;
+  }
+
+  gettimeofday(&end, NULL);
+  uInt32 ms = (end.tv_sec - start.tv_sec) * 1000 +
+              (end.tv_usec - start.tv_usec) / 1000;
+
+  cout << count << " ROMs indexed (" << known << " with properties, "
+       << count - known << " without), " << mismatched
+       << " with a database type that differs from autodetection" << endl
+       << "Processed " << audit.jobs.size() << " files in " << ms << " ms using "
+       << numThreads << " threads" << endl;
+
+  return 0;
+}